@@ -13,6 +13,10 @@
 #cmakedefine HAVE__STRICMP_F 1
 #cmakedefine HAVE__STRNICMP_F 1
 #cmakedefine HAVE__MAX_PATH 1
+#cmakedefine HAVE_MMAP 1
+#cmakedefine HAVE_IO_URING 1
+#cmakedefine HAVE_PTHREAD_H 1
+#cmakedefine HAVE_FLOCK 1
 
 #ifndef HAVE__SETMODE
 #ifdef HAVE_SETMODE
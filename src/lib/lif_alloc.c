@@ -0,0 +1,251 @@
+/* lif_alloc.c -- free space allocation on a LIF medium */
+/* 2026 placed under the GPL */
+
+/* The free extents are kept in an array sorted by start block. A tree
+   with the length of the longest extent of every range of the array
+   finds the first or the last extent which is large enough. For best
+   fit the extents are also kept in a treap (a binary search tree which
+   is balanced by pseudo random priorities) ordered by length and start.
+   Allocations take blocks from an extent and never split it, so the
+   extents never change their order by start block */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lif_const.h"
+#include "lif_dir_utils.h"
+#include "lif_alloc.h"
+#include "lif_error.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+            do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+/* compare extent a and b by length, extents of the same length by start */
+static int longer(struct lif_alloc *map, int a, int b)
+  {
+    if(map->extents[a].length != map->extents[b].length)
+       return(map->extents[a].length > map->extents[b].length);
+    return(a > b);
+  }
+
+/* store the length of an extent in the tree */
+static void update_tree(struct lif_alloc *map, int i)
+  {
+    int node;
+    lif_blk_t l, r;
+
+    node= map->leaves+i;
+    map->max[node]= map->extents[i].length;
+    for(node/=2; node>0; node/=2)
+      {
+        l= map->max[2*node];
+        r= map->max[2*node+1];
+        map->max[node]= l > r ? l : r;
+      }
+  }
+
+/* treap of the extents by length. The priority of an extent is a hash
+   of its index, so the depth of the treap is O(log n) expected whatever
+   the order of the lengths is */
+static unsigned int priority(int i)
+  {
+    unsigned int h;
+
+    h= (unsigned int) i;
+    h^= h >> 16;
+    h*= 0x85EBCA6BU;
+    h^= h >> 13;
+    h*= 0xC2B2AE35U;
+    h^= h >> 16;
+    return(h);
+  }
+
+/* join two treaps, all extents of a are shorter than those of b */
+static int treap_merge(struct lif_alloc *map, int a, int b)
+  {
+    if(a == -1) return(b);
+    if(b == -1) return(a);
+    if(priority(a) > priority(b))
+      {
+        map->right[a]= treap_merge(map,map->right[a],b);
+        return(a);
+      }
+    map->left[b]= treap_merge(map,a,map->left[b]);
+    return(b);
+  }
+
+/* split a treap into the extents shorter than extent i and the rest */
+static void treap_split(struct lif_alloc *map, int t, int i, int *l, int *r)
+  {
+    if(t == -1)
+      {
+        *l= *r= -1;
+        return;
+      }
+    if(longer(map,i,t))
+      {
+        treap_split(map,map->right[t],i,&map->right[t],r);
+        *l= t;
+      }
+    else
+      {
+        treap_split(map,map->left[t],i,l,&map->left[t]);
+        *r= t;
+      }
+  }
+
+static int treap_insert(struct lif_alloc *map, int t, int i)
+  {
+    if(t == -1 || priority(i) > priority(t))
+      {
+        treap_split(map,t,i,&map->left[i],&map->right[i]);
+        return(i);
+      }
+    if(longer(map,t,i)) map->left[t]= treap_insert(map,map->left[t],i);
+    else map->right[t]= treap_insert(map,map->right[t],i);
+    return(t);
+  }
+
+/* remove extent i, which must be in the treap with its current length */
+static int treap_remove(struct lif_alloc *map, int t, int i)
+  {
+    if(t == i) return(treap_merge(map,map->left[i],map->right[i]));
+    if(longer(map,t,i)) map->left[t]= treap_remove(map,map->left[t],i);
+    else map->right[t]= treap_remove(map,map->right[t],i);
+    return(t);
+  }
+
+static void add_extent(struct lif_alloc *map, lif_blk_t start, lif_blk_t end)
+  {
+    if(end <= start) return;
+    debug_print("free extent %lld..%lld\n",start,end-1);
+    map->extents[map->num_extents].start= start;
+    map->extents[map->num_extents].length= end-start;
+    map->num_extents++;
+  }
+
+struct lif_alloc *lif_alloc_open(struct lif_dir *dir, lif_blk_t medium_size)
+  {
+    struct lif_alloc *map;
+    lif_blk_t next;
+    int i;
+
+    map= calloc(1,sizeof(struct lif_alloc));
+    if(map == NULL)
+      {
+        lif_set_error("Out of memory");
+        return(NULL);
+      }
+    /* there is at most one free extent before every file and one at
+       the end of the medium */
+    map->extents= malloc((dir->files+1)*sizeof(struct lif_extent));
+    map->left= malloc((dir->files+1)*sizeof(int));
+    map->right= malloc((dir->files+1)*sizeof(int));
+    if(map->extents == NULL || map->left == NULL || map->right == NULL)
+       goto nomem;
+
+    /* the files of the directory are sorted by start block */
+    next= dir->start+dir->length;
+    for(i=0; i<dir->files; i++)
+      {
+        add_extent(map,next,dir->by_start[i].start);
+        if(dir->by_start[i].start+dir->by_start[i].blocks > next)
+           next= dir->by_start[i].start+dir->by_start[i].blocks;
+      }
+    map->end= next;
+    add_extent(map,next,medium_size);
+
+    map->leaves= 1;
+    while(map->leaves < map->num_extents) map->leaves*=2;
+    map->max= calloc(2*map->leaves,sizeof(lif_blk_t));
+    if(map->max == NULL) goto nomem;
+    for(i=0; i<map->num_extents; i++) update_tree(map,i);
+
+    map->root= -1;
+    for(i=0; i<map->num_extents; i++) map->root= treap_insert(map,map->root,i);
+    return(map);
+
+nomem:
+    lif_alloc_close(map);
+    lif_set_error("Out of memory");
+    return(NULL);
+  }
+
+void lif_alloc_close(struct lif_alloc *map)
+  {
+    if(map == NULL) return;
+    free(map->extents);
+    free(map->max);
+    free(map->left);
+    free(map->right);
+    free(map);
+  }
+
+lif_blk_t lif_alloc_get(struct lif_alloc *map, lif_blk_t blocks, int policy)
+  {
+    int node, i;
+    lif_blk_t start;
+
+    /* an empty file is placed at the first free block */
+    if(blocks <= 0)
+      {
+        if(map->num_extents > 0) return(map->extents[0].start);
+        return(map->end);
+      }
+    if(map->max[1] < blocks) return(-1);
+
+    if(policy == LIF_ALLOC_BEST)
+      {
+        /* descend to the shortest extent which is large enough */
+        i= -1;
+        node= map->root;
+        while(node != -1)
+          {
+            if(map->extents[node].length >= blocks)
+              {
+                i= node;
+                node= map->left[node];
+              }
+            else node= map->right[node];
+          }
+      }
+    else
+      {
+        /* descend to the first or the last leaf which is large enough */
+        node= 1;
+        while(node < map->leaves)
+          {
+            if(policy == LIF_ALLOC_END)
+               node= map->max[2*node+1] >= blocks ? 2*node+1 : 2*node;
+            else
+               node= map->max[2*node] >= blocks ? 2*node : 2*node+1;
+          }
+        i= node-map->leaves;
+      }
+
+    /* the extent gets shorter and moves in the treap */
+    map->root= treap_remove(map,map->root,i);
+    if(policy == LIF_ALLOC_END)
+      {
+        start= map->extents[i].start+map->extents[i].length-blocks;
+      }
+    else
+      {
+        start= map->extents[i].start;
+        map->extents[i].start+= blocks;
+      }
+    map->extents[i].length-= blocks;
+    update_tree(map,i);
+    map->root= treap_insert(map,map->root,i);
+    debug_print("allocated %lld..%lld\n",start,start+blocks-1);
+    return(start);
+  }
+
+int lif_alloc_policy(char *name)
+  {
+    if(strcmp(name,"first") == 0) return(LIF_ALLOC_FIRST);
+    if(strcmp(name,"best") == 0) return(LIF_ALLOC_BEST);
+    if(strcmp(name,"end") == 0) return(LIF_ALLOC_END);
+    return(-1);
+  }
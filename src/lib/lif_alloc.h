@@ -0,0 +1,48 @@
+/* lif_alloc.h -- free space allocation on a LIF medium */
+/* 2026 placed under the GPL */
+
+#include "lif_const.h"
+
+/* The free space map is built from a directory object (see
+   lif_dir_utils.h). It holds the free extents between the end of the
+   directory and the end of the medium. Allocations only shrink extents.
+   For n free extents an allocation costs O(log n) with the policies
+   first and end and O(log n) expected with the policy best. */
+
+#define LIF_ALLOC_FIRST 0  /* lowest free extent which is large enough */
+#define LIF_ALLOC_BEST  1  /* smallest free extent which is large enough */
+#define LIF_ALLOC_END   2  /* end of the highest free extent which is
+                              large enough */
+
+struct lif_extent {
+         lif_blk_t start;       /* first block of the extent */
+         lif_blk_t length;      /* number of blocks of the extent */
+   };
+
+struct lif_alloc {
+         struct lif_extent *extents; /* free extents sorted by start block */
+         int num_extents;       /* number of free extents */
+         lif_blk_t end;         /* first block after the last file */
+         lif_blk_t *max;        /* tree of the longest extent of a range */
+         int leaves;            /* power of 2, number of tree leaves */
+         int root;              /* treap of the extents by length */
+         int *left, *right;     /* children in the treap, -1 if none */
+   };
+
+struct lif_dir;
+
+struct lif_alloc *lif_alloc_open(struct lif_dir *dir, lif_blk_t medium_size);
+/* build the free space map of a directory. medium_size is the number of
+   blocks of the medium. Returns NULL on error, see lif_error.h */
+
+void lif_alloc_close(struct lif_alloc *map);
+/* release the free space map */
+
+lif_blk_t lif_alloc_get(struct lif_alloc *map, lif_blk_t blocks, int policy);
+/* allocate blocks contiguous blocks with one of the policies above.
+   Returns the first block or -1 if there is no free extent which is
+   large enough */
+
+int lif_alloc_policy(char *name);
+/* get the policy for the names "first", "best" and "end". Returns -1
+   for an unknown name */
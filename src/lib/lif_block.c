@@ -6,93 +6,586 @@
 #include <errno.h>
 #include <string.h>
 #include <fcntl.h>
+#include "config.h"
 #include "lif_img.h"
+#include "lif_ovl.h"
+#include "lif_stream.h"
+#ifdef HAVE_MMAP
+#include "lif_map.h"
+#endif
 #include "lif_phy.h"
+#ifdef HAVE_IO_URING
+#include "lif_uring.h"
+#endif
 #include "lif_const.h"
+#include "lif_block.h"
+#include "lif_error.h"
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#ifdef HAVE_FLOCK
+#include <unistd.h>
+#include <sys/file.h>
+#endif
 
 #define DEBUG 0
 #define debug_print(fmt, ...) \
             do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
 
-static int p_flag;
+/* Backend functions of a device. Each backend transfers runs of
+   consecutive blocks on its own descriptor */
 
-int lif_open(char * filename,int flags,int mode, int physical_flag)
+struct lif_backend {
+         int (*read_blocks)(int fd, lif_blk_t first, int count, unsigned char *data);
+         int (*write_blocks)(int fd, lif_blk_t first, int count, unsigned char *data);
+         int (*resize)(int fd, lif_blk_t blocks); /* NULL if not supported */
+         int (*close)(int fd);
+         int direct;  /* block n is at offset n*256 of descriptor fd */
+   };
+
+static const struct lif_backend phy_backend= {
+         lif_read_phy_blocks, lif_write_phy_blocks, NULL, lif_close_phy_device,
+         0
+   };
+
+static const struct lif_backend img_backend= {
+         lif_read_img_blocks, lif_write_img_blocks, lif_resize_img_file,
+         lif_close_img_file, 1
+   };
+
+static const struct lif_backend ovl_backend= {
+         lif_read_ovl_blocks, lif_write_ovl_blocks, lif_resize_ovl_file,
+         lif_close_ovl_file, 0
+   };
+
+static const struct lif_backend stream_backend= {
+         lif_read_stream_blocks, lif_write_stream_blocks, NULL,
+         lif_close_stream_file, 0
+   };
+
+#ifdef HAVE_MMAP
+static const struct lif_backend map_backend= {
+         lif_read_map_blocks, lif_write_map_blocks, lif_resize_map_file,
+         lif_close_map_file, 1
+   };
+#endif
+
+/* Block cache. Single block reads and writes go through a small LRU
+   cache, modified blocks are written back when they are evicted, on
+   lif_flush and on lif_close. This avoids reading and writing the same
+   directory sector again for every directory entry */
+
+#define CACHE_BLOCKS 64
+
+struct cache_entry {
+         lif_blk_t block;      /* cached block number, -1 if unused */
+         int dirty;            /* block was modified */
+         unsigned long used;   /* time stamp of last access */
+         unsigned char data[SECTOR_SIZE];
+   };
+
+/* Device handle. The value returned by lif_open is an index into the
+   device table, so a process can have several images or devices open */
+
+#define MAX_DEVICES LIF_MAX_DEVICES
+
+struct lif_device {
+         const struct lif_backend *backend;
+         int fd;                    /* descriptor of the backend */
+         int lock_fd;               /* descriptor holding the lock, or -1 */
+         int base_lock_fd;          /* lock on the base of an overlay, or -1 */
+         struct cache_entry cache[CACHE_BLOCKS];
+         unsigned long cache_clock; /* LRU time stamp */
+   };
+
+static struct lif_device *devices[MAX_DEVICES];
+
+/* Several threads may open and close devices. The device table and the
+   descriptor tables of the backends are only changed by lif_open and
+   lif_close, which hold a lock. A device handle must only be used by one
+   thread at a time */
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t table_lock= PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_TABLE   pthread_mutex_lock(&table_lock)
+#define UNLOCK_TABLE pthread_mutex_unlock(&table_lock)
+#else
+#define LOCK_TABLE
+#define UNLOCK_TABLE
+#endif
+
+static struct lif_device *get_device(int handle)
+  {
+   if (handle < 0 || handle >= MAX_DEVICES || devices[handle] == NULL)
+      {
+        lif_set_error("Invalid device handle %d",handle);
+        return(NULL);
+      }
+   return(devices[handle]);
+  }
+
+static void cache_clear(struct lif_device *dev)
+  {
+   int i;
+
+   for (i=0; i< CACHE_BLOCKS; i++)
+      {
+        dev->cache[i].block= -1;
+        dev->cache[i].dirty= 0;
+      }
+   dev->cache_clock= 0;
+  }
+
+/* copy modified cached blocks of the range first..first+count-1 into a
+   buffer which was read from the medium */
+static void cache_overlay(struct lif_device *dev, lif_blk_t first, int count,
+                          unsigned char *data)
+  {
+   struct cache_entry *cache;
+   int i;
+
+   cache= dev->cache;
+   for (i=0; i< CACHE_BLOCKS; i++)
+      {
+        if (cache[i].block >= first && cache[i].block < first+count
+            && cache[i].dirty)
+           {
+             memcpy(data+(size_t) (cache[i].block-first)*SECTOR_SIZE,cache[i].data,
+                    SECTOR_SIZE);
+           }
+      }
+  }
+
+static int cache_lookup(struct lif_device *dev, lif_blk_t block)
+  {
+   int i;
+
+   for (i=0; i< CACHE_BLOCKS; i++)
+      {
+        if (dev->cache[i].block == block)
+           {
+             dev->cache[i].used= ++dev->cache_clock;
+             return(i);
+           }
+      }
+   return(-1);
+  }
+
+/* get a cache slot for block, evict the least recently used block */
+static int cache_slot(struct lif_device *dev, lif_blk_t block)
   {
-   int fileno;
+   int i, slot;
+   struct cache_entry *cache;
+
+   cache= dev->cache;
+   slot= 0;
+   for (i=0; i< CACHE_BLOCKS; i++)
+      {
+        if (cache[i].block == -1)
+           {
+             slot= i;
+             break;
+           }
+        if (cache[i].used < cache[slot].used) slot= i;
+      }
+   if (cache[slot].block != -1 && cache[slot].dirty)
+      {
+        debug_print("evict dirty block %lld\n",cache[slot].block);
+        if (dev->backend->write_blocks(dev->fd,cache[slot].block,1,
+                                   cache[slot].data)) return(-1);
+      }
+   cache[slot].block= block;
+   cache[slot].dirty= 0;
+   cache[slot].used= ++dev->cache_clock;
+   return(slot);
+  }
+
+static int compare_blocks(const void *a, const void *b)
+  {
+   lif_blk_t block_a, block_b;
+
+   block_a= (*(struct cache_entry * const *) a)->block;
+   block_b= (*(struct cache_entry * const *) b)->block;
+   return((block_a > block_b) - (block_a < block_b));
+  }
+
+/* Advisory locking. An image opened read only gets a shared lock, an
+   image opened for writing an exclusive lock, so any number of readers or
+   one writer can use an image at the same time. The lock is held on a
+   descriptor of its own for the whole time the image is open. The
+   environment variable LIFUTILS_LOCK selects what happens if the image
+   is locked by another process: "wait" (the default) waits until the lock
+   is released, "nowait" fails at once and "none" disables locking.
+   The base image of an overlay gets a shared lock in addition, because
+   it is read through the overlay. Streams are not locked */
+
+static int lock_image(char *filename, int flags, int mode)
+  {
+#ifdef HAVE_FLOCK
+   char *policy;
+   int fd, operation, lock_flags;
+
+   policy= getenv("LIFUTILS_LOCK");
+   operation= ((flags & O_ACCMODE) == O_RDONLY) ? LOCK_SH : LOCK_EX;
+   if (policy == NULL || *policy == '\0' || strcmp(policy,"wait") == 0)
+      ;
+   else if (strcmp(policy,"nowait") == 0)
+      operation|= LOCK_NB;
+   else if (strcmp(policy,"none") == 0)
+      return(-1);
+   else
+      {
+        lif_set_error("Invalid LIFUTILS_LOCK value %s",policy);
+        return(-2);
+      }
+
+   /* a new image is created here, so that it can be locked before the
+      backend truncates it. If the image cannot be opened the backend
+      reports the error */
+   lock_flags= O_RDONLY;
+   if (flags & O_CREAT) lock_flags|= O_CREAT;
+#ifdef O_CLOEXEC
+   lock_flags|= O_CLOEXEC;
+#endif
+   if ((fd= open(filename,lock_flags,mode)) == -1) return(-1);
+   while (flock(fd,operation) == -1)
+      {
+        if (errno == EINTR) continue;
+        if (errno == EWOULDBLOCK)
+           lif_set_error("%s is locked by another process",filename);
+        else
+           lif_set_error("Cannot lock %s: %s",filename,strerror(errno));
+        close(fd);
+        return(-2);
+      }
+   debug_print("%s lock on %s\n",(operation & LOCK_EX) ? "exclusive" : "shared",
+               filename);
+   return(fd);
+#else
+   (void) filename;
+   (void) flags;
+   (void) mode;
+   return(-1);
+#endif
+  }
+
+static void unlock_image(int lock_fd)
+  {
+#ifdef HAVE_FLOCK
+   /* closing the descriptor releases the lock */
+   if (lock_fd != -1) close(lock_fd);
+#else
+   (void) lock_fd;
+#endif
+  }
+
+static int open_device(char * filename,int flags,int mode, int physical_flag,
+                       int lock_fd, int base_lock_fd)
+  {
+   int handle, fd;
+   const struct lif_backend *backend;
+   struct lif_device *dev;
+
+   /* get a free device handle */
+   for (handle=0; handle< MAX_DEVICES; handle++)
+      {
+        if (devices[handle] == NULL) break;
+      }
+   if (handle == MAX_DEVICES)
+      {
+        lif_set_error("Too many open devices");
+        return(-1);
+      }
 
    /* open file or device */
-   p_flag= physical_flag;
-   if (p_flag)
+   if (physical_flag)
       {
-        fileno=lif_open_phy_device(filename);
+        backend= &phy_backend;
+        fd=lif_open_phy_device(filename);
+      }
+    else if (lif_is_stream_file(filename))
+      {
+        /* standard input or a pipe, must be checked first because
+           probing for an overlay would consume data */
+        backend= &stream_backend;
+        fd=lif_open_stream_file(filename,flags);
+      }
+    else if (! (flags & O_TRUNC) && lif_is_ovl_file(filename))
+      {
+        /* overlay over a read-only base image, a truncated file is
+           initialized as a plain image file */
+        backend= &ovl_backend;
+        fd=lif_open_ovl_file(filename,flags, mode);
       }
     else
       {
-        fileno=lif_open_img_file(filename,flags, mode);
+#ifdef HAVE_MMAP
+        /* try to map the image file into memory first */
+        backend= &map_backend;
+        fd=lif_open_map_file(filename,flags, mode);
+        if (fd == -1)
+#endif
+           {
+             backend= &img_backend;
+             fd=lif_open_img_file(filename,flags, mode);
+           }
       }
-    return(fileno);
+    if (fd == -1) return(-1);
+
+    dev= malloc(sizeof(struct lif_device));
+    if (dev == NULL)
+      {
+        backend->close(fd);
+        lif_set_error("Out of memory");
+        return(-1);
+      }
+    dev->backend= backend;
+    dev->fd= fd;
+    dev->lock_fd= lock_fd;
+    dev->base_lock_fd= base_lock_fd;
+    cache_clear(dev);
+    devices[handle]= dev;
+    return(handle);
   }
 
-void lif_close(int fileno)
+int lif_open(char * filename,int flags,int mode, int physical_flag)
   {
-   /* close file or device */
-   if (p_flag)
+   int handle, lock_fd, base_lock_fd;
+   char base[SECTOR_SIZE];      /* the path is stored in the first block */
+
+   /* lock the image and the base image of an overlay before they are
+      opened, streams are not locked. The table is not locked while
+      waiting for the image */
+   lock_fd= -1;
+   base_lock_fd= -1;
+   if (physical_flag || ! lif_is_stream_file(filename))
       {
-        lif_close_phy_device(fileno);
+        /* a new image file is created here, the lock and the backend
+           open it without O_EXCL */
+        if (! physical_flag && (flags & O_CREAT) && (flags & O_EXCL))
+           {
+             if ((handle= open(filename,O_CREAT | O_EXCL | O_WRONLY | O_BINARY,
+                               mode)) == -1)
+                {
+                  lif_set_error("%s",strerror(errno));
+                  return(-1);
+                }
+             close(handle);
+             flags&= ~O_EXCL;
+           }
+        lock_fd= lock_image(filename,flags,mode);
+        if (lock_fd == -2) return(-1);
+        if (! physical_flag && ! (flags & O_TRUNC) &&
+            lif_get_ovl_base(filename,base,SECTOR_SIZE) == 0)
+           {
+             base_lock_fd= lock_image(base,O_RDONLY,0);
+             if (base_lock_fd == -2)
+                {
+                  unlock_image(lock_fd);
+                  return(-1);
+                }
+           }
       }
-    else
+   LOCK_TABLE;
+   handle= open_device(filename,flags,mode,physical_flag,lock_fd,
+                       base_lock_fd);
+   UNLOCK_TABLE;
+   if (handle == -1)
       {
-        lif_close_img_file(fileno);
+        unlock_image(base_lock_fd);
+        unlock_image(lock_fd);
       }
+   return(handle);
   }
 
-void lif_read_block(int input_file, int block, unsigned char *data)
+int lif_flush(int handle)
   {
-    /* Read one block */
-   if (p_flag)
+   /* write back all modified blocks of the cache in ascending block order,
+      consecutive blocks are written with one transfer */
+   struct lif_device *dev;
+   struct cache_entry *dirty[CACHE_BLOCKS];
+   unsigned char data[CACHE_BLOCKS*SECTOR_SIZE];
+   int i, j, n, count;
+   lif_blk_t first;
+
+   if ((dev= get_device(handle)) == NULL) return(-1);
+   n= 0;
+   for (i=0; i< CACHE_BLOCKS; i++)
       {
-        lif_read_phy_block(input_file,block,data);
+        if (dev->cache[i].block != -1 && dev->cache[i].dirty)
+           dirty[n++]= &dev->cache[i];
       }
-    else
+   if (n == 0) return(0);
+   qsort(dirty,n,sizeof(struct cache_entry *),compare_blocks);
+   i= 0;
+   while (i < n)
       {
-        lif_read_img_block(input_file,block,data);
+        first= dirty[i]->block;
+        count= 0;
+        while (i+count < n && dirty[i+count]->block == first+count)
+           {
+             memcpy(data+count*SECTOR_SIZE,dirty[i+count]->data,SECTOR_SIZE);
+             count++;
+           }
+        debug_print("flush blocks %lld..%lld\n",first,first+count-1);
+        /* the blocks stay dirty if they could not be written, so a later
+           flush tries again */
+        if (dev->backend->write_blocks(dev->fd,first,count,data)) return(-1);
+        for (j=0; j< count; j++) dirty[i+j]->dirty= 0;
+        i+= count;
       }
+   return(0);
+  }
+
+int lif_close(int handle)
+  {
+   struct lif_device *dev;
+   int iret;
+
+   if ((dev= get_device(handle)) == NULL) return(-1);
+   /* write back cached blocks, close file or device. The handle is
+      released even if this fails */
+   iret= lif_flush(handle);
+   LOCK_TABLE;
+   if (dev->backend->close(dev->fd)) iret= -1;
+   unlock_image(dev->base_lock_fd);
+   unlock_image(dev->lock_fd);
+   free(dev);
+   devices[handle]= NULL;
+   UNLOCK_TABLE;
+   return(iret);
+  }
+
+int lif_read_block(int handle, lif_blk_t block, unsigned char *data)
+  {
+    /* Read one block */
+   struct lif_device *dev;
+   int slot;
 
+   if ((dev= get_device(handle)) == NULL) return(-1);
+   slot= cache_lookup(dev,block);
+   if (slot == -1)
+      {
+        if ((slot= cache_slot(dev,block)) == -1) return(-1);
+        if (dev->backend->read_blocks(dev->fd,block,1,dev->cache[slot].data))
+           {
+             dev->cache[slot].block= -1;
+             return(-1);
+           }
+      }
+   memcpy(data,dev->cache[slot].data,SECTOR_SIZE);
+   return(0);
   }
 
-void lif_truncate(int fileno)
+int lif_resize(int handle, lif_blk_t blocks)
   {
-   if (!p_flag) lif_truncate_img_file(fileno);
+   struct lif_device *dev;
+   int i;
+
+   if ((dev= get_device(handle)) == NULL) return(-1);
+   /* ignored for physical devices */
+   if (dev->backend->resize == NULL) return(0);
+   /* cached blocks beyond the new end of file are discarded */
+   for (i=0; i< CACHE_BLOCKS; i++)
+      {
+        if (dev->cache[i].block >= blocks)
+           {
+             dev->cache[i].block= -1;
+             dev->cache[i].dirty= 0;
+           }
+      }
+   return(dev->backend->resize(dev->fd,blocks));
   }
 
-void lif_write_block(int output_file, int block, unsigned char *data)
+int lif_ovl_device_info(int handle, char **base, lif_blk_t *size, int *modified)
   {
-    /* Write one block */
-   if (p_flag)
+   struct lif_device *dev;
+
+   if ((dev= get_device(handle)) == NULL) return(-1);
+   if (dev->backend != &ovl_backend)
       {
-        lif_write_phy_block(output_file,block,data);
+        lif_set_error("Not an overlay file");
+        return(-1);
       }
-    else
+   return(lif_ovl_info(dev->fd,base,size,modified));
+  }
+
+int lif_truncate(int handle)
+  {
+   return(lif_resize(handle,0));
+  }
+
+int lif_write_block(int handle, lif_blk_t block, unsigned char *data)
+  {
+    /* Write one block, the block is written back on eviction or flush */
+   struct lif_device *dev;
+   int slot;
+
+   if ((dev= get_device(handle)) == NULL) return(-1);
+   slot= cache_lookup(dev,block);
+   if (slot == -1)
       {
-        lif_write_img_block(output_file,block,data);
+        if ((slot= cache_slot(dev,block)) == -1) return(-1);
       }
+   memcpy(dev->cache[slot].data,data,SECTOR_SIZE);
+   dev->cache[slot].dirty= 1;
+   return(0);
+  }
+
+
+int lif_read_blocks(int handle, lif_blk_t first, int count, unsigned char *data)
+  {
+    /* Read consecutive blocks, modified blocks in the cache take
+       precedence over the medium */
+   struct lif_device *dev;
+
+   if ((dev= get_device(handle)) == NULL) return(-1);
+   if (count <= 0) return(0);
+   if (dev->backend->read_blocks(dev->fd,first,count,data)) return(-1);
+   cache_overlay(dev,first,count,data);
+   return(0);
+  }
+
+int lif_write_blocks(int handle, lif_blk_t first, int count, unsigned char *data)
+  {
+    /* Write consecutive blocks, cached copies of these blocks are
+       replaced */
+   struct lif_device *dev;
+   struct cache_entry *cache;
+   int i, iret;
 
+   if ((dev= get_device(handle)) == NULL) return(-1);
+   if (count <= 0) return(0);
+   iret= dev->backend->write_blocks(dev->fd,first,count,data);
+   /* cached copies stay dirty if the write failed */
+   cache= dev->cache;
+   for (i=0; i< CACHE_BLOCKS; i++)
+      {
+        if (cache[i].block >= first && cache[i].block < first+count)
+           {
+             memcpy(cache[i].data,data+(size_t) (cache[i].block-first)*SECTOR_SIZE,
+                    SECTOR_SIZE);
+             cache[i].dirty= (iret != 0);
+           }
+      }
+   return(iret);
   }
 
 
-void lif_write_dir_entry(int output_file, int dir_start, int entry, unsigned char * dir_entry)
+int lif_write_dir_entry(int output_file, lif_blk_t dir_start, int entry, unsigned char * dir_entry)
 
    {
-     int blocknum, n, offset,i;
+     int n, offset,i;
+     lif_blk_t blocknum;
      unsigned char block[SECTOR_SIZE];
 
      debug_print("directory entry %d\n", entry);
      n= (SECTOR_SIZE/ ENTRY_SIZE);
      blocknum= dir_start + ( entry / n);
-     debug_print("block %d\n",blocknum); 
+     debug_print("block %lld\n",blocknum); 
 
      /* read sector of the entry */
-     lif_read_block(output_file,blocknum, block);
+     if (lif_read_block(output_file,blocknum, block)) return(-1);
 
      /* poke entry into block */
      offset= entry - ((int) (entry /n)) * n;
@@ -102,6 +595,181 @@ void lif_write_dir_entry(int output_file, int dir_start, int entry, unsigned cha
         block[i+offset]= dir_entry[i];
      
      /* write block */
-     lif_write_block(output_file,blocknum, block);
+     return(lif_write_block(output_file,blocknum, block));
    }
 
+
+/* Asynchronous block reads. Requests of image files are handed over to
+   io_uring, so many reads are in flight at the same time. Requests of
+   physical devices and overlays and all requests on systems without
+   io_uring are read synchronously by lif_aio_wait in the order they were queued */
+
+struct aio_request {
+         int in_use;           /* slot holds a pending request */
+         int on_ring;          /* request was queued on the io_uring */
+         unsigned long seq;    /* queue order of synchronous requests */
+         int handle;
+         lif_blk_t first;
+         int count;
+         unsigned char *data;
+         void *user;
+   };
+
+struct lif_aio {
+         int depth;                 /* number of request slots */
+         int pending;               /* requests not yet completed */
+         unsigned long seq;
+         struct aio_request *req;
+#ifdef HAVE_IO_URING
+         struct lif_uring *ring;    /* NULL: synchronous fallback */
+#endif
+   };
+
+struct lif_aio *lif_aio_init(int depth)
+  {
+   struct lif_aio *ctx;
+
+   if (depth <= 0)
+      {
+        lif_set_error("Invalid queue depth %d",depth);
+        return(NULL);
+      }
+   ctx= calloc(1,sizeof(struct lif_aio));
+   if (ctx != NULL) ctx->req= calloc(depth,sizeof(struct aio_request));
+   if (ctx == NULL || ctx->req == NULL)
+      {
+        free(ctx);
+        lif_set_error("Out of memory");
+        return(NULL);
+      }
+   ctx->depth= depth;
+#ifdef HAVE_IO_URING
+   /* fall back to synchronous reads if the kernel does not support it */
+   ctx->ring= lif_uring_init(depth);
+   debug_print("aio context %s io_uring\n",ctx->ring ? "with" : "without");
+#endif
+   return(ctx);
+  }
+
+int lif_aio_read(struct lif_aio *ctx, int handle, lif_blk_t first, int count,
+                 unsigned char *data, void *user)
+  {
+   struct lif_device *dev;
+   struct aio_request *req;
+   int slot;
+
+   if ((dev= get_device(handle)) == NULL) return(-1);
+   if (ctx->pending == ctx->depth)
+      {
+        lif_set_error("Too many pending requests");
+        return(-1);
+      }
+   for (slot=0; ctx->req[slot].in_use; slot++)
+      ;
+   req= &ctx->req[slot];
+   req->in_use= 1;
+   req->on_ring= 0;
+   req->seq= ctx->seq++;
+   req->handle= handle;
+   req->first= first;
+   req->count= count;
+   req->data= data;
+   req->user= user;
+   ctx->pending++;
+#ifdef HAVE_IO_URING
+   if (ctx->ring != NULL && dev->backend->direct && count > 0)
+      {
+        if (lif_uring_read(ctx->ring,dev->fd,first,count,data,
+                           (unsigned long) slot) == 0)
+           {
+             req->on_ring= 1;
+           }
+      }
+#endif
+   return(0);
+  }
+
+/* finish a request, returns 1 if it was successful and -1 otherwise */
+static int aio_complete(struct lif_aio *ctx, struct aio_request *req,
+                        int status, void **user)
+  {
+   *user= req->user;
+   req->in_use= 0;
+   ctx->pending--;
+   return(status ? -1 : 1);
+  }
+
+int lif_aio_wait(struct lif_aio *ctx, void **user)
+  {
+   struct aio_request *req;
+   int i, status;
+#ifdef HAVE_IO_URING
+   struct lif_device *dev;
+   unsigned long tag;
+   int result;
+#endif
+
+   *user= NULL;
+   if (ctx->pending == 0) return(0);
+
+   /* synchronous requests first, oldest one */
+   req= NULL;
+   for (i=0; i< ctx->depth; i++)
+      {
+        if (ctx->req[i].in_use && ! ctx->req[i].on_ring &&
+            (req == NULL || ctx->req[i].seq < req->seq))
+           req= &ctx->req[i];
+      }
+   if (req != NULL)
+      {
+        status= lif_read_blocks(req->handle,req->first,req->count,req->data);
+        return(aio_complete(ctx,req,status,user));
+      }
+
+#ifdef HAVE_IO_URING
+   if (lif_uring_wait(ctx->ring,&tag,&result)) return(-1);
+   req= &ctx->req[tag];
+   status= 0;
+   if (result < 0)
+      {
+        lif_set_error("Error reading block %lld from file. (%s)",req->first,
+                      strerror(-result));
+        status= -1;
+      }
+   else if (result != req->count*SECTOR_SIZE)
+      {
+        lif_set_error("Premature end of sector %lld. %d bytes read.",
+                      req->first+result/SECTOR_SIZE,result % SECTOR_SIZE);
+        status= -1;
+      }
+   else
+      {
+        /* modified blocks in the cache take precedence over the medium */
+        if ((dev= get_device(req->handle)) == NULL)
+           status= -1;
+        else
+           cache_overlay(dev,req->first,req->count,req->data);
+      }
+   return(aio_complete(ctx,req,status,user));
+#else
+   lif_set_error("Internal error: lost asynchronous request");
+   return(-1);
+#endif
+  }
+
+void lif_aio_exit(struct lif_aio *ctx)
+  {
+   void *user;
+
+   /* the buffers of pending requests must not be used by the kernel
+      after the context was released */
+   while (ctx->pending)
+      {
+        if (lif_aio_wait(ctx,&user) == -1 && user == NULL) break;
+      }
+#ifdef HAVE_IO_URING
+   if (ctx->ring != NULL) lif_uring_exit(ctx->ring);
+#endif
+   free(ctx->req);
+   free(ctx);
+  }
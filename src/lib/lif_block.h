@@ -1,21 +1,90 @@
 /* lif_block.c -- generic i/o layer for lif disk or image file */
 /*  2000, 2015 A. R. Duell, J. Siebold and placed under the GPL */
+
+#include "lif_const.h"
+
+/* maximum number of devices that can be open at the same time */
+#define LIF_MAX_DEVICES 16
+
+/* All functions except lif_open return 0 on success. On error they
+   return -1, the error message is available from lif_errmsg, see
+   lif_error.h */
 int lif_open(char * filename,int flags,int mode, int physical);
-/* open a file or physical device */
+/* open a file or physical device. Returns a device handle which is used
+   by all other functions or -1 on error. Several devices can be open at
+   the same time, each handle has its own backend and block cache.
+   Overlay files (see lif_ovl.h) are recognized and accessed like the
+   image they represent. The filename "-" (standard input) or a pipe is
+   opened read only as a stream, which can only be read forward (see
+   lif_stream.h). lif_open and lif_close can be called from several
+   threads, but each handle must only be used by one thread at a time.
+   Images and devices are locked against other processes while they are
+   open: shared if opened read only, exclusive otherwise. The base image
+   of an overlay file is locked shared. lif_open waits
+   for a conflicting lock, unless the environment variable LIFUTILS_LOCK
+   is "nowait" (fail at once) or "none" (no locking). With O_CREAT |
+   O_EXCL an image file is only created if it does not exist */
+
+int lif_close(int fileno);
+/* close a file or physical device, modified blocks are written back */
 
-void lif_close(int fileno);
-/* close a file or physical device */
+int lif_flush(int fileno);
+/* write back all modified blocks which are held in the block cache */
 
 int lif_truncate(int fileno);
 /* truncate a file to zero length (ingnored for physical devices) */
 
-void lif_read_block(int input_device, int block, unsigned char *data);
+int lif_resize(int fileno, lif_blk_t blocks);
+/* set the length of a file to blocks (ignored for physical devices).
+   Blocks added at the end read as zero and do not use disk space on
+   file systems with sparse file support */
+
+int lif_ovl_device_info(int fileno, char **base, lif_blk_t *size, int *modified);
+/* get the base image file name, the image size and the number of
+   modified blocks of a device opened from an overlay file, see
+   lif_ovl_info */
+
+int lif_read_block(int input_device, lif_blk_t block, unsigned char *data);
 /* Read a block from fileno input_device.  block is the 
    number to read, data points to a 256 byte buffer to receive it */
 
-void lif_write_block(int output_device, int block, unsigned char *data);
-/* write a file block */
+int lif_write_block(int output_device, lif_blk_t block, unsigned char *data);
+/* write a file block. The block is kept in the block cache and written
+   to the medium by lif_flush or lif_close */
+
+int lif_read_blocks(int input_device, lif_blk_t first, int count, unsigned char *data);
+/* Read count consecutive blocks starting at block first. data points
+   to a buffer of count*256 bytes. Image files are read with a single
+   system call */
 
-void lif_write_dir_entry(int output_device, int dir_start, int entry, unsigned char * dir_entry);
+int lif_write_blocks(int output_device, lif_blk_t first, int count, unsigned char *data);
+/* write count consecutive blocks starting at block first from a buffer
+   of count*256 bytes */
+
+int lif_write_dir_entry(int output_device, lif_blk_t dir_start, int entry, unsigned char * dir_entry);
 /* write a directory entry */
 
+
+struct lif_aio;
+/* context for asynchronous block reads */
+
+struct lif_aio *lif_aio_init(int depth);
+/* create a context for up to depth pending reads. On Linux the reads
+   of image files are executed by io_uring, otherwise (and for physical
+   devices) they are read synchronously by lif_aio_wait. Returns NULL
+   on error */
+
+int lif_aio_read(struct lif_aio *ctx, int input_device, lif_blk_t first, int count, unsigned char *data, void *user);
+/* queue a read of count blocks starting at block first into data. The
+   buffer must not be used and the device must not be closed until the
+   request has completed. user is returned by lif_aio_wait. Returns -1
+   if depth requests are already pending */
+
+int lif_aio_wait(struct lif_aio *ctx, void **user);
+/* submit the queued reads and wait until one of them is completed.
+   Returns 1 if a read was successful, -1 if it failed and 0 if no
+   read is pending. user is set to the value given to lif_aio_read, it
+   is NULL if the wait itself failed */
+
+void lif_aio_exit(struct lif_aio *ctx);
+/* wait for all pending reads and release the context */
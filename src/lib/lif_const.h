@@ -1,6 +1,9 @@
 /* lif_const.h -- constants for various LIF file items */
 /* 2014 J. Siebold, and placed under the GPL */
 
+#ifndef LIF_CONST_H
+#define LIF_CONST_H
+
 /* length of lif file name */
 #define NAME_LEN 10 
 /* lif sector size */
@@ -15,5 +18,12 @@
 #define MAX_LENGTH 524288
 /* Maximum line length */
 #define LINE_LENGTH 65536
-/* Maximum block size of lif image file */
-#define MAXBLOCKS 65536
+/* Number of blocks transferred at once by multi block i/o */
+#define IO_BLOCKS 2048
+
+/* Block number of a lif medium. The directory stores 32 bit block
+   numbers, the i/o layer uses 64 bit numbers, so byte offsets of
+   large images are computed without overflow */
+typedef long long lif_blk_t;
+
+#endif
@@ -88,6 +88,40 @@ void put_hp71_length(unsigned char *entry, unsigned int length, int odd_flag)
     entry[31]=0;
   }
 
+int get_medium(char *medium, int *tracks, int *heads, int *sectors)
+/* Get the geometry of a medium type. Returns the number of blocks of
+   the medium or 0 for an unknown medium type */
+  {
+    struct mt
+      {
+        char *name;
+        int tracks, heads, sectors;
+      } mediumtype[] =
+      {
+        { "cass",      2, 1, 256 },
+        { "disk",     77, 2,  16 },
+        { "hdrive1",  80, 2,  16 },
+        { "hdrive2", 125, 1,  64 },
+        { "hdrive4", 125, 2,  64 },
+        { "hdrive8", 125, 4,  64 },
+        { "hdrive16",125, 8,  64 },
+        { "",          0, 0,   0 }
+      };
+    int i;
+
+    for(i=0; mediumtype[i].tracks; i++)
+      {
+        if(strcmp(medium,mediumtype[i].name)==0)
+          {
+            *tracks=mediumtype[i].tracks;
+            *heads=mediumtype[i].heads;
+            *sectors=mediumtype[i].sectors;
+            return(*tracks * *heads * *sectors);
+          }
+      }
+    return(0);
+  }
+
 int bcd(int value)
 /* Convert a 2 digit number to BCD */
   {
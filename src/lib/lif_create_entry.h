@@ -11,6 +11,10 @@ void create_entry(unsigned char *entry, char *name, unsigned int filetype,
 void put_lif_int(unsigned char *data, int length, unsigned int value);
 /* Put an integer into the next <length> bytes of <data>, MSB first */
 
+int get_medium(char *medium, int *tracks, int *heads, int *sectors);
+/* Get the geometry of a medium type (cass, disk, hdrive1 ...), returns
+   the number of blocks or 0 for an unknown medium type */
+
 void put_time(unsigned char *entry);
 /* put  time stamp value in to a directory entry */
 
@@ -3,8 +3,13 @@
 /* 2000 A. R. Duell, and placed under the GPL */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "lif_const.h"
+#include "lif_block.h"
+#include "lif_error.h"
+#include "lif_dir_utils.h"
 
 unsigned int get_lif_int(unsigned char *data,int length)
   {
@@ -276,6 +281,41 @@ void pad_label(char *name, char *cmp_name)
       }
   }
 
+static int match(char *pattern, char *name, int len)
+  {
+    for(; *pattern; pattern++)
+      {
+        if(*pattern == '*')
+          {
+            /* try all lengths for the rest of the name */
+            for(;;)
+              {
+                if(match(pattern+1,name,len)) return(1);
+                if(len == 0) return(0);
+                name++;
+                len--;
+              }
+          }
+        if(len == 0) return(0);
+        if(*pattern != '?' && *pattern != *name) return(0);
+        name++;
+        len--;
+      }
+    return(len == 0);
+  }
+
+int match_name(char *pattern, char *entry)
+  {
+    /* Check if the file name in directory entry matches pattern. A '*'
+       matches any number of characters, a '?' one character. The
+       padding spaces of the file name are ignored */
+
+    int len;
+
+    for(len=NAME_LEN; len>0 && entry[len-1]==' '; len--) ;
+    return(match(pattern,entry,len));
+  }
+
 int check_name(char *name, int len)
   {
       int i;
@@ -299,3 +339,380 @@ int check_labelname(char *name)
       return check_name(name,LABEL_LEN);
   }
 
+
+/* Directory object */
+
+static unsigned int hash_name(char *name, int hash_size)
+  {
+    unsigned int h;
+    int i;
+
+    h=0;
+    for(i=0; i<NAME_LEN; i++) h= h*31 + (unsigned char) name[i];
+    return(h & (unsigned int) (hash_size-1));
+  }
+
+static void hash_add(struct lif_dir *dir, int slot)
+  {
+    unsigned int h;
+
+    h= hash_name((char *) dir->entries+slot*ENTRY_SIZE,dir->hash_size);
+    dir->next[slot]= dir->hash[h];
+    dir->hash[h]= slot;
+  }
+
+static void hash_remove(struct lif_dir *dir, int slot)
+  {
+    int *p;
+
+    p= &dir->hash[hash_name((char *) dir->entries+slot*ENTRY_SIZE,
+                            dir->hash_size)];
+    while(*p != -1)
+      {
+        if(*p == slot)
+          {
+            *p= dir->next[slot];
+            return;
+          }
+        p= &dir->next[*p];
+      }
+  }
+
+static int compare_files(const void *a, const void *b)
+  {
+    const struct lif_dir_file *fa= a, *fb= b;
+
+    if(fa->start != fb->start) return(fa->start < fb->start ? -1 : 1);
+    return(fa->slot - fb->slot);
+  }
+
+/* position of a file in the start block index, or the position where
+   it has to be inserted */
+static int start_pos(struct lif_dir *dir, lif_blk_t start, int slot)
+  {
+    int lo, hi, mid;
+    struct lif_dir_file f;
+
+    f.start= start;
+    f.slot= slot;
+    lo=0;
+    hi=dir->files;
+    while(lo < hi)
+      {
+        mid= (lo+hi)/2;
+        if(compare_files(&dir->by_start[mid],&f) < 0) lo= mid+1;
+        else hi= mid;
+      }
+    return(lo);
+  }
+
+/* update the running maximum of the file ends from position i on */
+static void update_ends(struct lif_dir *dir, int i)
+  {
+    lif_blk_t end;
+
+    end= i > 0 ? dir->by_start[i-1].max_end : 0;
+    for(; i<dir->files; i++)
+      {
+        if(dir->by_start[i].start+dir->by_start[i].blocks > end)
+           end= dir->by_start[i].start+dir->by_start[i].blocks;
+        dir->by_start[i].max_end= end;
+      }
+  }
+
+static void start_add(struct lif_dir *dir, int slot)
+  {
+    unsigned char *entry;
+    int i;
+
+    entry= dir->entries+slot*ENTRY_SIZE;
+    i= start_pos(dir,get_lif_int(entry+12,4),slot);
+    memmove(&dir->by_start[i+1],&dir->by_start[i],
+            (dir->files-i)*sizeof(struct lif_dir_file));
+    dir->by_start[i].start= get_lif_int(entry+12,4);
+    dir->by_start[i].blocks= get_lif_int(entry+16,4);
+    dir->by_start[i].slot= slot;
+    dir->files++;
+    update_ends(dir,i);
+  }
+
+static void start_remove(struct lif_dir *dir, int slot)
+  {
+    int i;
+
+    i= start_pos(dir,get_lif_int(dir->entries+slot*ENTRY_SIZE+12,4),slot);
+    if(i == dir->files || dir->by_start[i].slot != slot) return;
+    dir->files--;
+    memmove(&dir->by_start[i],&dir->by_start[i+1],
+            (dir->files-i)*sizeof(struct lif_dir_file));
+    update_ends(dir,i);
+  }
+
+static void free_add(struct lif_dir *dir, int slot)
+  {
+    int i;
+
+    for(i=dir->num_free; i>0 && dir->free_slots[i-1] > slot; i--)
+       dir->free_slots[i]= dir->free_slots[i-1];
+    dir->free_slots[i]= slot;
+    dir->num_free++;
+  }
+
+static void free_remove(struct lif_dir *dir, int slot)
+  {
+    int i;
+
+    for(i=0; i<dir->num_free; i++)
+      {
+        if(dir->free_slots[i] == slot)
+          {
+            dir->num_free--;
+            memmove(&dir->free_slots[i],&dir->free_slots[i+1],
+                    (dir->num_free-i)*sizeof(int));
+            return;
+          }
+      }
+  }
+
+struct lif_dir *lif_dir_open(int device)
+  {
+    struct lif_dir *dir;
+    unsigned int length;
+    int slot, n, count;
+
+    dir= calloc(1,sizeof(struct lif_dir));
+    if(dir == NULL)
+      {
+        lif_set_error("Out of memory");
+        return(NULL);
+      }
+    dir->device= device;
+    if(lif_read_block(device,0,dir->header)) goto fail;
+    if(get_lif_int(dir->header,2)!=0x8000)
+      {
+        lif_set_error("This is not a LIF disk!");
+        goto fail;
+      }
+    dir->start= get_lif_int(dir->header+8,4);
+    length= get_lif_int(dir->header+16,4);
+    if(length > INT_MAX/(8*ENTRY_SIZE))
+      {
+        lif_set_error("Directory too large");
+        goto fail;
+      }
+    dir->length= (int) length;
+    dir->slots= dir->length*8;
+
+    /* one more slot, so no allocation has a size of zero */
+    dir->hash_size= 16;
+    while(dir->hash_size < 2*dir->slots) dir->hash_size*=2;
+    dir->entries= malloc((dir->slots+1)*ENTRY_SIZE);
+    dir->hash= malloc(dir->hash_size*sizeof(int));
+    dir->next= malloc((dir->slots+1)*sizeof(int));
+    dir->by_start= malloc((dir->slots+1)*sizeof(struct lif_dir_file));
+    dir->free_slots= malloc((dir->slots+1)*sizeof(int));
+    if(dir->entries == NULL || dir->hash == NULL || dir->next == NULL ||
+       dir->by_start == NULL || dir->free_slots == NULL)
+      {
+        lif_set_error("Out of memory");
+        goto fail;
+      }
+
+    /* read the directory */
+    for(n=0; n<dir->length; n+=count)
+      {
+        count= dir->length-n;
+        if(count > IO_BLOCKS) count= IO_BLOCKS;
+        if(lif_read_blocks(device,dir->start+n,count,
+                           dir->entries+n*SECTOR_SIZE)) goto fail;
+      }
+
+    /* find the end of directory mark */
+    for(dir->used=0; dir->used<dir->slots; dir->used++)
+      {
+        if(get_lif_int(dir->entries+dir->used*ENTRY_SIZE+10,2)==0xFFFF) break;
+      }
+
+    /* build the indexes, the hash chains are built backwards so that a
+       name lookup returns the first of several files with the same name */
+    for(n=0; n<dir->hash_size; n++) dir->hash[n]= -1;
+    for(slot=dir->used-1; slot>=0; slot--)
+      {
+        if(get_lif_int(dir->entries+slot*ENTRY_SIZE+10,2)==0) continue;
+        hash_add(dir,slot);
+      }
+    dir->files=0;
+    dir->num_free=0;
+    dir->dirty_first= -1;
+    dir->dirty_last= -1;
+    for(slot=0; slot<dir->used; slot++)
+      {
+        if(get_lif_int(dir->entries+slot*ENTRY_SIZE+10,2)==0)
+          {
+            dir->free_slots[dir->num_free++]= slot;
+            continue;
+          }
+        dir->by_start[dir->files].start= get_lif_int(dir->entries+slot*ENTRY_SIZE+12,4);
+        dir->by_start[dir->files].blocks= get_lif_int(dir->entries+slot*ENTRY_SIZE+16,4);
+        dir->by_start[dir->files].slot= slot;
+        dir->files++;
+      }
+    qsort(dir->by_start,dir->files,sizeof(struct lif_dir_file),compare_files);
+    update_ends(dir,0);
+    return(dir);
+
+fail:
+    lif_dir_close(dir);
+    return(NULL);
+  }
+
+void lif_dir_close(struct lif_dir *dir)
+  {
+    if(dir == NULL) return;
+    free(dir->entries);
+    free(dir->hash);
+    free(dir->next);
+    free(dir->by_start);
+    free(dir->free_slots);
+    free(dir);
+  }
+
+unsigned char *lif_dir_entry(struct lif_dir *dir, int slot)
+  {
+    return(dir->entries+slot*ENTRY_SIZE);
+  }
+
+int lif_dir_find(struct lif_dir *dir, char *cmp_name)
+  {
+    int slot;
+
+    for(slot=dir->hash[hash_name(cmp_name,dir->hash_size)]; slot != -1;
+        slot=dir->next[slot])
+      {
+        if(compare_names((char *) dir->entries+slot*ENTRY_SIZE,cmp_name))
+           return(slot);
+      }
+    return(-1);
+  }
+
+int lif_dir_next_block_owner(struct lif_dir *dir, lif_blk_t block, int *pos)
+  {
+    int i;
+
+    /* go back from the last file which starts at or before block. No file
+       before a position whose running maximum of the ends is not behind
+       block can contain it */
+    if(*pos < 0) i= start_pos(dir,block,INT_MAX)-1;
+    else i= *pos-1;
+    for(; i >= 0 && dir->by_start[i].max_end > block; i--)
+      {
+        if(block < dir->by_start[i].start+dir->by_start[i].blocks)
+          {
+            *pos= i;
+            return(dir->by_start[i].slot);
+          }
+      }
+    *pos= 0;
+    return(-1);
+  }
+
+int lif_dir_find_block(struct lif_dir *dir, lif_blk_t block)
+  {
+    int pos;
+
+    pos= -1;
+    return(lif_dir_next_block_owner(dir,block,&pos));
+  }
+
+int lif_dir_free_slot(struct lif_dir *dir)
+  {
+    if(dir->num_free > 0) return(dir->free_slots[0]);
+    if(dir->used < dir->slots) return(dir->used);
+    return(-1);
+  }
+
+/* remember that a slot has to be written to the medium */
+static void mark_dirty(struct lif_dir *dir, int slot)
+  {
+    if(dir->dirty_first == -1 || slot < dir->dirty_first)
+       dir->dirty_first= slot;
+    if(slot > dir->dirty_last) dir->dirty_last= slot;
+  }
+
+int lif_dir_update(struct lif_dir *dir, int slot, unsigned char *entry)
+  {
+    unsigned char *old;
+    int i;
+
+    if(slot < 0 || slot > dir->used || slot >= dir->slots)
+      {
+        lif_set_error("Invalid directory slot %d",slot);
+        return(-1);
+      }
+    old= dir->entries+slot*ENTRY_SIZE;
+
+    /* remove the old entry from the indexes */
+    if(slot < dir->used)
+      {
+        if(get_lif_int(old+10,2)==0)
+          {
+            free_remove(dir,slot);
+          }
+        else
+          {
+            hash_remove(dir,slot);
+            start_remove(dir,slot);
+          }
+      }
+
+    memcpy(old,entry,ENTRY_SIZE);
+    mark_dirty(dir,slot);
+
+    /* the end of directory mark is overwritten, move it to the next slot */
+    if(slot == dir->used)
+      {
+        dir->used++;
+        if(dir->used < dir->slots)
+          {
+            old= dir->entries+dir->used*ENTRY_SIZE;
+            for(i=0; i<ENTRY_SIZE; i++) old[i]=0;
+            old[10]= (unsigned char) 0xFF;
+            old[11]= (unsigned char) 0xFF;
+            mark_dirty(dir,dir->used);
+          }
+      }
+
+    /* add the new entry to the indexes */
+    if(get_lif_int(entry+10,2)==0)
+      {
+        free_add(dir,slot);
+      }
+    else
+      {
+        hash_add(dir,slot);
+        start_add(dir,slot);
+      }
+    return(0);
+  }
+
+int lif_dir_flush(struct lif_dir *dir)
+  {
+    int first, last;
+
+    if(dir->dirty_first == -1) return(0);
+    /* write all directory blocks between the first and the last changed
+       slot with one transfer */
+    first= dir->dirty_first/8;
+    last= dir->dirty_last/8;
+    if(lif_write_blocks(dir->device,dir->start+first,last-first+1,
+                        dir->entries+first*SECTOR_SIZE)) return(-1);
+    dir->dirty_first= -1;
+    dir->dirty_last= -1;
+    return(0);
+  }
+
+int lif_dir_write(struct lif_dir *dir, int slot, unsigned char *entry)
+  {
+    if(lif_dir_update(dir,slot,entry)) return(-1);
+    return(lif_dir_flush(dir));
+  }
@@ -2,6 +2,8 @@
                       directory */
 /* 2000 A. R. Duell, and placed under the GPL */
 
+#include "lif_const.h"
+
 unsigned int get_lif_int(unsigned char *data,int length);
 /* Read the next <length> bytes (MSB first) from <data> and turn into 
    an integer */
@@ -21,7 +23,85 @@ int check_labelname(char *name);
 
 int compare_names(char *entry, char *cmp_name);
 
-int pad_name(char *entry, char *cmp_name);
+int match_name(char *pattern, char *entry);
+/* check if the file name of a directory entry matches a pattern with
+   the wildcards '*' and '?' */
+
+void pad_name(char *name, char *cmp_name);
+
+void pad_label(char *name, char *cmp_name);
+
+
+/* Directory object. The volume header and the whole directory are read
+   once into memory. Files can be looked up by name with a hash index and
+   by block with an index sorted by start block. Directory slots are
+   numbered from 0, slots from used on are beyond the end of directory
+   mark. The functions returning int return -1 on error, the functions
+   returning a pointer return NULL, see lif_error.h */
+
+struct lif_dir_file {
+         lif_blk_t start;       /* first block of the file */
+         lif_blk_t blocks;      /* number of blocks of the file */
+         int slot;              /* directory slot of the file */
+         lif_blk_t max_end;     /* first block after the end of this and
+                                   all files which start before it */
+   };
+
+struct lif_dir {
+         int device;            /* device handle, see lif_block.h */
+         unsigned char header[SECTOR_SIZE]; /* volume header (block 0) */
+         lif_blk_t start;       /* first block of the directory */
+         int length;            /* length of directory in blocks */
+         int slots;             /* number of directory slots */
+         int used;              /* slot of the end of directory mark */
+         unsigned char *entries; /* all slots, ENTRY_SIZE bytes each */
+         int *hash;             /* first slot of a hash chain, -1 if empty */
+         int *next;             /* next slot of the same hash chain */
+         int hash_size;         /* power of 2 */
+         struct lif_dir_file *by_start; /* files sorted by start block */
+         int files;             /* number of files */
+         int *free_slots;       /* deleted slots in ascending order */
+         int num_free;          /* number of deleted slots */
+         int dirty_first;       /* first changed slot, -1 if none */
+         int dirty_last;        /* last changed slot */
+   };
+
+struct lif_dir *lif_dir_open(int device);
+/* read the volume header and the directory of a LIF medium. The
+   directory is read in ascending block order, so this works on streams */
+
+void lif_dir_close(struct lif_dir *dir);
+/* release the directory object, the device is not closed */
+
+unsigned char *lif_dir_entry(struct lif_dir *dir, int slot);
+/* get the 32 byte directory entry of a slot */
+
+int lif_dir_find(struct lif_dir *dir, char *cmp_name);
+/* find a file by its name padded to 10 characters (see pad_name).
+   Returns the slot or -1 if there is no such file */
+
+int lif_dir_find_block(struct lif_dir *dir, lif_blk_t block);
+/* find a file which occupies block. Returns the slot or -1 if the
+   block does not belong to a file. If files overlap, this is the one
+   with the highest start block, see lif_dir_next_block_owner */
+
+int lif_dir_next_block_owner(struct lif_dir *dir, lif_blk_t block, int *pos);
+/* find all files which occupy block, for overlapping files of a corrupt
+   directory. Set *pos to -1 before the first call, every call returns
+   the slot of the next file in descending order of start blocks and -1
+   after the last one */
+
+int lif_dir_free_slot(struct lif_dir *dir);
+/* get the slot for a new file: the first deleted slot or the slot of the
+   end of directory mark. Returns -1 if the directory is full */
+
+int lif_dir_update(struct lif_dir *dir, int slot, unsigned char *entry);
+/* store a new, changed or deleted (file type 0) entry in a slot. If the
+   end of directory mark is overwritten it is moved to the next slot. The
+   medium is not written until lif_dir_flush is called */
 
-int pad_label(char *entry, char *cmp_name);
+int lif_dir_flush(struct lif_dir *dir);
+/* write the changed directory blocks to the medium */
 
+int lif_dir_write(struct lif_dir *dir, int slot, unsigned char *entry);
+/* lif_dir_update followed by lif_dir_flush */
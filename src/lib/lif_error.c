@@ -0,0 +1,40 @@
+/* lif_error.c -- error reporting of the LIF library */
+/* 2026 placed under the GPL */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "lif_error.h"
+
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL
+#endif
+
+/* maximum length of an error message */
+#define ERRMSG_LEN 256
+
+static THREAD_LOCAL char errmsg[ERRMSG_LEN];
+
+const char *lif_errmsg(void)
+  {
+    return(errmsg);
+  }
+
+void lif_set_error(const char *fmt, ...)
+  {
+    va_list args;
+
+    va_start(args,fmt);
+    vsnprintf(errmsg,ERRMSG_LEN,fmt,args);
+    va_end(args);
+  }
+
+void lif_fatal(void)
+  {
+    fprintf(stderr,"%s\n",errmsg);
+    exit(1);
+  }
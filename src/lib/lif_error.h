@@ -0,0 +1,16 @@
+/* lif_error.h -- error reporting of the LIF library */
+/* 2026 placed under the GPL */
+
+/* Library functions do not terminate the program on errors. They return
+   -1 (or NULL) and leave a message which can be retrieved with 
+   lif_errmsg. The message is kept per thread */
+
+const char *lif_errmsg(void);
+/* return the message of the last error of the calling thread */
+
+void lif_set_error(const char *fmt, ...);
+/* set the error message of the calling thread, printf style */
+
+void lif_fatal(void);
+/* print the last error message to standard error and exit, for use
+   in command line programs */
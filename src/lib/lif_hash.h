@@ -0,0 +1,30 @@
+/* lif_hash.h -- SHA-256 hash of file contents */
+/* 2026 placed under the GPL */
+
+#include <stddef.h>
+
+/* SHA-256 as specified in FIPS 180-4. The hash is used to identify the
+   contents of LIF files, for example in the catalog index of lifindex */
+
+#define LIF_HASH_SIZE 32                /* bytes of a hash */
+#define LIF_HASH_HEX  (2*LIF_HASH_SIZE+1) /* length of the hex string */
+
+struct lif_hash {
+         unsigned long state[8];    /* intermediate hash value */
+         unsigned long long length; /* number of bytes hashed */
+         unsigned char buf[64];     /* incomplete 64 byte block */
+         int fill;                  /* bytes in buf */
+   };
+
+void lif_hash_init(struct lif_hash *ctx);
+/* start a new hash */
+
+void lif_hash_update(struct lif_hash *ctx, const unsigned char *data, size_t len);
+/* add len bytes to the hash */
+
+void lif_hash_final(struct lif_hash *ctx, unsigned char *digest);
+/* finish the hash and store LIF_HASH_SIZE bytes in digest */
+
+void lif_hash_hex(const unsigned char *digest, char *hex);
+/* convert a hash to a string of LIF_HASH_HEX-1 lower case hex digits
+   and a terminating zero */
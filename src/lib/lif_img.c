@@ -1,14 +1,20 @@
 /* lif_img.c -- read/write a block (specified by logical block number) to/from
-                  a lif disk */ 
+                  a lif disk */
 /*  2000,2015 A. R. Duell, J. Siebold and placed under the GPL */
 
+/* glibc declares SEEK_DATA and SEEK_HOLE only with _GNU_SOURCE */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
 #include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "lif_const.h"
+#include "lif_img.h"
+#include "lif_error.h"
 
 #define DEBUG 0
 #define debug_print(fmt, ...) \
@@ -20,82 +26,143 @@ int lif_open_img_file(char *filename, int flags, int mode)
       int iret;
 
       iret=open(filename,flags,mode);
-      /* the error handling is done by the caller, so output system error message only */
-      if (iret== -1) 
+      if (iret== -1)
         {
-          fprintf(stderr,"%s\n",strerror(errno));
+          lif_set_error("%s",strerror(errno));
         }
       return(iret);
   }
 /* close lif image file */
-void lif_close_img_file(int descriptor)
+int lif_close_img_file(int descriptor)
   {
-      close(descriptor);
+      if(close(descriptor))
+       {
+          lif_set_error("Error closing file (%s)",strerror(errno));
+          return(-1);
+       }
+      return(0);
   }
 
-/* truncate a lif image file */
-void lif_truncate_img_file(int lif_file)
+/* resize a lif image file, an extended file is sparse */
+int lif_resize_img_file(int lif_file, lif_blk_t blocks)
   {
-      if(ftruncate(lif_file,0))
+      if(ftruncate(lif_file,(off_t) SECTOR_SIZE * blocks))
        {
-          fprintf(stderr,"Error truncating file (%s)\n",strerror(errno));
-          exit(1);
+          lif_set_error("Error resizing file (%s)",strerror(errno));
+          return(-1);
        }
+      return(0);
   }
 
-/* Read one block from an lif image file */
-void lif_read_img_block(int input_file, int block, unsigned char *data)
+/* truncate a lif image file */
+int lif_truncate_img_file(int lif_file)
   {
-    off_t seek_ret;
+      return(lif_resize_img_file(lif_file,0));
+  }
+
+#ifdef SEEK_HOLE
+/* reads of at least this many blocks skip holes of sparse files */
+#define SPARSE_MIN_BLOCKS 64
+
+/* Read a range of a sparse file. Holes are not read but filled with
+   zeros. Returns 1 if the range could not be handled this way, the
+   caller then reads it with a single pread */
+static int read_sparse(int input_file, off_t offset, size_t length,
+                       unsigned char *data)
+  {
+    struct stat st;
+    off_t pos, end, data_pos, hole_pos;
     ssize_t read_ret;
 
-    /* Go to the right block in the file */
-    seek_ret=lseek(input_file,(off_t) (SECTOR_SIZE*block),SEEK_SET);
-    if (seek_ret == (off_t) -1) 
+    end= offset + (off_t) length;
+    /* a read beyond the end of file is reported by the caller */
+    if(fstat(input_file,&st) || end > st.st_size) return(1);
+    pos= offset;
+    while(pos < end)
       {
-        fprintf(stderr,"Error seeking to block %d. (%s)\n",block,strerror(errno));
-        exit(1);
+        data_pos= lseek(input_file,pos,SEEK_DATA);
+        if(data_pos == (off_t) -1)
+          {
+            /* no more data up to the end of file */
+            if(errno != ENXIO) return(1);
+            data_pos= end;
+          }
+        if(data_pos > end) data_pos= end;
+        if(data_pos > pos)
+          {
+            debug_print("hole at %ld..%ld\n",(long) pos,(long) data_pos-1);
+            memset(data+(pos-offset),0,(size_t) (data_pos-pos));
+            pos= data_pos;
+            continue;
+          }
+        hole_pos= lseek(input_file,pos,SEEK_HOLE);
+        if(hole_pos == (off_t) -1) return(1);
+        if(hole_pos > end) hole_pos= end;
+        read_ret=pread(input_file,data+(pos-offset),(size_t) (hole_pos-pos),pos);
+        if(read_ret != (ssize_t) (hole_pos-pos)) return(1);
+        pos= hole_pos;
       }
-    /* Read it */
-    debug_print("read block %d\n",block); 
-    read_ret=read(input_file,data,(size_t) SECTOR_SIZE);
-    if (read_ret== (ssize_t) -1) 
+    return(0);
+  }
+#endif
+
+/* Read consecutive blocks from an lif image file */
+int lif_read_img_blocks(int input_file, lif_blk_t first, int count, unsigned char *data)
+  {
+    size_t length;
+    ssize_t read_ret;
+
+    length= (size_t) SECTOR_SIZE * count;
+    debug_print("read blocks %lld..%lld\n",first,first+count-1);
+#ifdef SEEK_HOLE
+    if(count >= SPARSE_MIN_BLOCKS &&
+       read_sparse(input_file,(off_t) SECTOR_SIZE * first,length,data) == 0)
+      return(0);
+#endif
+    read_ret=pread(input_file,data,length,(off_t) SECTOR_SIZE * first);
+    if (read_ret== (ssize_t) -1)
       {
-        fprintf(stderr,"Error reading block %d from file. (%s)\n",block,strerror(errno));
-        exit(1);
+        lif_set_error("Error reading block %lld from file. (%s)",first,strerror(errno));
+        return(-1);
       }
-    if (read_ret != SECTOR_SIZE) 
+    if (read_ret != (ssize_t) length)
       {
-        fprintf(stderr,"Premature end of sector %d. %ld bytes read.\n", block, read_ret);
-        exit(1);
+        lif_set_error("Premature end of sector %lld. %ld bytes read.", first+(lif_blk_t) (read_ret/SECTOR_SIZE), (long) (read_ret % SECTOR_SIZE));
+        return(-1);
       }
+    return(0);
   }
 
-/* Write one block to an lif image file */
-void lif_write_img_block(int output_file, int block, unsigned char *data)
+/* Write consecutive blocks to an lif image file */
+int lif_write_img_blocks(int output_file, lif_blk_t first, int count, unsigned char *data)
   {
-    off_t seek_ret;
+    size_t length;
     ssize_t write_ret;
 
-    /* Go to the right block in the file */
-    seek_ret=lseek(output_file,(off_t) (SECTOR_SIZE*block),SEEK_SET);
-    if (seek_ret == (off_t) -1) 
-      {
-        fprintf(stderr,"Error seeking to block %d. (%s)\n",block,strerror(errno));
-        exit(1);
-      }
-
-    /* Write it */
-    debug_print("write to block %d\n",block); 
-    write_ret=write(output_file,data,SECTOR_SIZE);
+    length= (size_t) SECTOR_SIZE * count;
+    debug_print("write to blocks %lld..%lld\n",first,first+count-1);
+    write_ret=pwrite(output_file,data,length,(off_t) SECTOR_SIZE * first);
     if(write_ret == (ssize_t) -1)
       {
-        fprintf(stderr,"Error writing block %d from file (%s)\n",block,strerror(errno));
-        exit(1);
+        lif_set_error("Error writing block %lld from file (%s)",first,strerror(errno));
+        return(-1);
       }
-    if (write_ret != SECTOR_SIZE) 
+    if (write_ret != (ssize_t) length)
       {
-        fprintf(stderr,"Premature end of sector %d. %ld bytes written.\n", block, write_ret);
-        exit(1);
+        lif_set_error("Premature end of sector %lld. %ld bytes written.", first+(lif_blk_t) (write_ret/SECTOR_SIZE), (long) (write_ret % SECTOR_SIZE));
+        return(-1);
       }
+    return(0);
+  }
+
+/* Read one block from an lif image file */
+int lif_read_img_block(int input_file, lif_blk_t block, unsigned char *data)
+  {
+    return(lif_read_img_blocks(input_file,block,1,data));
+  }
+
+/* Write one block to an lif image file */
+int lif_write_img_block(int output_file, lif_blk_t block, unsigned char *data)
+  {
+    return(lif_write_img_blocks(output_file,block,1,data));
   }
@@ -1,24 +1,40 @@
 /* lif_img.h -- functions to read/write one block from/to a lif image file  */
 /* 2000, 2015 A. R. Duell, J. Siebold and placed under the GPL */
 
+#include "lif_const.h"
+
+/* The open functions return a descriptor, all other functions return 0 on
+   success. On error -1 is returned, see lif_error.h */
+
 int lif_open_img_file(char * filename, int mode, int flag);
 /* open an image file.  filename is the name of the file or device,
    mode is the mode in which it is opened and flag is 1 if filename
    is a device and 0 if filename is a file */
 
-void lif_close_img_file(int fileno);
+int lif_close_img_file(int fileno);
 /* Close the file or device indicated by descriptor */
 
-void lif_read_img_block(int input_file, int block, unsigned char *data);
+int lif_read_img_block(int input_file, lif_blk_t block, unsigned char *data);
 /* Read a block from descriptor input_device.  block is the 
    number to read, data points to a 256 byte buffer to receive it */
 
-void lif_write_img_block(int output_file, int block, unsigned char *data);
+int lif_write_img_block(int output_file, lif_blk_t block, unsigned char *data);
 /* write a file block to descriptor output_device.  block is the 
    number to write, data points to a 256 byte buffer  */
 
-void lif_truncate_img_file(int fileno);
+int lif_read_img_blocks(int input_file, lif_blk_t first, int count, unsigned char *data);
+/* Read count consecutive blocks starting at block first with one system
+   call, data points to a buffer of count*256 bytes */
+
+int lif_write_img_blocks(int output_file, lif_blk_t first, int count, unsigned char *data);
+/* write count consecutive blocks starting at block first with one system
+   call, data points to a buffer of count*256 bytes */
+
+int lif_truncate_img_file(int fileno);
 /* truncate an image file to zero length */
 
-void exit_error(char *msg);
-/* exit and output error message */
+int lif_resize_img_file(int fileno, lif_blk_t blocks);
+/* set the length of an image file to blocks. If the file is extended
+   the new blocks read as zero, on most file systems they do not use
+   any disk space */
+
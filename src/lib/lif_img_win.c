@@ -7,25 +7,58 @@
 #include <fcntl.h>
 #include "lif_const.h"
 #include "lif_img.h"
+#include "lif_error.h"
 
 #define DEBUG 0
 #define debug_print(fmt, ...) \
             do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
 
-static HANDLE img_file_handle= (HANDLE) NULL;
+/* table of open image files, the fake unix file handle is the index
+   into this table plus FIRST_FAKE_FD */
+#define MAX_IMG_FILES 16
+#define FIRST_FAKE_FD 4
+
+static HANDLE img_file_handles[MAX_IMG_FILES];
+
+static int win_error(char * msg);
+
+/* get the windows handle of a fake unix file handle */
+static HANDLE get_img_handle(int descriptor)
+  {
+     if (descriptor < FIRST_FAKE_FD || descriptor >= FIRST_FAKE_FD+MAX_IMG_FILES)
+        return((HANDLE) NULL);
+     return(img_file_handles[descriptor-FIRST_FAKE_FD]);
+  }
+
+/* move the file pointer to a block, SetFilePointerEx takes a 64 bit
+   offset, so images larger than 2 GB can be accessed */
+static BOOL seek_block(HANDLE img_file_handle, lif_blk_t block)
+  {
+     LARGE_INTEGER offset;
+
+     offset.QuadPart= (LONGLONG) SECTOR_SIZE * block;
+     return(SetFilePointerEx(img_file_handle,offset,NULL,FILE_BEGIN));
+  }
+
 /*
- Open LIF image file (windows compatibility). Because we have only one open
- LIF image file at any time this procedures only allow to open one file.
+ Open LIF image file (windows compatibility). 
 */
 
 int lif_open_img_file(char *filename, int flags, int mode)
   {
-     /* check if a file was already opened */
-     if (img_file_handle != (HANDLE) NULL)
+     int slot;
+     HANDLE img_file_handle= (HANDLE) NULL;
+
+     /* get a free table slot */
+     for (slot=0; slot < MAX_IMG_FILES; slot++)
        {
-          fprintf(stderr,"Tried to open more than one LIF image file\n");
-          exit(1);
-     }
+          if (img_file_handles[slot] == (HANDLE) NULL) break;
+       }
+     if (slot == MAX_IMG_FILES)
+       {
+          lif_set_error("Tried to open too many LIF image files");
+          return(-1);
+       }
      /* open files according to file open flags */
      if ((flags & 0x3) == O_RDONLY) 
        {
@@ -41,121 +74,195 @@ int lif_open_img_file(char *filename, int flags, int mode)
        }
       if (img_file_handle == INVALID_HANDLE_VALUE) 
        {
-          exit_error("Error: open LIF image file failed");
+          return(win_error("Error: open LIF image file failed"));
        }
+      img_file_handles[slot]= img_file_handle;
       /* fake a unix file handle */
-      return(4);
+      return(slot+FIRST_FAKE_FD);
   }
 /* close a file */
-void lif_close_img_file(int descriptor)
+int lif_close_img_file(int descriptor)
   {
+     HANDLE img_file_handle= get_img_handle(descriptor);
+
      if (img_file_handle== (HANDLE) NULL)
        {
-          fprintf(stderr,"Error: tried to close a non existing file handle");
-          exit(1);
+          lif_set_error("Error: tried to close a non existing file handle");
+          return(-1);
        }
       CloseHandle(img_file_handle);
-      img_file_handle= (HANDLE) NULL;
+      img_file_handles[descriptor-FIRST_FAKE_FD]= (HANDLE) NULL;
+    return(0);
   }
 
-/* truncate a file */
-void lif_truncate_img_file(int lif_file)
+/* set the size of a file to blocks, new blocks are zero */
+int lif_resize_img_file(int lif_file, lif_blk_t blocks)
   {
-    DWORD seek_ret;
     BOOL eof_ret;
+    HANDLE img_file_handle= get_img_handle(lif_file);
 
      if (img_file_handle== (HANDLE) NULL) 
        {
-          fprintf(stderr,"Error: tried truncating a non existing file handle");
-          exit(1);
+          lif_set_error("Error: tried resizing a non existing file handle");
+          return(-1);
        }
 
-    /* Go to block 0 in the file */
-    seek_ret=SetFilePointer(img_file_handle, (LONG) 0,NULL,0); 
-    if(seek_ret == INVALID_SET_FILE_POINTER) 
+    /* Go to the new end of the file */
+    if(! seek_block(img_file_handle,blocks))
        {
-          exit_error("Error: seek in LIF image file failed");
+          return(win_error("Error: seek in LIF image file failed"));
        }
     
      /* EOF */
      eof_ret= SetEndOfFile(img_file_handle);
      if(! eof_ret) 
        {
-          exit_error("Error: trunate a LIF image file failed");
+          return(win_error("Error: resize a LIF image file failed"));
        }
+    return(0);
+  }
+
+/* truncate a file */
+int lif_truncate_img_file(int lif_file)
+  {
+    return(lif_resize_img_file(lif_file,0));
   }
 
 /* read a certain file sector */
-void lif_read_img_block(int input_file, int block, unsigned char *data)
+int lif_read_img_block(int input_file, lif_blk_t block, unsigned char *data)
   {
-    DWORD seek_ret;
+    HANDLE img_file_handle= get_img_handle(input_file);
     BOOL read_ret;
     DWORD NumberOfBytesRead;
 
     /* Read one block from an image file */
     if (img_file_handle== (HANDLE) NULL )
        {
-          fprintf(stderr,"Error: tried reading from a non existing file handle");
-          exit(1);
+          lif_set_error("Error: tried reading from a non existing file handle");
+          return(-1);
        }
 
     /* Go to the right block in the file */
-    seek_ret=SetFilePointer(img_file_handle, (LONG) (SECTOR_SIZE*block),NULL,0); 
-    if(seek_ret == INVALID_SET_FILE_POINTER) 
+    if(! seek_block(img_file_handle,block))
        {
-          exit_error("Error: seek in LIF image file failed");
+          return(win_error("Error: seek in LIF image file failed"));
        }
 
     /* Read block */
     read_ret= ReadFile(img_file_handle, data, (DWORD) SECTOR_SIZE, &NumberOfBytesRead, NULL);
     if(! read_ret) 
        {
-          exit_error("Error: read from LIF image file failed");
+          return(win_error("Error: read from LIF image file failed"));
        }
     if (NumberOfBytesRead != SECTOR_SIZE)
        {
-          exit_error("Error: read from LIF image file failed");
+          return(win_error("Error: read from LIF image file failed"));
        }
+    return(0);
   }
 
 
-void lif_write_img_block(int output_file, int block, unsigned char *data)
+int lif_write_img_block(int output_file, lif_blk_t block, unsigned char *data)
   {
-    DWORD seek_ret;
+    HANDLE img_file_handle= get_img_handle(output_file);
     BOOL write_ret;
     DWORD NumberOfBytesWritten;
 
     /* Read one block from an image file */
     if (img_file_handle== (HANDLE) NULL) 
        {
-          fprintf(stderr,"Error: tried writing to a non existing file handle");
-          exit(1);
+          lif_set_error("Error: tried writing to a non existing file handle");
+          return(-1);
        }
 
     /* Go to the right block in the file */
-    seek_ret=SetFilePointer(img_file_handle, (LONG) (SECTOR_SIZE*block),NULL,0); 
-    if(seek_ret == INVALID_SET_FILE_POINTER) 
+    if(! seek_block(img_file_handle,block))
        {
-          exit_error("Error: write to LIF image file failed");
+          return(win_error("Error: write to LIF image file failed"));
        }
-    debug_print("write to block %d\n",block); 
+    debug_print("write to block %lld\n",block); 
 
     /* Write block */
     write_ret= WriteFile(img_file_handle, data, (DWORD) SECTOR_SIZE, &NumberOfBytesWritten, NULL);
     if(! write_ret) 
        {
-          exit_error("Error: write to LIF image file failed");
+          return(win_error("Error: write to LIF image file failed"));
        }
     if (NumberOfBytesWritten != SECTOR_SIZE)
        {
-          exit_error("Error: write to LIF image file failed");
+          return(win_error("Error: write to LIF image file failed"));
+       }
+    return(0);
+  }
+/* read consecutive file sectors */
+int lif_read_img_blocks(int input_file, lif_blk_t first, int count, unsigned char *data)
+  {
+    HANDLE img_file_handle= get_img_handle(input_file);
+    BOOL read_ret;
+    DWORD NumberOfBytesRead;
+
+    if (img_file_handle== (HANDLE) NULL )
+       {
+          lif_set_error("Error: tried reading from a non existing file handle");
+          return(-1);
+       }
+
+    /* Go to the first block in the file */
+    if(! seek_block(img_file_handle,first))
+       {
+          return(win_error("Error: seek in LIF image file failed"));
+       }
+
+    /* Read all blocks */
+    read_ret= ReadFile(img_file_handle, data, (DWORD) (SECTOR_SIZE*count), &NumberOfBytesRead, NULL);
+    if(! read_ret) 
+       {
+          return(win_error("Error: read from LIF image file failed"));
+       }
+    if (NumberOfBytesRead != (DWORD) (SECTOR_SIZE*count))
+       {
+          return(win_error("Error: read from LIF image file failed"));
+       }
+    return(0);
+  }
+
+/* write consecutive file sectors */
+int lif_write_img_blocks(int output_file, lif_blk_t first, int count, unsigned char *data)
+  {
+    HANDLE img_file_handle= get_img_handle(output_file);
+    BOOL write_ret;
+    DWORD NumberOfBytesWritten;
+
+    if (img_file_handle== (HANDLE) NULL) 
+       {
+          lif_set_error("Error: tried writing to a non existing file handle");
+          return(-1);
+       }
+
+    /* Go to the first block in the file */
+    if(! seek_block(img_file_handle,first))
+       {
+          return(win_error("Error: write to LIF image file failed"));
+       }
+    debug_print("write to blocks %lld..%lld\n",first,first+count-1); 
+
+    /* Write all blocks */
+    write_ret= WriteFile(img_file_handle, data, (DWORD) (SECTOR_SIZE*count), &NumberOfBytesWritten, NULL);
+    if(! write_ret) 
+       {
+          return(win_error("Error: write to LIF image file failed"));
+       }
+    if (NumberOfBytesWritten != (DWORD) (SECTOR_SIZE*count))
+       {
+          return(win_error("Error: write to LIF image file failed"));
        }
+    return(0);
   }
-void exit_error(char * msg)
+static int win_error(char * msg)
 {
-	wchar_t buf[256];
-        FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM, NULL, GetLastError(), 
+	char buf[256];
+        FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, NULL, GetLastError(), 
               MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), buf, 256, NULL);
-	fprintf(stderr,"%s : %ls\n",msg,buf);
-	exit(1);
+	lif_set_error("%s : %s",msg,buf);
+	return(-1);
 }
@@ -0,0 +1,260 @@
+/* lif_map.c -- read/write a block (specified by logical block number)
+                to/from a memory mapped lif image file */
+/* 2026 placed under the GPL */
+
+/* The whole image file is mapped into memory when it is opened. Blocks
+   inside the mapping are transferred with memcpy, which saves the
+   lseek/read or lseek/write system calls per block. Blocks beyond the
+   end of the mapping (the image file was extended after it was opened)
+   are transferred with pread/pwrite */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "lif_const.h"
+#include "lif_map.h"
+#include "lif_error.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+            do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+/* maximum number of image files that can be mapped at the same time */
+#define MAX_MAPS 8
+
+static struct {
+         int fd;               /* file descriptor, -1 if slot unused */
+         unsigned char *base;  /* start of mapping or NULL */
+         size_t size;          /* size of mapping in bytes */
+         int dirty;            /* mapping was written to */
+         int prot;             /* protection of the mapping */
+   } maps[MAX_MAPS];
+
+static int maps_initialized=0;
+
+/* find the mapping of a file descriptor */
+static int find_map(int descriptor)
+  {
+     int i;
+
+     if(maps_initialized)
+       {
+         for(i=0; i< MAX_MAPS; i++)
+            if(maps[i].fd == descriptor) return(i);
+       }
+     lif_set_error("Error: file descriptor %d is not mapped",descriptor);
+     return(-1);
+  }
+
+/* map the whole file, only regular files which are not empty and fit
+   into the address space are mapped */
+static int map_file(int slot)
+  {
+      struct stat st;
+      void *base;
+
+      if(fstat(maps[slot].fd,&st) || ! S_ISREG(st.st_mode) ||
+         st.st_size < SECTOR_SIZE) return(-1);
+      if((unsigned long long) st.st_size > (unsigned long long) ((size_t) -1))
+         return(-1);
+      base=mmap(NULL,(size_t) st.st_size,maps[slot].prot,MAP_SHARED,
+                maps[slot].fd,(off_t) 0);
+      if(base == MAP_FAILED) return(-1);
+      debug_print("mapped %ld bytes\n",(long) st.st_size);
+      maps[slot].base= base;
+      maps[slot].size= (size_t) st.st_size;
+      maps[slot].dirty= 0;
+      return(0);
+  }
+
+/* open and map lif image file */
+int lif_open_map_file(char *filename, int flags, int mode)
+  {
+      int fd, slot, i;
+
+      /* a write only file cannot be mapped */
+      if((flags & O_ACCMODE) == O_WRONLY) return(-1);
+
+      if(! maps_initialized)
+        {
+          for(i=0; i< MAX_MAPS; i++) maps[i].fd= -1;
+          maps_initialized=1;
+        }
+      slot= -1;
+      for(i=0; i< MAX_MAPS; i++)
+        {
+          if(maps[i].fd == -1)
+            {
+              slot=i;
+              break;
+            }
+        }
+      if(slot == -1) return(-1);
+
+      fd=open(filename,flags,mode);
+      if(fd == -1) return(-1);
+
+      maps[slot].fd= fd;
+      maps[slot].base= NULL;
+      maps[slot].size= 0;
+      maps[slot].dirty= 0;
+      maps[slot].prot= ((flags & O_ACCMODE) == O_RDONLY) ?
+                       PROT_READ : PROT_READ|PROT_WRITE;
+      if(map_file(slot))
+        {
+          maps[slot].fd= -1;
+          close(fd);
+          return(-1);
+        }
+      return(fd);
+  }
+
+/* unmap the file, flush modifications to disk */
+static int unmap_file(int slot)
+  {
+      int iret;
+
+      iret=0;
+      if(maps[slot].base == NULL) return(0);
+      if(maps[slot].dirty)
+        {
+          if(msync(maps[slot].base,maps[slot].size,MS_SYNC))
+            {
+              lif_set_error("Error flushing file (%s)",strerror(errno));
+              iret= -1;
+            }
+        }
+      munmap(maps[slot].base,maps[slot].size);
+      maps[slot].base= NULL;
+      maps[slot].size= 0;
+      maps[slot].dirty= 0;
+      return(iret);
+  }
+
+/* close lif image file */
+int lif_close_map_file(int descriptor)
+  {
+      int slot, iret;
+
+      if((slot=find_map(descriptor)) == -1) return(-1);
+      iret=unmap_file(slot);
+      maps[slot].fd= -1;
+      if(close(descriptor))
+        {
+          lif_set_error("Error closing file (%s)",strerror(errno));
+          iret= -1;
+        }
+      return(iret);
+  }
+
+/* resize a lif image file, the file is mapped again with the new size */
+int lif_resize_map_file(int lif_file, lif_blk_t blocks)
+  {
+      int slot;
+
+      if((slot=find_map(lif_file)) == -1) return(-1);
+      if(unmap_file(slot)) return(-1);
+      if(ftruncate(lif_file,(off_t) SECTOR_SIZE * blocks))
+       {
+          lif_set_error("Error resizing file (%s)",strerror(errno));
+          return(-1);
+       }
+      /* if this fails, blocks are transferred with pread/pwrite */
+      map_file(slot);
+      return(0);
+  }
+
+/* truncate a lif image file */
+int lif_truncate_map_file(int lif_file)
+  {
+      return(lif_resize_map_file(lif_file,0));
+  }
+
+/* Read blocks from a mapped lif image file */
+int lif_read_map_blocks(int input_file, lif_blk_t first, int count, unsigned char *data)
+  {
+    int slot;
+    off_t offset;
+    size_t length;
+    ssize_t read_ret;
+
+    if((slot=find_map(input_file)) == -1) return(-1);
+    offset= (off_t) SECTOR_SIZE * first;
+    length= (size_t) SECTOR_SIZE * count;
+    debug_print("read blocks %lld..%lld\n",first,first+count-1);
+    if(offset + (off_t) length <= (off_t) maps[slot].size)
+      {
+        memcpy(data,maps[slot].base+offset,length);
+        return(0);
+      }
+    /* blocks are not in the mapped area */
+    read_ret=pread(input_file,data,length,offset);
+    if (read_ret== (ssize_t) -1)
+      {
+        lif_set_error("Error reading block %lld from file. (%s)",first,strerror(errno));
+        return(-1);
+      }
+    if (read_ret != (ssize_t) length)
+      {
+        lif_set_error("Premature end of sector %lld. %ld bytes read.", first+(lif_blk_t) (read_ret/SECTOR_SIZE), (long) (read_ret % SECTOR_SIZE));
+        return(-1);
+      }
+    return(0);
+  }
+
+/* Write blocks to a mapped lif image file */
+int lif_write_map_blocks(int output_file, lif_blk_t first, int count, unsigned char *data)
+  {
+    int slot;
+    off_t offset;
+    size_t length;
+    ssize_t write_ret;
+
+    if((slot=find_map(output_file)) == -1) return(-1);
+    /* a read only mapping would fault on memcpy */
+    if(! (maps[slot].prot & PROT_WRITE))
+      {
+        lif_set_error("Error writing block %lld to file (%s)",first,strerror(EBADF));
+        return(-1);
+      }
+    offset= (off_t) SECTOR_SIZE * first;
+    length= (size_t) SECTOR_SIZE * count;
+    debug_print("write to blocks %lld..%lld\n",first,first+count-1);
+    if(offset + (off_t) length <= (off_t) maps[slot].size)
+      {
+        memcpy(maps[slot].base+offset,data,length);
+        maps[slot].dirty= 1;
+        return(0);
+      }
+    /* blocks are not in the mapped area, this extends the file */
+    write_ret=pwrite(output_file,data,length,offset);
+    if(write_ret == (ssize_t) -1)
+      {
+        lif_set_error("Error writing block %lld from file (%s)",first,strerror(errno));
+        return(-1);
+      }
+    if (write_ret != (ssize_t) length)
+      {
+        lif_set_error("Premature end of sector %lld. %ld bytes written.", first+(lif_blk_t) (write_ret/SECTOR_SIZE), (long) (write_ret % SECTOR_SIZE));
+        return(-1);
+      }
+    return(0);
+  }
+
+/* Read one block from a mapped lif image file */
+int lif_read_map_block(int input_file, lif_blk_t block, unsigned char *data)
+  {
+    return(lif_read_map_blocks(input_file,block,1,data));
+  }
+
+/* Write one block to a mapped lif image file */
+int lif_write_map_block(int output_file, lif_blk_t block, unsigned char *data)
+  {
+    return(lif_write_map_blocks(output_file,block,1,data));
+  }
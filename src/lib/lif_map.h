@@ -0,0 +1,38 @@
+/* lif_map.h -- memory mapped access to a lif image file */
+/* 2026 placed under the GPL */
+
+#include "lif_const.h"
+
+/* The open functions return a descriptor, all other functions return 0 on
+   success. On error -1 is returned, see lif_error.h */
+
+int lif_open_map_file(char * filename, int flags, int mode);
+/* open an image file and map it into memory. Returns -1 if the file
+   cannot be opened or is not suitable for mapping (empty, write only or
+   not a regular file). In this case the caller should fall back to
+   lif_open_img_file */
+
+int lif_close_map_file(int fileno);
+/* flush the mapping with msync, unmap and close the file */
+
+int lif_read_map_block(int input_file, lif_blk_t block, unsigned char *data);
+/* Read a block from a mapped image file.  block is the
+   number to read, data points to a 256 byte buffer to receive it */
+
+int lif_write_map_block(int output_file, lif_blk_t block, unsigned char *data);
+/* write a file block to a mapped image file.  block is the
+   number to write, data points to a 256 byte buffer  */
+
+int lif_read_map_blocks(int input_file, lif_blk_t first, int count, unsigned char *data);
+/* Read count consecutive blocks starting at block first from a mapped
+   image file, data points to a buffer of count*256 bytes */
+
+int lif_write_map_blocks(int output_file, lif_blk_t first, int count, unsigned char *data);
+/* write count consecutive blocks starting at block first to a mapped
+   image file, data points to a buffer of count*256 bytes */
+
+int lif_truncate_map_file(int fileno);
+/* unmap and truncate an image file to zero length */
+
+int lif_resize_map_file(int fileno, lif_blk_t blocks);
+/* set the length of an image file to blocks and map it again */
@@ -0,0 +1,531 @@
+/* lif_ovl.c -- copy-on-write overlay over a read-only lif image file */
+/* 2026 placed under the GPL */
+
+/* Layout of an overlay file:
+
+   block 0:   header
+              bytes 0-7   magic "LIFOVRLY"
+              bytes 8-11  size of the overlay image in blocks
+              bytes 12-15 number of blocks which are read from the base
+                          image, blocks beyond read as zero
+              bytes 16-19 number of block groups
+              bytes 20-   absolute path of the base image file
+   block 1-:  block groups of 65 blocks. The first block of a group is a
+              map of 64 block numbers (MSB first), one for each of the
+              following 64 data blocks. Unused data blocks have the block
+              number 0xFFFFFFFF.
+
+   All numbers are stored MSB first like in the LIF directory, so an
+   overlay image has at most 0xFFFFFFFE blocks. The map is
+   held in memory together with a hash index from block number to data
+   block. The files are accessed with the lif_img functions, so overlays
+   work on all platforms */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "lif_const.h"
+#include "lif_img.h"
+#include "lif_ovl.h"
+#include "lif_dir_utils.h"
+#include "lif_create_entry.h"
+#include "lif_error.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+            do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+#define OVL_MAGIC "LIFOVRLY"
+#define OVL_PATH_OFFSET 20
+#define OVL_PATH_LEN (SECTOR_SIZE-OVL_PATH_OFFSET)
+#define GROUP_BLOCKS (SECTOR_SIZE/4)  /* data blocks per group */
+#define FREE_BLOCK 0xFFFFFFFFU
+
+/* maximum number of overlay files that can be open at the same time */
+#define MAX_OVLS 8
+
+#ifndef PATH_MAX
+#define PATH_MAX 1024
+#endif
+
+static struct {
+         int fd;               /* overlay file, -1 if slot unused */
+         int base_fd;          /* base image file */
+         lif_blk_t size;       /* image size in blocks */
+         lif_blk_t base_limit; /* blocks below are read from base */
+         int groups;           /* number of block groups */
+         int used;             /* number of used data blocks */
+         int free_hint;        /* start of search for a free data block */
+         unsigned int *map;    /* block numbers of all data blocks */
+         char *group_dirty;    /* map block of group must be written */
+         int *hash;            /* index of data blocks, -1 if empty */
+         int hash_size;        /* power of 2 */
+         int header_dirty;
+         char base[OVL_PATH_LEN];
+   } ovls[MAX_OVLS];
+
+static int ovls_initialized=0;
+
+/* find the slot of a descriptor */
+static int find_ovl(int descriptor)
+  {
+     int i;
+
+     if(ovls_initialized)
+       {
+         for(i=0; i< MAX_OVLS; i++)
+            if(ovls[i].fd == descriptor) return(i);
+       }
+     lif_set_error("Error: file descriptor %d is not an overlay",descriptor);
+     return(-1);
+  }
+
+/* block number of the data block of map entry e */
+static lif_blk_t data_block(int e)
+  {
+     return(1+ (lif_blk_t) (e/GROUP_BLOCKS)*(GROUP_BLOCKS+1) + 1 + (e % GROUP_BLOCKS));
+  }
+
+/* hash index */
+
+static unsigned int hash_of(unsigned int block, int hash_size)
+  {
+     return((block * 2654435761U) & (unsigned int) (hash_size-1));
+  }
+
+static int hash_find(int slot, lif_blk_t block)
+  {
+     unsigned int h;
+     int e;
+
+     h= hash_of((unsigned int) block,ovls[slot].hash_size);
+     while((e= ovls[slot].hash[h]) != -1)
+       {
+         if(ovls[slot].map[e] == (unsigned int) block) return(e);
+         h= (h+1) & (unsigned int) (ovls[slot].hash_size-1);
+       }
+     return(-1);
+  }
+
+static void hash_put(int slot, int e)
+  {
+     unsigned int h;
+
+     h= hash_of(ovls[slot].map[e],ovls[slot].hash_size);
+     while(ovls[slot].hash[h] != -1)
+        h= (h+1) & (unsigned int) (ovls[slot].hash_size-1);
+     ovls[slot].hash[h]= e;
+  }
+
+/* build the hash index from the map, the table is at most half full */
+static int hash_build(int slot)
+  {
+     int size, e, *hash;
+
+     size= 64;
+     while(size < 2*ovls[slot].used+2) size*=2;
+     hash= malloc(size*sizeof(int));
+     if(hash == NULL)
+       {
+         lif_set_error("Out of memory");
+         return(-1);
+       }
+     free(ovls[slot].hash);
+     ovls[slot].hash= hash;
+     ovls[slot].hash_size= size;
+     for(e=0; e< size; e++) hash[e]= -1;
+     for(e=0; e< ovls[slot].groups*GROUP_BLOCKS; e++)
+       {
+         if(ovls[slot].map[e] != FREE_BLOCK) hash_put(slot,e);
+       }
+     return(0);
+  }
+
+/* add a block group to the map */
+static int add_group(int slot)
+  {
+     unsigned int *map;
+     char *group_dirty;
+     int g, e;
+
+     g= ovls[slot].groups;
+     map= realloc(ovls[slot].map,(g+1)*GROUP_BLOCKS*sizeof(unsigned int));
+     if(map == NULL)
+       {
+         lif_set_error("Out of memory");
+         return(-1);
+       }
+     ovls[slot].map= map;
+     group_dirty= realloc(ovls[slot].group_dirty,g+1);
+     if(group_dirty == NULL)
+       {
+         lif_set_error("Out of memory");
+         return(-1);
+       }
+     ovls[slot].group_dirty= group_dirty;
+     for(e=g*GROUP_BLOCKS; e< (g+1)*GROUP_BLOCKS; e++) map[e]= FREE_BLOCK;
+     group_dirty[g]= 1;
+     ovls[slot].groups++;
+     ovls[slot].header_dirty= 1;
+     return(0);
+  }
+
+/* allocate a data block for block, returns the map entry or -1 */
+static int alloc_block(int slot, lif_blk_t block)
+  {
+     int e, n;
+
+     n= ovls[slot].groups*GROUP_BLOCKS;
+     for(e=ovls[slot].free_hint; e< n; e++)
+        if(ovls[slot].map[e] == FREE_BLOCK) break;
+     if(e == n)
+       {
+         if(add_group(slot)) return(-1);
+       }
+     ovls[slot].map[e]= (unsigned int) block;
+     ovls[slot].group_dirty[e/GROUP_BLOCKS]= 1;
+     ovls[slot].free_hint= e+1;
+     ovls[slot].used++;
+     if(2*ovls[slot].used >= ovls[slot].hash_size)
+       {
+         if(hash_build(slot)) return(-1);
+       }
+     else
+       {
+         hash_put(slot,e);
+       }
+     return(e);
+  }
+
+/* write the modified map blocks and the header */
+static int write_meta(int slot)
+  {
+     unsigned char data[SECTOR_SIZE];
+     int g, i;
+
+     for(g=0; g< ovls[slot].groups; g++)
+       {
+         if(! ovls[slot].group_dirty[g]) continue;
+         for(i=0; i< GROUP_BLOCKS; i++)
+            put_lif_int(data+4*i,4,ovls[slot].map[g*GROUP_BLOCKS+i]);
+         if(lif_write_img_block(ovls[slot].fd,1+g*(GROUP_BLOCKS+1),data))
+            return(-1);
+         ovls[slot].group_dirty[g]= 0;
+       }
+     if(ovls[slot].header_dirty)
+       {
+         memset(data,0,SECTOR_SIZE);
+         memcpy(data,OVL_MAGIC,8);
+         put_lif_int(data+8,4,(unsigned int) ovls[slot].size);
+         put_lif_int(data+12,4,(unsigned int) ovls[slot].base_limit);
+         put_lif_int(data+16,4,ovls[slot].groups);
+         strcpy((char *) data+OVL_PATH_OFFSET,ovls[slot].base);
+         if(lif_write_img_block(ovls[slot].fd,0,data)) return(-1);
+         ovls[slot].header_dirty= 0;
+       }
+     return(0);
+  }
+
+static void free_slot(int slot)
+  {
+     free(ovls[slot].map);
+     free(ovls[slot].group_dirty);
+     free(ovls[slot].hash);
+     ovls[slot].map= NULL;
+     ovls[slot].group_dirty= NULL;
+     ovls[slot].hash= NULL;
+     ovls[slot].fd= -1;
+  }
+
+int lif_is_ovl_file(char *filename)
+  {
+     FILE *fp;
+     char magic[8];
+     int iret;
+
+     fp=fopen(filename,"rb");
+     if(fp == NULL) return(0);
+     iret= fread(magic,1,8,fp) == 8 && memcmp(magic,OVL_MAGIC,8) == 0;
+     fclose(fp);
+     return(iret);
+  }
+
+int lif_get_ovl_base(char *filename, char *base, int size)
+  {
+     FILE *fp;
+     unsigned char data[SECTOR_SIZE];
+     int iret;
+
+     fp=fopen(filename,"rb");
+     if(fp == NULL) return(-1);
+     iret= -1;
+     if(fread(data,1,SECTOR_SIZE,fp) == SECTOR_SIZE &&
+        memcmp(data,OVL_MAGIC,8) == 0)
+       {
+         data[SECTOR_SIZE-1]= '\0';
+         if(strlen((char *) data+OVL_PATH_OFFSET) < (size_t) size)
+           {
+             strcpy(base,(char *) data+OVL_PATH_OFFSET);
+             iret= 0;
+           }
+       }
+     fclose(fp);
+     return(iret);
+  }
+
+int lif_create_ovl_file(char *filename, char *base)
+  {
+     char path[PATH_MAX];
+     unsigned char data[SECTOR_SIZE];
+     struct stat st;
+     int fd;
+
+#ifdef _WIN32
+     if(_fullpath(path,base,PATH_MAX) == NULL || stat(path,&st))
+#else
+     if(realpath(base,path) == NULL || stat(path,&st))
+#endif
+       {
+         lif_set_error("Cannot access base image %s",base);
+         return(-1);
+       }
+     if(strlen(path) >= OVL_PATH_LEN)
+       {
+         lif_set_error("Path of base image %s too long",path);
+         return(-1);
+       }
+     if(st.st_size/SECTOR_SIZE >= FREE_BLOCK)
+       {
+         lif_set_error("Base image %s too large for an overlay",path);
+         return(-1);
+       }
+     memset(data,0,SECTOR_SIZE);
+     memcpy(data,OVL_MAGIC,8);
+     put_lif_int(data+8,4,(unsigned int) (st.st_size/SECTOR_SIZE));
+     put_lif_int(data+12,4,(unsigned int) (st.st_size/SECTOR_SIZE));
+     put_lif_int(data+16,4,0);
+     strcpy((char *) data+OVL_PATH_OFFSET,path);
+     fd=lif_open_img_file(filename,O_CREAT | O_TRUNC | O_WRONLY | O_BINARY,
+                          S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+     if(fd == -1) return(-1);
+     if(lif_write_img_block(fd,0,data))
+       {
+         lif_close_img_file(fd);
+         return(-1);
+       }
+     return(lif_close_img_file(fd));
+  }
+
+int lif_open_ovl_file(char *filename, int flags, int mode)
+  {
+     unsigned char data[SECTOR_SIZE];
+     int fd, slot, i, j, g;
+
+     if(! ovls_initialized)
+       {
+         for(i=0; i< MAX_OVLS; i++) ovls[i].fd= -1;
+         ovls_initialized=1;
+       }
+     slot= -1;
+     for(i=0; i< MAX_OVLS; i++)
+       {
+         if(ovls[i].fd == -1)
+           {
+             slot=i;
+             break;
+           }
+       }
+     if(slot == -1)
+       {
+         lif_set_error("Too many open overlay files");
+         return(-1);
+       }
+
+     fd=lif_open_img_file(filename,flags & ~(O_CREAT | O_TRUNC),mode);
+     if(fd == -1) return(-1);
+     if(lif_read_img_block(fd,0,data)) goto fail_close;
+     if(memcmp(data,OVL_MAGIC,8) != 0)
+       {
+         lif_set_error("%s is not an overlay file",filename);
+         goto fail_close;
+       }
+     ovls[slot].fd= fd;
+     ovls[slot].size= get_lif_int(data+8,4);
+     ovls[slot].base_limit= get_lif_int(data+12,4);
+     ovls[slot].groups= 0;
+     ovls[slot].used= 0;
+     ovls[slot].free_hint= 0;
+     ovls[slot].header_dirty= 0;
+     data[SECTOR_SIZE-1]= '\0';
+     strcpy(ovls[slot].base,(char *) data+OVL_PATH_OFFSET);
+
+     /* read the maps of all block groups */
+     g= get_lif_int(data+16,4);
+     for(i=0; i< g; i++)
+       {
+         if(add_group(slot) ||
+            lif_read_img_block(fd,1+i*(GROUP_BLOCKS+1),data)) goto fail;
+         for(j=0; j< GROUP_BLOCKS; j++)
+           {
+             ovls[slot].map[i*GROUP_BLOCKS+j]= get_lif_int(data+4*j,4);
+             if(ovls[slot].map[i*GROUP_BLOCKS+j] != FREE_BLOCK)
+                ovls[slot].used++;
+           }
+         ovls[slot].group_dirty[i]= 0;
+       }
+     ovls[slot].header_dirty= 0;
+     if(hash_build(slot)) goto fail;
+
+     /* the base image is never written to */
+     ovls[slot].base_fd= lif_open_img_file(ovls[slot].base,O_RDONLY | O_BINARY,0);
+     if(ovls[slot].base_fd == -1)
+       {
+         lif_set_error("Error opening base image %s",ovls[slot].base);
+         goto fail;
+       }
+     debug_print("overlay %s: %lld blocks, %d modified\n",filename,
+                 ovls[slot].size,ovls[slot].used);
+     return(fd);
+
+fail:
+     free_slot(slot);
+fail_close:
+     lif_close_img_file(fd);
+     return(-1);
+  }
+
+int lif_close_ovl_file(int descriptor)
+  {
+     int slot, iret;
+
+     if((slot=find_ovl(descriptor)) == -1) return(-1);
+     iret=write_meta(slot);
+     if(lif_close_img_file(ovls[slot].base_fd)) iret= -1;
+     if(lif_close_img_file(descriptor)) iret= -1;
+     free_slot(slot);
+     return(iret);
+  }
+
+int lif_read_ovl_blocks(int input_file, lif_blk_t first, int count, unsigned char *data)
+  {
+     int slot, i, n, e;
+     lif_blk_t block;
+
+     if((slot=find_ovl(input_file)) == -1) return(-1);
+     if(first+count > ovls[slot].size)
+       {
+         lif_set_error("Premature end of sector %lld. 0 bytes read.",
+                       first > ovls[slot].size ? first : ovls[slot].size);
+         return(-1);
+       }
+     /* transfer runs of blocks which come from the same source */
+     for(i=0; i< count; i+=n)
+       {
+         block= first+i;
+         e= hash_find(slot,block);
+         n= 1;
+         if(e != -1)
+           {
+             while(i+n < count && hash_find(slot,block+n) == e+n &&
+                   (e+n) % GROUP_BLOCKS != 0) n++;
+             if(lif_read_img_blocks(input_file,data_block(e),n,
+                data+i*SECTOR_SIZE)) return(-1);
+           }
+         else if(block < ovls[slot].base_limit)
+           {
+             while(i+n < count && block+n < ovls[slot].base_limit &&
+                   hash_find(slot,block+n) == -1) n++;
+             if(lif_read_img_blocks(ovls[slot].base_fd,block,n,
+                data+i*SECTOR_SIZE)) return(-1);
+           }
+         else
+           {
+             while(i+n < count && hash_find(slot,block+n) == -1) n++;
+             memset(data+i*SECTOR_SIZE,0,n*SECTOR_SIZE);
+           }
+       }
+     return(0);
+  }
+
+int lif_write_ovl_blocks(int output_file, lif_blk_t first, int count, unsigned char *data)
+  {
+     int slot, i, n, e, f;
+
+     if((slot=find_ovl(output_file)) == -1) return(-1);
+     if(first+count >= FREE_BLOCK)
+       {
+         lif_set_error("Block %lld out of range of an overlay",first+count-1);
+         return(-1);
+       }
+     for(i=0; i< count; i+=n)
+       {
+         e= hash_find(slot,first+i);
+         if(e == -1 && (e= alloc_block(slot,first+i)) == -1) return(-1);
+         /* extend the run while the following blocks have consecutive
+            data blocks, free data blocks are allocated on the way */
+         n= 1;
+         while(i+n < count && (e+n) % GROUP_BLOCKS != 0)
+           {
+             f= hash_find(slot,first+i+n);
+             if(f == -1 && ovls[slot].map[e+n] == FREE_BLOCK)
+               {
+                 ovls[slot].free_hint= e+n;
+                 if((f= alloc_block(slot,first+i+n)) == -1) return(-1);
+               }
+             if(f != e+n) break;
+             n++;
+           }
+         if(lif_write_img_blocks(output_file,data_block(e),n,
+            data+i*SECTOR_SIZE)) return(-1);
+       }
+     if(first+count > ovls[slot].size)
+       {
+         ovls[slot].size= first+count;
+         ovls[slot].header_dirty= 1;
+       }
+     return(write_meta(slot));
+  }
+
+int lif_resize_ovl_file(int lif_file, lif_blk_t blocks)
+  {
+     int slot, e;
+
+     if((slot=find_ovl(lif_file)) == -1) return(-1);
+     if(blocks >= FREE_BLOCK)
+       {
+         lif_set_error("Size of %lld blocks out of range of an overlay",blocks);
+         return(-1);
+       }
+     for(e=0; e< ovls[slot].groups*GROUP_BLOCKS; e++)
+       {
+         if(ovls[slot].map[e] != FREE_BLOCK &&
+            ovls[slot].map[e] >= blocks)
+           {
+             ovls[slot].map[e]= FREE_BLOCK;
+             ovls[slot].group_dirty[e/GROUP_BLOCKS]= 1;
+             ovls[slot].used--;
+           }
+       }
+     ovls[slot].free_hint= 0;
+     if(ovls[slot].base_limit > blocks) ovls[slot].base_limit= blocks;
+     ovls[slot].size= blocks;
+     ovls[slot].header_dirty= 1;
+     if(hash_build(slot)) return(-1);
+     return(write_meta(slot));
+  }
+
+int lif_ovl_info(int fileno, char **base, lif_blk_t *size, int *modified)
+  {
+     int slot;
+
+     if((slot=find_ovl(fileno)) == -1) return(-1);
+     *base= ovls[slot].base;
+     *size= ovls[slot].size;
+     *modified= ovls[slot].used;
+     return(0);
+  }
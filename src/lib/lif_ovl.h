@@ -0,0 +1,43 @@
+/* lif_ovl.h -- copy-on-write overlay over a read-only lif image file */
+/* 2026 placed under the GPL */
+
+#include "lif_const.h"
+
+/* An overlay file stores the modified blocks of a base image file. The
+   base image file is never written to. The open function returns a
+   descriptor, all other functions return 0 on success. On error -1 is
+   returned, see lif_error.h */
+
+int lif_is_ovl_file(char *filename);
+/* returns 1 if filename is an overlay file, 0 otherwise */
+
+int lif_get_ovl_base(char *filename, char *base, int size);
+/* copy the path of the base image of the overlay file filename to base,
+   which has room for size characters. Returns -1 if filename is not an
+   overlay file */
+
+int lif_create_ovl_file(char *filename, char *base);
+/* create an empty overlay file for the image file base. The absolute
+   path of base is stored in the overlay file */
+
+int lif_open_ovl_file(char *filename, int flags, int mode);
+/* open an overlay file and its base image file */
+
+int lif_close_ovl_file(int fileno);
+/* update the overlay file and close both files */
+
+int lif_read_ovl_blocks(int input_file, lif_blk_t first, int count, unsigned char *data);
+/* Read count consecutive blocks starting at block first, blocks which
+   were not modified are read from the base image file */
+
+int lif_write_ovl_blocks(int output_file, lif_blk_t first, int count, unsigned char *data);
+/* write count consecutive blocks starting at block first to the
+   overlay file */
+
+int lif_resize_ovl_file(int fileno, lif_blk_t blocks);
+/* set the length of the overlay image to blocks. Modified blocks beyond
+   the new end are released, added blocks read as zero */
+
+int lif_ovl_info(int fileno, char **base, lif_blk_t *size, int *modified);
+/* get the base image file name, the image size and the number of
+   modified blocks of an overlay */
@@ -1,31 +1,42 @@
 /* lif_phy.h -- header file for physical LIF disk functions (LINUX) */
 /* 2000, 2015 A. R. Duell, J. Siebold and placed under the GPL */
 
+#include "lif_const.h"
+
+/* The open functions return a descriptor, all other functions return 0 on
+   success. On error -1 is returned, see lif_error.h */
+
 int lif_open_phy_device(char * devicename);
 /* open a physical device */
 
-void lif_close_phy_device(int device_id);
+int lif_close_phy_device(int device_id);
 /* close a physical device */
 
-void lif_read_phy_block(int input_device, int block, unsigned char *data);
+int lif_read_phy_block(int input_device, lif_blk_t block, unsigned char *data);
 /* read the logical block number block from input device and store the
    sector in the buffer *data */
 
-void lif_write_phy_block(int output_device, int block, unsigned char *data);
+int lif_write_phy_block(int output_device, lif_blk_t block, unsigned char *data);
 /* write the logical block number block to output device and get the
    sector from the buffer *data */
 
-void lif_recalibrate_phy_device(int device);
+int lif_read_phy_blocks(int input_device, lif_blk_t first, int count, unsigned char *data);
+/* read count consecutive logical blocks starting at block first */
+
+int lif_write_phy_blocks(int output_device, lif_blk_t first, int count, unsigned char *data);
+/* write count consecutive logical blocks starting at block first */
+
+int lif_recalibrate_phy_device(int device);
 /* recalibrare floppy, seek to sector 0 */
 
-void lif_seek_phy_device(int device, int cylinder);
+int lif_seek_phy_device(int device, int cylinder);
 /* seek to a specific cylinder on device */
 
-void lif_read_phy_device(int device, int cylinder, int head, int sector,
+int lif_read_phy_device(int device, int cylinder, int head, int sector,
               unsigned char *data);
 /* Read one sector from LIF disk to data[] array */
 
-void lif_write_phy_device(int device, int cylinder, int head, int sector,
+int lif_write_phy_device(int device, int cylinder, int head, int sector,
                unsigned char *data);
 /* Read one sector from data[] array to LIF disk*/
 
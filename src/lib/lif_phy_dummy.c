@@ -8,27 +8,43 @@
 
 
 #include<stdio.h>
+#include "lif_phy.h"
+#include "lif_error.h"
 
-int lif_open_phy_device(devicename)
+int lif_open_phy_device(char *devicename)
   {
     int device= -1;
-    fprintf(stderr,"Low level floppy disc access is not supported on this platform\n");
+    lif_set_error("Low level floppy disc access is not supported on this platform");
 
     return(device);
   }
 
-void lif_close_phy_device(descriptor)
+int lif_close_phy_device(int descriptor)
   {
+    return(0);
   }
 
-void lif_read_phy_block(int input_device, int block, unsigned char *data)
+int lif_read_phy_block(int input_device, lif_blk_t block, unsigned char *data)
   {
+    return(-1);
   }
 
-void lif_write_phy_block(int output_device, int block, unsigned char *data)
+int lif_write_phy_block(int output_device, lif_blk_t block, unsigned char *data)
   {
+    return(-1);
   }
 
-void lif_seek_phy_device(int device, int cylinder)
+int lif_read_phy_blocks(int input_device, lif_blk_t first, int count, unsigned char *data)
   {
+    return(-1);
+  }
+
+int lif_write_phy_blocks(int output_device, lif_blk_t first, int count, unsigned char *data)
+  {
+    return(-1);
+  }
+
+int lif_seek_phy_device(int device, int cylinder)
+  {
+    return(-1);
   }
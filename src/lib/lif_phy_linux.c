@@ -21,6 +21,7 @@
 #include <linux/fdreg.h>
 #include "lif_phy.h"
 #include "lif_const.h"
+#include "lif_error.h"
 
 /* Data rate selection code for 250kbps */
 #define RATE250 2
@@ -31,72 +32,150 @@
 #define FD_DD_READ 0x46
 
 
-static int current_cylinder;
+/* Geometry of an HP LIF disk */
+#define CYLINDERS 77
+#define HEADS 2
+#define SECTORS 16
+
+/* State of the open drives, looked up by descriptor */
+#define MAX_DRIVES 4
+
+static struct {
+         int in_use;           /* slot is in use */
+         int fd;               /* descriptor of the drive */
+         int cylinders;        /* geometry of the medium */
+         int heads;
+         int sectors;
+         int current_cylinder; /* cylinder the head is positioned on */
+   } drives[MAX_DRIVES];
+
+static int find_drive(int device)
+  {
+    int i;
+
+    for(i=0; i<MAX_DRIVES; i++)
+      {
+        if(drives[i].in_use && drives[i].fd == device) return(i);
+      }
+    lif_set_error("Error: device %d is not open",device);
+    return(-1);
+  }
 
 
 int lif_open_phy_device(char * devicename)
   {
-    int device;
+    int device, i;
 
+    for(i=0; i<MAX_DRIVES; i++)
+      {
+        if(! drives[i].in_use) break;
+      }
+    if(i == MAX_DRIVES)
+      {
+        lif_set_error("Too many open drives");
+        return(-1);
+      }
     device=open(devicename,3,0);
-    if(device != -1) 
+    if(device == -1) 
+    {
+       lif_set_error("%s",strerror(errno));
+       return(-1);
+    }
+    /* Move the drive head to cylinder 0 and set current_cylinder */
+    if(lif_recalibrate_phy_device(device))
     {
-       /* Move the drive head to cylinder 0 and set current_cylinder */
-       lif_recalibrate_phy_device(device);
-       current_cylinder=0;
+       close(device);
+       return(-1);
     }
+    drives[i].in_use=1;
+    drives[i].fd=device;
+    drives[i].cylinders=CYLINDERS;
+    drives[i].heads=HEADS;
+    drives[i].sectors=SECTORS;
+    drives[i].current_cylinder=0;
     return(device);
   }
 
-void lif_close_phy_device(descriptor)
+int lif_close_phy_device(int descriptor)
   {
+     int i;
+
+     if((i=find_drive(descriptor)) == -1) return(-1);
+     drives[i].in_use=0;
      close(descriptor);
+     return(0);
   }
 
-void lif_read_phy_block(int input_device, int block, unsigned char *data)
+int lif_read_phy_block(int input_device, lif_blk_t block, unsigned char *data)
   {
     /* Read one block from a physical LIF disk */
-    int cylinder, head, sector;
+    int cylinder, head, sector, i;
 
     /* Calculate where this block is on the disk */
-    cylinder=block/32;
-    head=(block/16)%2;
-    sector=(block%16)+1;
+    if((i=find_drive(input_device)) == -1) return(-1);
+    cylinder=(int) (block/(drives[i].heads*drives[i].sectors));
+    head=(int) ((block/drives[i].sectors)%drives[i].heads);
+    sector=(int) (block%drives[i].sectors)+1;
 
     /* If we're not on the right cylinder, go there */
-    if(cylinder!=current_cylinder)
+    if(cylinder!=drives[i].current_cylinder)
       {
-        lif_seek_phy_device(input_device,cylinder);
-        current_cylinder=cylinder;
+        if(lif_seek_phy_device(input_device,cylinder)) return(-1);
+        drives[i].current_cylinder=cylinder;
       }
 
     /* Now read the block */
-    lif_read_phy_device(input_device,cylinder,head,sector,data);
+    return(lif_read_phy_device(input_device,cylinder,head,sector,data));
   }
 
-void lif_write_phy_block(int output_device, int block, unsigned char *data)
+int lif_write_phy_block(int output_device, lif_blk_t block, unsigned char *data)
   {
     /* Read one block from a physical LIF disk */
-    int cylinder, head, sector;
+    int cylinder, head, sector, i;
   
     /* Calculate where this block is on the disk */
-    cylinder=block/32;
-    head=(block/16)%2;
-    sector=(block%16)+1;
+    if((i=find_drive(output_device)) == -1) return(-1);
+    cylinder=(int) (block/(drives[i].heads*drives[i].sectors));
+    head=(int) ((block/drives[i].sectors)%drives[i].heads);
+    sector=(int) (block%drives[i].sectors)+1;
     
     /* If we're not on the right cylinder, go there */
-    if(cylinder!=current_cylinder)
+    if(cylinder!=drives[i].current_cylinder)
       {
-        lif_seek_phy_device(output_device,cylinder);
-        current_cylinder=cylinder;
+        if(lif_seek_phy_device(output_device,cylinder)) return(-1);
+        drives[i].current_cylinder=cylinder;
       }
 
     /* Now write the block */
-    lif_write_phy_device(output_device,cylinder,head,sector,data);
+    return(lif_write_phy_device(output_device,cylinder,head,sector,data));
   }
 
+int lif_read_phy_blocks(int input_device, lif_blk_t first, int count, unsigned char *data)
+  {
+    /* Read consecutive blocks, the floppy controller transfers one
+       sector per command */
+    int i;
+
+    for(i=0; i<count; i++)
+      {
+        if(lif_read_phy_block(input_device,first+i,data+i*SECTOR_SIZE)) return(-1);
+      }
+    return(0);
+  }
+
+int lif_write_phy_blocks(int output_device, lif_blk_t first, int count, unsigned char *data)
+  {
+    /* Write consecutive blocks */
+    int i;
+
+    for(i=0; i<count; i++)
+      {
+        if(lif_write_phy_block(output_device,first+i,data+i*SECTOR_SIZE)) return(-1);
+      }
+    return(0);
+  }
 
-void lif_recalibrate_phy_device(int device)
+int lif_recalibrate_phy_device(int device)
   {
     struct floppy_raw_cmd cmd;
     struct floppy_struct  floppy;
@@ -104,21 +183,19 @@ void lif_recalibrate_phy_device(int device)
     
     if(ioctl(device,FDCLRPRM,NULL)<0)
       {
-         fprintf(stderr,"Error on resetting floppy parameters\n");
-         fprintf(stderr,"error= %s (%d)\n",strerror(errno),errno);
-         exit(1);
+         lif_set_error("Error on resetting floppy parameters (%s)",strerror(errno));
+         return(-1);
        }
     /* configure floppy */
-    floppy.size= 2464; /* total number of sectors */
-    floppy.sect= 16;   /* sectors per track */
-    floppy.head=2;     /* nr of heads */
-    floppy.track=77;   /* nr of tracks */
+    floppy.size= CYLINDERS*HEADS*SECTORS; /* total number of sectors */
+    floppy.sect= SECTORS;   /* sectors per track */
+    floppy.head=HEADS;     /* nr of heads */
+    floppy.track=CYLINDERS;   /* nr of tracks */
     floppy.stretch=0;  /* no double track steps, no swap sides, first sect=0 */
     if(ioctl(device,FDSETPRM,&floppy)<0)
       {
-         fprintf(stderr,"Error on configuring floppy parameters\n");
-         fprintf(stderr,"error= %s (%d)\n",strerror(errno),errno);
-         exit(1);
+         lif_set_error("Error on configuring floppy parameters (%s)",strerror(errno));
+         return(-1);
        }
     cmd.data=NULL;  /* pointer to data buffer */
     cmd.length=0;   /* length of DMA transfer */
@@ -129,13 +206,13 @@ void lif_recalibrate_phy_device(int device)
     cmd.cmd_count=2;  /* two bytes in the command */
     if(ioctl(device,FDRAWCMD,&cmd)<0)
       {
-         fprintf(stderr,"Error on recalibrate\n");
-         fprintf(stderr,"error= %s (%d)\n",strerror(errno),errno);
-         exit(1);
+         lif_set_error("Error on recalibrate (%s)",strerror(errno));
+         return(-1);
        }
+    return(0);
   }
 
-void lif_seek_phy_device(int device, int cylinder)
+int lif_seek_phy_device(int device, int cylinder)
   {
     struct floppy_raw_cmd cmd;
 
@@ -149,13 +226,13 @@ void lif_seek_phy_device(int device, int cylinder)
     cmd.cmd_count=3;
     if (ioctl(device,FDRAWCMD,&cmd)<0)
       {
-         fprintf(stderr,"Error on seek to cylinder %d\n",cylinder);
-         fprintf(stderr,"error= %s (%d)\n",strerror(errno),errno);
-         exit(1);
+         lif_set_error("Error on seek to cylinder %d (%s)",cylinder,strerror(errno));
+         return(-1);
       }
+    return(0);
   }
 
-void lif_read_phy_device(int device, int cylinder, int head, int sector, 
+int lif_read_phy_device(int device, int cylinder, int head, int sector, 
               unsigned char *data)
   {
     struct floppy_raw_cmd cmd;
@@ -176,14 +253,14 @@ void lif_read_phy_device(int device, int cylinder, int head, int sector,
     cmd.cmd_count=9;
     if ((ioctl(device,FDRAWCMD,&cmd)<0) || (cmd.reply[0] & 0xC0))
       {
-        fprintf(stderr,"Error reading cylinder %d, head %d, sector %d\n",
-                cylinder,head,sector);
-         fprintf(stderr,"error= %s (%d)\n",strerror(errno),errno);
-        exit(1);
+        lif_set_error("Error reading cylinder %d, head %d, sector %d (%s)",
+                cylinder,head,sector,strerror(errno));
+        return(-1);
       }
+    return(0);
   }
 
-void lif_write_phy_device(int device, int cylinder, int head, int sector, 
+int lif_write_phy_device(int device, int cylinder, int head, int sector, 
                unsigned char *data)
   {
     struct floppy_raw_cmd cmd;
@@ -204,10 +281,10 @@ void lif_write_phy_device(int device, int cylinder, int head, int sector,
     cmd.cmd_count=9;
     if ((ioctl(device,FDRAWCMD,&cmd)<0) || (cmd.reply[0] & 0xC0))
       {
-        fprintf(stderr,"Error writing cylinder %d, head %d, sector %d\n",
-                cylinder,head,sector);
-        fprintf(stderr,"error= %s (%d)\n",strerror(errno),errno);
-        exit(1);
+        lif_set_error("Error writing cylinder %d, head %d, sector %d (%s)",
+                cylinder,head,sector,strerror(errno));
+        return(-1);
       }
+    return(0);
   }
 
@@ -0,0 +1,163 @@
+/* lif_stream.c -- read a lif image from a non-seekable stream */
+/* 2026 placed under the GPL */
+
+/* Images which come from a pipe (e.g. a decompressor) are read with
+   stdio strictly forward. Only the blocks of one transfer are buffered,
+   skipped blocks are read into the buffer of the caller and discarded */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "lif_const.h"
+#include "lif_stream.h"
+#include "lif_error.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+            do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+/* maximum number of streams that can be open at the same time */
+#define MAX_STREAMS 4
+
+static struct {
+         FILE *fp;             /* stream, NULL if slot unused */
+         lif_blk_t pos;        /* number of the next block in the stream */
+   } streams[MAX_STREAMS];
+
+/* check the descriptor of a stream */
+static int find_stream(int descriptor)
+  {
+     if(descriptor < 0 || descriptor >= MAX_STREAMS ||
+        streams[descriptor].fp == NULL)
+       {
+         lif_set_error("Error: descriptor %d is not a stream",descriptor);
+         return(-1);
+       }
+     return(descriptor);
+  }
+
+int lif_is_stream_file(char *filename)
+  {
+     struct stat st;
+
+     if(strcmp(filename,"-") == 0) return(1);
+#ifdef S_ISFIFO
+     if(stat(filename,&st) == 0 && S_ISFIFO(st.st_mode)) return(1);
+#else
+     (void) st;
+#endif
+     return(0);
+  }
+
+int lif_open_stream_file(char *filename, int flags)
+  {
+     int slot;
+     FILE *fp;
+
+     if(flags & (O_WRONLY | O_RDWR))
+       {
+         lif_set_error("%s can only be read",filename);
+         return(-1);
+       }
+     for(slot=0; slot< MAX_STREAMS; slot++)
+       {
+         if(streams[slot].fp == NULL) break;
+       }
+     if(slot == MAX_STREAMS)
+       {
+         lif_set_error("Too many open streams");
+         return(-1);
+       }
+     if(strcmp(filename,"-") == 0)
+       {
+         SETMODE_STDIN_BINARY;
+         fp= stdin;
+       }
+     else
+       {
+         fp= fopen(filename,"rb");
+         if(fp == NULL)
+           {
+             lif_set_error("%s",strerror(errno));
+             return(-1);
+           }
+       }
+     streams[slot].fp= fp;
+     streams[slot].pos= 0;
+     return(slot);
+  }
+
+int lif_close_stream_file(int descriptor)
+  {
+     FILE *fp;
+
+     if(find_stream(descriptor) == -1) return(-1);
+     fp= streams[descriptor].fp;
+     streams[descriptor].fp= NULL;
+     if(fp != stdin && fclose(fp))
+       {
+         lif_set_error("Error closing stream (%s)",strerror(errno));
+         return(-1);
+       }
+     return(0);
+  }
+
+/* read the next count blocks of a stream */
+static int read_next(int slot, int count, unsigned char *data)
+  {
+     size_t length, read_ret;
+
+     length= (size_t) SECTOR_SIZE * count;
+     read_ret= fread(data,sizeof(unsigned char),length,streams[slot].fp);
+     if(read_ret != length)
+       {
+         if(ferror(streams[slot].fp))
+            lif_set_error("Error reading block %lld from stream. (%s)",
+                          streams[slot].pos,strerror(errno));
+         else
+            lif_set_error("Premature end of sector %lld. %ld bytes read.",
+                          streams[slot].pos+(lif_blk_t) (read_ret/SECTOR_SIZE),
+                          (long) (read_ret % SECTOR_SIZE));
+         return(-1);
+       }
+     streams[slot].pos+= count;
+     return(0);
+  }
+
+int lif_read_stream_blocks(int input_file, lif_blk_t first, int count, unsigned char *data)
+  {
+     int slot, n;
+
+     if((slot=find_stream(input_file)) == -1) return(-1);
+     if(count <= 0) return(0);
+     if(first < streams[slot].pos)
+       {
+         lif_set_error("Block %lld was already read from the stream",first);
+         return(-1);
+       }
+     /* skip blocks up to first, they are read into data and discarded */
+     while(streams[slot].pos < first)
+       {
+         n= count;
+         if(first-streams[slot].pos < count) n= (int) (first-streams[slot].pos);
+         debug_print("skip blocks %lld..%lld\n",streams[slot].pos,
+                     streams[slot].pos+n-1);
+         if(read_next(slot,n,data)) return(-1);
+       }
+     debug_print("read blocks %lld..%lld\n",first,first+count-1);
+     return(read_next(slot,count,data));
+  }
+
+int lif_write_stream_blocks(int output_file, lif_blk_t first, int count, unsigned char *data)
+  {
+     (void) count;
+     (void) data;
+     if(find_stream(output_file) == -1) return(-1);
+     lif_set_error("Cannot write block %lld to a stream",first);
+     return(-1);
+  }
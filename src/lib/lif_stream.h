@@ -0,0 +1,27 @@
+/* lif_stream.h -- read a lif image from a non-seekable stream */
+/* 2026 placed under the GPL */
+
+#include "lif_const.h"
+
+/* A stream is read strictly forward: blocks before the current position
+   cannot be read again, blocks which are skipped are read and discarded.
+   The block cache of lif_block.c holds recently read blocks, so the
+   volume header and the directory can be read again. The open function
+   returns a descriptor, all other functions return 0 on success. On error
+   -1 is returned, see lif_error.h */
+
+int lif_is_stream_file(char *filename);
+/* returns 1 if filename is "-" (standard input) or a pipe, 0 otherwise */
+
+int lif_open_stream_file(char *filename, int flags);
+/* open a stream for reading, flags must be O_RDONLY */
+
+int lif_close_stream_file(int fileno);
+/* close the stream, standard input is left open */
+
+int lif_read_stream_blocks(int input_file, lif_blk_t first, int count, unsigned char *data);
+/* Read count consecutive blocks starting at block first. first must
+   not be before the current position of the stream */
+
+int lif_write_stream_blocks(int output_file, lif_blk_t first, int count, unsigned char *data);
+/* always fails, streams are read only */
@@ -0,0 +1,181 @@
+/* lif_uring.c -- asynchronous block reads with the Linux io_uring interface */
+/* 2026 placed under the GPL */
+
+/* The ring is set up with the raw system calls, so liburing is not
+   required. Only one thread may use a ring at a time */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+/* linux/fs.h defines its own BLOCK_SIZE */
+#undef BLOCK_SIZE
+#include "lif_const.h"
+#include "lif_uring.h"
+#include "lif_error.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+            do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+/* the kernel updates the ring heads and tails concurrently */
+#define load_acquire(p)     __atomic_load_n(p,__ATOMIC_ACQUIRE)
+#define store_release(p,v)  __atomic_store_n(p,v,__ATOMIC_RELEASE)
+
+struct lif_uring {
+         int fd;                      /* ring descriptor */
+         unsigned to_submit;          /* queued, not yet submitted */
+         /* submission queue */
+         void *sq_ptr;
+         size_t sq_size;
+         unsigned *sq_head, *sq_tail, *sq_mask, *sq_entries, *sq_array;
+         struct io_uring_sqe *sqes;
+         size_t sqes_size;
+         /* completion queue, NULL if mapped together with the sq */
+         void *cq_ptr;
+         size_t cq_size;
+         unsigned *cq_head, *cq_tail, *cq_mask;
+         struct io_uring_cqe *cqes;
+   };
+
+struct lif_uring *lif_uring_init(int entries)
+  {
+     struct lif_uring *ring;
+     struct io_uring_params p;
+     unsigned char *cq;
+
+     ring= calloc(1,sizeof(struct lif_uring));
+     if(ring == NULL)
+       {
+         lif_set_error("Out of memory");
+         return(NULL);
+       }
+     memset(&p,0,sizeof(p));
+     ring->fd= (int) syscall(__NR_io_uring_setup,(unsigned) entries,&p);
+     if(ring->fd < 0)
+       {
+         lif_set_error("io_uring not available (%s)",strerror(errno));
+         free(ring);
+         return(NULL);
+       }
+     ring->sq_size= p.sq_off.array + p.sq_entries*sizeof(unsigned);
+     ring->cq_size= p.cq_off.cqes + p.cq_entries*sizeof(struct io_uring_cqe);
+     if(p.features & IORING_FEAT_SINGLE_MMAP)
+       {
+         if(ring->cq_size > ring->sq_size) ring->sq_size= ring->cq_size;
+       }
+     ring->sq_ptr= mmap(NULL,ring->sq_size,PROT_READ|PROT_WRITE,
+                        MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_SQ_RING);
+     if(ring->sq_ptr == MAP_FAILED) goto fail;
+     if(p.features & IORING_FEAT_SINGLE_MMAP)
+       {
+         cq= ring->sq_ptr;
+       }
+     else
+       {
+         ring->cq_ptr= mmap(NULL,ring->cq_size,PROT_READ|PROT_WRITE,
+                        MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_CQ_RING);
+         if(ring->cq_ptr == MAP_FAILED)
+           {
+             ring->cq_ptr= NULL;
+             goto fail;
+           }
+         cq= ring->cq_ptr;
+       }
+     ring->sqes_size= p.sq_entries*sizeof(struct io_uring_sqe);
+     ring->sqes= mmap(NULL,ring->sqes_size,PROT_READ|PROT_WRITE,
+                      MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_SQES);
+     if(ring->sqes == MAP_FAILED)
+       {
+         ring->sqes= NULL;
+         goto fail;
+       }
+     ring->sq_head= (unsigned *) ((unsigned char *) ring->sq_ptr+p.sq_off.head);
+     ring->sq_tail= (unsigned *) ((unsigned char *) ring->sq_ptr+p.sq_off.tail);
+     ring->sq_mask= (unsigned *) ((unsigned char *) ring->sq_ptr+p.sq_off.ring_mask);
+     ring->sq_entries= (unsigned *) ((unsigned char *) ring->sq_ptr+p.sq_off.ring_entries);
+     ring->sq_array= (unsigned *) ((unsigned char *) ring->sq_ptr+p.sq_off.array);
+     ring->cq_head= (unsigned *) (cq+p.cq_off.head);
+     ring->cq_tail= (unsigned *) (cq+p.cq_off.tail);
+     ring->cq_mask= (unsigned *) (cq+p.cq_off.ring_mask);
+     ring->cqes= (struct io_uring_cqe *) (cq+p.cq_off.cqes);
+     debug_print("io_uring with %u entries\n",p.sq_entries);
+     return(ring);
+
+fail:
+     lif_set_error("io_uring not available (%s)",strerror(errno));
+     if(ring->sq_ptr != MAP_FAILED) munmap(ring->sq_ptr,ring->sq_size);
+     if(ring->cq_ptr != NULL) munmap(ring->cq_ptr,ring->cq_size);
+     close(ring->fd);
+     free(ring);
+     return(NULL);
+  }
+
+void lif_uring_exit(struct lif_uring *ring)
+  {
+     munmap(ring->sqes,ring->sqes_size);
+     if(ring->cq_ptr != NULL) munmap(ring->cq_ptr,ring->cq_size);
+     munmap(ring->sq_ptr,ring->sq_size);
+     close(ring->fd);
+     free(ring);
+  }
+
+int lif_uring_read(struct lif_uring *ring, int fd, lif_blk_t first, int count,
+                   unsigned char *data, unsigned long tag)
+  {
+     unsigned tail, index;
+     struct io_uring_sqe *sqe;
+
+     tail= *ring->sq_tail;
+     if(tail - load_acquire(ring->sq_head) == *ring->sq_entries)
+       {
+         lif_set_error("io_uring submission queue full");
+         return(-1);
+       }
+     index= tail & *ring->sq_mask;
+     sqe= &ring->sqes[index];
+     memset(sqe,0,sizeof(struct io_uring_sqe));
+     sqe->opcode= IORING_OP_READ;
+     sqe->fd= fd;
+     sqe->off= (unsigned long long) SECTOR_SIZE * first;
+     sqe->addr= (unsigned long) data;
+     sqe->len= (unsigned) SECTOR_SIZE * count;
+     sqe->user_data= tag;
+     ring->sq_array[index]= index;
+     store_release(ring->sq_tail,tail+1);
+     ring->to_submit++;
+     return(0);
+  }
+
+int lif_uring_wait(struct lif_uring *ring, unsigned long *tag, int *result)
+  {
+     unsigned head;
+     struct io_uring_cqe *cqe;
+     int ret;
+
+     for(;;)
+       {
+         head= *ring->cq_head;
+         if(head != load_acquire(ring->cq_tail))
+           {
+             cqe= &ring->cqes[head & *ring->cq_mask];
+             *tag= (unsigned long) cqe->user_data;
+             *result= cqe->res;
+             store_release(ring->cq_head,head+1);
+             return(0);
+           }
+         ret= (int) syscall(__NR_io_uring_enter,ring->fd,ring->to_submit,1,
+                            IORING_ENTER_GETEVENTS,NULL,0);
+         if(ret < 0)
+           {
+             if(errno == EINTR) continue;
+             lif_set_error("io_uring_enter failed (%s)",strerror(errno));
+             return(-1);
+           }
+         ring->to_submit-= (unsigned) ret;
+       }
+  }
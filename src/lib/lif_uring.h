@@ -0,0 +1,28 @@
+/* lif_uring.h -- asynchronous block reads with the Linux io_uring interface */
+/* 2026 placed under the GPL */
+
+#include "lif_const.h"
+
+/* These functions are used by the asynchronous read functions of the
+   block layer (lif_aio_* in lif_block.h). Functions return 0 on success
+   and -1 on error, see lif_error.h */
+
+struct lif_uring;
+
+struct lif_uring *lif_uring_init(int entries);
+/* create a submission/completion ring for at least entries requests.
+   Returns NULL if io_uring is not supported by the running kernel */
+
+void lif_uring_exit(struct lif_uring *ring);
+/* release the ring, all requests must have been completed */
+
+int lif_uring_read(struct lif_uring *ring, int fd, lif_blk_t first, int count,
+                   unsigned char *data, unsigned long tag);
+/* queue a read of count blocks starting at block first of the file fd.
+   The request is identified by tag on completion. The request is
+   submitted to the kernel by the next call of lif_uring_wait */
+
+int lif_uring_wait(struct lif_uring *ring, unsigned long *tag, int *result);
+/* submit queued requests and wait for the completion of one request.
+   On return tag identifies the request and result is the number of bytes
+   read or a negative errno value */
@@ -89,6 +89,7 @@ their page number hardcoded.
 #include <limits.h>
 #include "config.h"
 #include "modfile.h"
+#include "lif_error.h"
 
 /******************************/
 word *read_rom_file(char *FullFileName)
@@ -102,7 +103,7 @@ word *read_rom_file(char *FullFileName)
   File=fopen(FullFileName,"rb");
   if (File==NULL)
     {
-    fprintf(stderr,"Error: File Open Failed: %s\n",FullFileName);
+    lif_set_error("File Open Failed: %s",FullFileName);
     return(NULL);
     }
   fseek(File,0,SEEK_END);
@@ -111,22 +112,21 @@ word *read_rom_file(char *FullFileName)
   if (FileSize!=8192)
     {
     fclose(File);
-    fprintf(stderr,"Error: File Size Invalid: %s\n",FullFileName);
-    fprintf(stderr,"  ROM file size is 8192 bytes");
+    lif_set_error("File Size Invalid: %s, ROM file size is 8192 bytes",FullFileName);
     return(NULL);
     }
   ROM=(word*)malloc(sizeof(word)*0x1000);
   if (ROM==NULL)
     {
     fclose(File);
-    fprintf(stderr,"Error: Memory Allocation\n");
+    lif_set_error("Memory Allocation");
     return(NULL);
     }
   SizeRead=fread(ROM,1,8192,File);
   fclose(File);
   if (SizeRead!=8192)
     {
-    fprintf(stderr,"Error: File Read Failed: %s\n",FullFileName);
+    lif_set_error("File Read Failed: %s",FullFileName);
     free(ROM);
     return(NULL);
     }
@@ -148,14 +148,14 @@ int write_rom_file(char *FullFileName,word *ROM)
   File=fopen(FullFileName,"wb");
   if (File==NULL)
     {
-    fprintf(stderr,"Error: File Open Failed: %s\n",FullFileName);
+    lif_set_error("File Open Failed: %s",FullFileName);
     return(0);
     }
   ROM2=(word*)malloc(sizeof(word)*0x1000);
   if (ROM2==NULL)
     {
     fclose(File);
-    fprintf(stderr,"Error: Memory Allocation\n");
+    lif_set_error("Memory Allocation");
     return(0);
     }
   for (i=0;i<0x1000;i++)
@@ -165,7 +165,7 @@ int write_rom_file(char *FullFileName,word *ROM)
   free(ROM2);
   if (SizeWritten!=8192)
     {
-    fprintf(stderr,"Error: File Write Failed: %s\n",FullFileName);
+    lif_set_error("File Write Failed: %s",FullFileName);
     return(0);
     }
   return(1);
@@ -183,7 +183,7 @@ word *read_bin_file(char *FullFileName,int Page)
   File=fopen(FullFileName,"rb");
   if (File==NULL)
     {
-    fprintf(stderr,"Error: File Open Failed: %s\n",FullFileName);
+    lif_set_error("File Open Failed: %s",FullFileName);
     return(NULL);
     }
   fseek(File,0,SEEK_END);
@@ -192,21 +192,21 @@ word *read_bin_file(char *FullFileName,int Page)
   if (FileSize%5120)
     {
     fclose(File);
-    fprintf(stderr,"Error: File Size Invalid: %s\n",FullFileName);
+    lif_set_error("File Size Invalid: %s",FullFileName);
     return(NULL);
     }
   BIN=(byte*)malloc(FileSize);
   if (BIN==NULL)
     {
     fclose(File);
-    fprintf(stderr,"Error: Memory Allocation\n");
+    lif_set_error("Memory Allocation");
     return(NULL);
     }
   SizeRead=fread(BIN,1,FileSize,File);
   fclose(File);
   if (SizeRead!=FileSize)
     {
-    fprintf(stderr,"Error: File Read Failed: %s\n",FullFileName);
+    lif_set_error("File Read Failed: %s",FullFileName);
     free(BIN);
     return(NULL);
     }
@@ -214,7 +214,7 @@ word *read_bin_file(char *FullFileName,int Page)
   ROM=(word*)malloc(sizeof(word)*0x1000);
   if (ROM==NULL)
     {
-    fprintf(stderr,"Error: Memory Allocation\n");
+    lif_set_error("Memory Allocation");
     return(NULL);
     }
   unpack_image(ROM,BIN+Page*5120);
@@ -234,14 +234,14 @@ int write_bin_file(char *FullFileName,word *ROM)
   File=fopen(FullFileName,"wb");
   if (File==NULL)
     {
-    fprintf(stderr,"Error: File Open Failed: %s\n",FullFileName);
+    lif_set_error("File Open Failed: %s",FullFileName);
     return(0);
     }
 
   BIN=(byte*)malloc(5120);
   if (BIN==NULL)
     {
-    fprintf(stderr,"Error: Memory Allocation\n");
+    lif_set_error("Memory Allocation");
     return(0);
     }
   pack_image(ROM,BIN);
@@ -250,7 +250,7 @@ int write_bin_file(char *FullFileName,word *ROM)
   free(BIN);
   if (SizeWritten!=5120)
     {
-    fprintf(stderr,"Error: File Write Failed: %s\n",FullFileName);
+    lif_set_error("File Write Failed: %s",FullFileName);
     return(0);
     }
   return(1);
@@ -268,13 +268,13 @@ word *read_lst_file(char *FullFileName)
   File=fopen(FullFileName,"rt");
   if (File==NULL)
     {
-    fprintf(stderr,"Error: File Open Failed: %s\n",FullFileName);
+    lif_set_error("File Open Failed: %s",FullFileName);
     return(NULL);
     }
   ROM=(word*)malloc(sizeof(word)*0x1000);
   if (ROM==NULL)
     {
-    fprintf(stderr,"Error: Memory Allocation\n");
+    lif_set_error("Memory Allocation");
     return(NULL);
     }
   i=0;
@@ -286,7 +286,7 @@ word *read_lst_file(char *FullFileName)
   fclose(File);
   if (i!=0x1000)
     {
-    fprintf(stderr,"Error: File Size Invalid: %s\n",FullFileName);
+    lif_set_error("File Size Invalid: %s",FullFileName);
     free(ROM);
     return(NULL);
     }
@@ -304,7 +304,7 @@ int write_lst_file(char *FullFileName,word *ROM,int Page)
   File=fopen(FullFileName,"wt");
   if (File==NULL)
     {
-    fprintf(stderr,"Error: File Open Failed: %s\n",FullFileName);
+    lif_set_error("File Open Failed: %s",FullFileName);
     return(0);
     }
 
@@ -395,8 +395,9 @@ int output_mod_info(
   MODFile=fopen(FullFileName,"rb");
   if (MODFile==NULL)
     {
+    lif_set_error("File open failed: %s",FullFileName);
     if (Verbose)
-      fprintf(OutFile,"Error: File open failed: %s\n",FullFileName);
+      fprintf(OutFile,"Error: %s\n",lif_errmsg());
     return(1);
     }
   fseek(MODFile,0,SEEK_END);
@@ -405,24 +406,27 @@ int output_mod_info(
   if ((FileSize-sizeof(ModuleFileHeader))%sizeof(ModuleFilePage))
     {
     fclose(MODFile);
+    lif_set_error("File size invalid: %s",FullFileName);
     if (Verbose)
-      fprintf(OutFile,"Error: File size invalid: %s\n",FullFileName);
+      fprintf(OutFile,"Error: %s\n",lif_errmsg());
     return(3);
     }
   pBuff=(byte*)malloc(FileSize);
   if (pBuff==NULL)
     {
     fclose(MODFile);
+    lif_set_error("Memory allocation");
     if (Verbose)
-      fprintf(OutFile,"Error: Memory allocation\n");
+      fprintf(OutFile,"Error: %s\n",lif_errmsg());
     return(4);
     }
   SizeRead=fread(pBuff,1,FileSize,MODFile);
   fclose(MODFile);
   if (SizeRead!=FileSize)
     {
+    lif_set_error("File read failed: %s",FullFileName);
     if (Verbose)
-      fprintf(OutFile,"Error: File read failed: %s\n",FullFileName);
+      fprintf(OutFile,"Error: %s\n",lif_errmsg());
     free(pBuff);
     return(2);
     }
@@ -431,23 +435,26 @@ int output_mod_info(
   pMFH=(ModuleFileHeader*)pBuff;
   if (FileSize!=sizeof(ModuleFileHeader)+pMFH->NumPages*sizeof(ModuleFilePage))
     {
+    lif_set_error("File size invalid: %s",FullFileName);
     if (Verbose)
-      fprintf(OutFile,"Error: File size invalid: %s\n",FullFileName);
+      fprintf(OutFile,"Error: %s\n",lif_errmsg());
     free(pBuff);
     return(3);
     }
   if (0!=strcmp(pMFH->FileFormat,MOD_FORMAT))
     {
+    lif_set_error("File type unknown: %s",FullFileName);
     if (Verbose)
-      fprintf(OutFile,"Error: File type unknown: %s\n",FullFileName);
+      fprintf(OutFile,"Error: %s\n",lif_errmsg());
     free(pBuff);
     return(3);
     }
   if (pMFH->MemModules>4 || pMFH->XMemModules>3 || pMFH->Original>1 || pMFH->AppAutoUpdate>1 ||
     pMFH->Category>CATEGORY_MAX || pMFH->Hardware>HARDWARE_MAX)    /* out of range */
     {
+    lif_set_error("Illegal value(s) in header: %s",FullFileName);
     if (Verbose)
-      fprintf(OutFile,"Error: llegal value(s) in header: %s\n",FullFileName);
+      fprintf(OutFile,"Error: %s\n",lif_errmsg());
     free(pBuff);
     return(3);
     }
@@ -738,11 +745,13 @@ int output_mod_info(
   }
 
 /******************************/
-/* Returns 0 for success, 1 for open fail, 2 for read fail, 3 for invalid file, 4 for allocation error */
+/* Returns 0 for success, 1 for open fail, 2 for read fail, 3 for invalid file, 4 for allocation error,
+   5 for write fail. The error message is available from lif_errmsg */
 /******************************/
 int extract_roms(
   char *FullFileName,
-  int LstForNSIM)
+  int LstForNSIM,
+  FILE *LogFile)         /* progress messages or NULL */
   {
   FILE *MODFile;
   unsigned long FileSize;
@@ -754,19 +763,24 @@ int extract_roms(
   /* open and read MOD file into a buffer */
   MODFile=fopen(FullFileName,"rb");
   if (MODFile==NULL)
+    {
+    lif_set_error("File open failed: %s",FullFileName);
     return(1);
+    }
   fseek(MODFile,0,SEEK_END);
   FileSize=ftell(MODFile);
   fseek(MODFile,0,SEEK_SET);
   if ((FileSize-sizeof(ModuleFileHeader))%sizeof(ModuleFilePage))
     {
     fclose(MODFile);
+    lif_set_error("File size invalid: %s",FullFileName);
     return(3);
     }
   pBuff=(byte*)malloc(FileSize);
   if (pBuff==NULL)
     {
     fclose(MODFile);
+    lif_set_error("Memory allocation");
     return(4);
     }
   SizeRead=fread(pBuff,1,FileSize,MODFile);
@@ -774,6 +788,7 @@ int extract_roms(
   if (SizeRead!=FileSize)
     {
     free(pBuff);
+    lif_set_error("File read failed: %s",FullFileName);
     return(2);
     }
 
@@ -782,17 +797,20 @@ int extract_roms(
   if (FileSize!=sizeof(ModuleFileHeader)+pMFH->NumPages*sizeof(ModuleFilePage))
     {
     free(pBuff);
+    lif_set_error("File size invalid: %s",FullFileName);
     return(3);
     }
   if (0!=strcmp(pMFH->FileFormat,MOD_FORMAT))
     {
     free(pBuff);
+    lif_set_error("File type unknown: %s",FullFileName);
     return(3);
     }
   if (pMFH->MemModules>4 || pMFH->XMemModules>3 || pMFH->Original>1 || pMFH->AppAutoUpdate>1 ||
     pMFH->Category>CATEGORY_MAX || pMFH->Hardware>HARDWARE_MAX)    /* out of range */
     {
     free(pBuff);
+    lif_set_error("Illegal value(s) in header: %s",FullFileName);
     return(3);
     }
 
@@ -810,12 +828,21 @@ int extract_roms(
        if (strchr("[]{}.<>|,;:#'\" -~+*\\?=()/&%",ROMFileName[j]) != (char *) NULL)
           ROMFileName[j]='_';
     }
-    fprintf(stderr,"extracting rom \"%s\" to %s\n",pMFP->Name,ROMFileName);
-    write_rom_file(ROMFileName,ROM);
+    if (LogFile)
+      fprintf(LogFile,"extracting rom \"%s\" to %s\n",pMFP->Name,ROMFileName);
+    if (!write_rom_file(ROMFileName,ROM))
+      {
+      free(pBuff);
+      return(5);
+      }
     if(LstForNSIM)
       {
       strcat(strcpy( ROMFileName, pMFP->Name), ".lst");
-      write_lst_file(ROMFileName,ROM,i);
+      if (!write_lst_file(ROMFileName,ROM,i))
+        {
+        free(pBuff);
+        return(5);
+        }
       }
     }
   free(pBuff);
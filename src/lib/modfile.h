@@ -117,7 +117,7 @@ int compare_rom_files(char *FullFileName1,char *FullFileName2);
 void unpack_image(word *ROM,byte *BIN);
 void pack_image(word *ROM,byte *BIN);
 int output_mod_info(FILE *OutFile,char *FullFileName,int Verbose,int DecodeFat,byte **OutputBuf);
-int extract_roms(char *FullFileName,int LstForNSIM);
+int extract_roms(char *FullFileName,int LstForNSIM,FILE *LogFile);
 word compute_checksum(word *ROM);
 void get_rom_id(word *ROM,char *ID);
 void decode_lcdchar(word lcdchar,char *ch,char *punct);
@@ -6,16 +6,19 @@
 #include <string.h>
 #include <stdlib.h>
 #include "config.h"
+#include "lif_error.h"
 
 #define DEBUG 0
 #define debug_print(fmt, ...) \
             do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
 
+#define MAX_XROM_IDS (32*64)
+
 static struct {
          char *name; /* Pointer to function name */
           int rom;   /* ROM ID */
           int fn;    /* Function ID */
-   } xrom_ids [32*64] ;
+   } xrom_ids [MAX_XROM_IDS] ;
 
 static int num_xrom_ids; /* Number of entries */
 
@@ -55,7 +58,7 @@ char * get_xrom_by_id(int mm, int ff)
       return((char *) NULL);
    }
    
-void read_xrom(char *name)
+int read_xrom(char *name)
   {
     /* Read in an XROM names file. This consists of lines, each consisting
        of 2 decimal numbers (ROM# and function#) and a name string, separated
@@ -102,14 +105,24 @@ void read_xrom(char *name)
     if(xrom_file == (FILE*) NULL)  {
         xrom_file=fopen(name,"r");
     }
-    if(xrom_file == (FILE*) NULL)  return;
+    /* a missing xrom file is not an error */
+    if(xrom_file == (FILE*) NULL)  return(0);
 
     while(fgets(line,80,xrom_file))
       {
         if(sscanf(line,"%d %d %39s",&rom,&fn,this_name)==3)
           {
+            if (num_xrom_ids == MAX_XROM_IDS) {
+                lif_set_error("Too many xrom entries in %s",filename);
+                fclose(xrom_file);
+                return(-1);
+            }
 	    buf=malloc ((strlen(this_name)+1)*sizeof(char));
-            if (buf == NULL) exit(0);
+            if (buf == NULL) {
+                lif_set_error("Out of memory");
+                fclose(xrom_file);
+                return(-1);
+            }
             strcpy(buf,this_name);
             xrom_ids[num_xrom_ids].name=buf;
             xrom_ids[num_xrom_ids].rom= rom;
@@ -119,5 +132,6 @@ void read_xrom(char *name)
       }
     /* close the file */
     fclose(xrom_file);
+    return(0);
   }
 
@@ -10,5 +10,5 @@ int get_xrom_by_name(char * alpha);
 char * get_xrom_by_id(int mm, int ff);
 /* lookup function name by rom id and function id */
    
-void read_xrom(char *name);
-/* load xrom files */
+int read_xrom(char *name);
+/* load xrom files, returns -1 on error, see lif_error.h */
@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "config.h"
 #include "comp41.h"
 #include "xrom.h"
+#include "lif_error.h"
 
 #define MAX_ARGS 5
 #define MAX_CODE 18
@@ -85,7 +86,7 @@ int main (int argc, char **argv)
         {
           case 'g' : force_global=1;
                      break;
-          case 'x' : read_xrom(optarg);
+          case 'x' : if (read_xrom(optarg)) lif_fatal();
                      break;
           case 'l' : line_numbers=1;
                      break;
@@ -220,6 +220,6 @@ char get_xdigit( char xdigit );
 
 void init_xrom(void);
 
-void read_xrom(char *name);
+int read_xrom(char *name);
 
 void compile_end( char *buffer, int bytes );
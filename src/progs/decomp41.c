@@ -18,6 +18,7 @@
 #include "config.h"
 #include"byte_tables41.h"
 #include "xrom.h"
+#include "lif_error.h"
 
 /* MEMORY_SIZE is set larger than the program memory of any real HP41 so that
    any program can be read into a suitable array of this size */
@@ -469,7 +470,7 @@ int main(int argc, char **argv)
           {
             case 'h' : hex_flag=1;
                        break;
-            case 'x' : read_xrom(optarg);
+            case 'x' : if (read_xrom(optarg)) lif_fatal();
                        break;
             case 'l' : line_flag=1;
                        break;
@@ -25,6 +25,7 @@
 #include <fcntl.h>
 #include "config.h"
 #include "xrom.h"
+#include "lif_error.h"
 #include "descramble_41.h"
 #include "byte_tables41.h"
 #include "byte_key_tables41.h"
@@ -576,7 +577,7 @@ int main(int argc, char **argv)
           {
             case 'h' : hex_flag=1;
                        break;
-            case 'x' : read_xrom(optarg);
+            case 'x' : if (read_xrom(optarg)) lif_fatal();
                        break;
             case '?' : usage();
           }
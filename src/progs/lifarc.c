@@ -0,0 +1,1046 @@
+/* lifarc.c -- deduplicating archive of LIF image files */
+/* 2026, placed under the GPL */
+
+/* An archive stores every distinct block sequence (payload) once, keyed
+   by its SHA-256 hash. An image is described by segments which cover all
+   its blocks in ascending order. A segment is either a file of the image
+   or a chunk of the remaining blocks (volume header, directory, unused
+   space). Integers are stored MSB first. Layout of an archive:
+
+   magic "LIFARC1\n"
+   payloads
+   catalog, for every image:
+      u32 name length, name, u64 image size in bytes,
+      u32 tail payload (bytes after the last complete block) or NO_PAYLOAD,
+      u32 number of segments, for every segment:
+         u64 first block, u64 blocks, u32 payload, u8 kind,
+         kind SEG_FILE: 32 byte directory entry of the file
+   payload table, for every payload:
+      32 byte hash, u64 offset, u64 length
+   trailer:
+      u64 catalog offset, u32 images, u64 table offset, u32 payloads,
+      magic "LIFARCND" */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <limits.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#include "config.h"
+#include "lif_block.h"
+#include "lif_error.h"
+#include "lif_dir_utils.h"
+#include "lif_create_entry.h"
+#include "lif_ovl.h"
+#include "lif_hash.h"
+#include "lif_const.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+   do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+#ifdef _WIN32
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#define make_dir(path) _mkdir(path)
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#define make_dir(path) mkdir(path,0777)
+#endif
+
+#define ARC_MAGIC   "LIFARC1\n"
+#define ARC_TRAILER "LIFARCND"
+#define TRAILER_SIZE 32
+#define NO_PAYLOAD  0xFFFFFFFFU
+
+/* blocks which do not belong to a file are stored in chunks of this
+   size, so unused space of the same contents is stored once */
+#define RAW_CHUNK 64
+
+#define SEG_RAW  0
+#define SEG_FILE 1
+
+/* smallest sizes of the records in an archive, used to check the counts
+   of a catalog against the size of the archive before they are used */
+#define PAYLOAD_RECORD (LIF_HASH_SIZE+16)
+#define IMAGE_RECORD   20
+#define SEGMENT_RECORD 21
+
+struct arc_payload {
+   unsigned char hash[LIF_HASH_SIZE];
+   long long offset;        /* position in the archive */
+   long long length;        /* bytes */
+};
+
+struct arc_segment {
+   lif_blk_t first;         /* first block in the image */
+   lif_blk_t blocks;        /* number of blocks */
+   unsigned int payload;    /* index in the payload table */
+   int kind;                /* SEG_RAW or SEG_FILE */
+   unsigned char entry[ENTRY_SIZE]; /* directory entry of a file */
+};
+
+struct arc_image {
+   char *name;              /* relative path of the image, see archive_name */
+   long long size;          /* size of the image file in bytes */
+   unsigned int tail;       /* payload of the incomplete last block */
+   int num_segments;
+   struct arc_segment *segments;
+};
+
+struct archive {
+   FILE *fp;
+   long long pos;           /* write position */
+   struct arc_payload *payloads;
+   unsigned int num_payloads;
+   unsigned int size_payloads;
+   unsigned int *hash;      /* payload index + 1 of hash slots, 0 if empty */
+   unsigned int hash_size;  /* power of 2 */
+   struct arc_image *images;
+   int num_images;
+   int size_images;
+   long long stored;        /* bytes of the payloads */
+   long long total;         /* bytes of all images */
+};
+
+void usage(void)
+  {
+    fprintf(stderr,"Usage: lifarc -c [-v] archive lif-image-file ...\n");
+    fprintf(stderr,"       lifarc -t [-v] archive [image ...]\n");
+    fprintf(stderr,"       lifarc -x [-d output-directory] archive [image ...]\n");
+    fprintf(stderr,"       lifarc -g [-r] [-b] [-d output-directory] archive image name ...\n");
+    fprintf(stderr,"\n");
+    fprintf(stderr,"      -c create an archive, archive - writes to standard output\n");
+    fprintf(stderr,"      -t list the images of an archive, with -v also their files\n");
+    fprintf(stderr,"      -x extract images\n");
+    fprintf(stderr,"      -g extract files of an image like lifget, name is a file\n");
+    fprintf(stderr,"         name, a pattern with * and ? or all\n");
+    fprintf(stderr,"      -r flag to remove directory entry on start of file\n");
+    fprintf(stderr,"      -b flag to copy the blocks used by the file,\n");
+    fprintf(stderr,"         ignoring the file length information\n");
+    fprintf(stderr,"      -d output directory, default is the current directory\n");
+    fprintf(stderr,"      -v report the stored and the saved space\n");
+    exit(1);
+  }
+
+void *xrealloc(void *p, size_t size)
+  {
+    p=realloc(p,size);
+    if(p == NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    return(p);
+  }
+
+/* integers MSB first */
+
+void put_u64(unsigned char *data, unsigned long long value)
+  {
+    int i;
+
+    for(i=7; i>=0; i--)
+      {
+        data[i]= (unsigned char) (value & 0xFF);
+        value>>=8;
+      }
+  }
+
+unsigned long long get_u64(unsigned char *data)
+  {
+    unsigned long long value;
+    int i;
+
+    value=0;
+    for(i=0; i<8; i++) value= (value << 8) | data[i];
+    return(value);
+  }
+
+/* archive output, the archive is written sequentially */
+
+void arc_write(struct archive *arc, const void *data, size_t len)
+  {
+    if(len == 0) return;
+    if(fwrite(data,1,len,arc->fp) != len)
+      {
+        fprintf(stderr,"Error writing archive\n");
+        exit(1);
+      }
+    arc->pos+= (long long) len;
+  }
+
+void arc_write_u32(struct archive *arc, unsigned int value)
+  {
+    unsigned char data[4];
+
+    put_lif_int(data,4,value);
+    arc_write(arc,data,4);
+  }
+
+void arc_write_u64(struct archive *arc, unsigned long long value)
+  {
+    unsigned char data[8];
+
+    put_u64(data,value);
+    arc_write(arc,data,8);
+  }
+
+/* payload table with a hash index */
+
+static unsigned int hash_slot(struct archive *arc, unsigned char *hash)
+  {
+    return(get_lif_int(hash,4) & (arc->hash_size-1));
+  }
+
+void index_payloads(struct archive *arc)
+  {
+    unsigned int i, h;
+
+    arc->hash_size= 1024;
+    while(arc->hash_size < 2*arc->num_payloads) arc->hash_size*=2;
+    free(arc->hash);
+    arc->hash=calloc(arc->hash_size,sizeof(unsigned int));
+    if(arc->hash == NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    for(i=0; i<arc->num_payloads; i++)
+      {
+        h=hash_slot(arc,arc->payloads[i].hash);
+        while(arc->hash[h]) h= (h+1) & (arc->hash_size-1);
+        arc->hash[h]= i+1;
+      }
+  }
+
+/* store a payload unless a payload with the same hash was already
+   stored. Returns the payload index */
+unsigned int put_payload(struct archive *arc, unsigned char *data, long long len)
+  {
+    struct lif_hash ctx;
+    unsigned char hash[LIF_HASH_SIZE];
+    struct arc_payload *p;
+    unsigned int h;
+
+    lif_hash_init(&ctx);
+    lif_hash_update(&ctx,data,(size_t) len);
+    lif_hash_final(&ctx,hash);
+    arc->total+= len;
+    h=hash_slot(arc,hash);
+    while(arc->hash[h])
+      {
+        if(memcmp(arc->payloads[arc->hash[h]-1].hash,hash,LIF_HASH_SIZE) == 0)
+           return(arc->hash[h]-1);
+        h= (h+1) & (arc->hash_size-1);
+      }
+    if(arc->num_payloads == arc->size_payloads)
+      {
+        arc->size_payloads= arc->size_payloads ? 2*arc->size_payloads : 1024;
+        arc->payloads=xrealloc(arc->payloads,
+                               arc->size_payloads*sizeof(struct arc_payload));
+      }
+    p= &arc->payloads[arc->num_payloads];
+    memcpy(p->hash,hash,LIF_HASH_SIZE);
+    p->offset=arc->pos;
+    p->length=len;
+    arc_write(arc,data,(size_t) len);
+    arc->stored+= len;
+    arc->hash[h]= ++arc->num_payloads;
+    if(2*arc->num_payloads > arc->hash_size) index_payloads(arc);
+    return(arc->num_payloads-1);
+  }
+
+struct arc_image *new_image(struct archive *arc)
+  {
+    struct arc_image *img;
+
+    if(arc->num_images == arc->size_images)
+      {
+        arc->size_images= arc->size_images ? 2*arc->size_images : 64;
+        arc->images=xrealloc(arc->images,
+                             arc->size_images*sizeof(struct arc_image));
+      }
+    img= &arc->images[arc->num_images++];
+    memset(img,0,sizeof(struct arc_image));
+    img->tail=NO_PAYLOAD;
+    return(img);
+  }
+
+/* name of an image in the archive: the path of the command line as a
+   relative path with / as separator. A drive, leading separators, leading
+   .. components and . components are removed. Returns NULL if the path
+   contains .. behind a directory name */
+char *archive_name(char *path)
+  {
+    char *name, *p, *component;
+    size_t len;
+
+    name=xrealloc(NULL,strlen(path)+1);
+    name[0]='\0';
+    if(((path[0] >= 'A' && path[0] <= 'Z') || (path[0] >= 'a' && path[0] <= 'z'))
+       && path[1] == ':') path+=2;
+    p=path;
+    while(*p)
+      {
+        component=p;
+        while(*p && *p != '/' && *p != '\\') p++;
+        len=(size_t) (p-component);
+        if(*p) p++;
+        if(len == 0 || (len == 1 && component[0] == '.')) continue;
+        if(len == 2 && component[0] == '.' && component[1] == '.')
+          {
+            if(name[0] == '\0') continue;
+            free(name);
+            return(NULL);
+          }
+        if(name[0]) strcat(name,"/");
+        strncat(name,component,len);
+      }
+    if(name[0] == '\0')
+      {
+        free(name);
+        return(NULL);
+      }
+    return(name);
+  }
+
+/* check an image name read from an archive, it must be a relative path
+   as made by archive_name, so it cannot point outside the output
+   directory */
+int valid_name(char *name)
+  {
+    char *p, *component;
+    size_t len;
+
+    if(name[0] == '\0' || strchr(name,'\\') != NULL ||
+       (name[0] != '\0' && name[1] == ':')) return(0);
+    p=name;
+    while(1)
+      {
+        component=p;
+        while(*p && *p != '/') p++;
+        len=(size_t) (p-component);
+        if(len == 0 || (len == 1 && component[0] == '.') ||
+           (len == 2 && component[0] == '.' && component[1] == '.')) return(0);
+        if(*p == '\0') break;
+        p++;
+      }
+    return(1);
+  }
+
+/* store the blocks first..first+blocks-1 of an image as one segment */
+void add_segment(struct archive *arc, struct arc_image *img, int device,
+                 lif_blk_t first, lif_blk_t blocks, unsigned char *entry,
+                 unsigned char **buf, long long *buf_size)
+  {
+    struct arc_segment *seg;
+    lif_blk_t block;
+    int count;
+
+    if(blocks <= 0) return;
+    if(blocks*SECTOR_SIZE > *buf_size)
+      {
+        *buf_size=blocks*SECTOR_SIZE;
+        *buf=xrealloc(*buf,(size_t) *buf_size);
+      }
+    for(block=0; block<blocks; block+=count)
+      {
+        count=IO_BLOCKS;
+        if(blocks-block < IO_BLOCKS) count=(int) (blocks-block);
+        if(lif_read_blocks(device,first+block,count,
+                           *buf+(size_t) block*SECTOR_SIZE)) lif_fatal();
+      }
+    img->segments=xrealloc(img->segments,
+                           (img->num_segments+1)*sizeof(struct arc_segment));
+    seg= &img->segments[img->num_segments++];
+    seg->first=first;
+    seg->blocks=blocks;
+    seg->payload=put_payload(arc,*buf,blocks*SECTOR_SIZE);
+    if(entry != NULL)
+      {
+        seg->kind=SEG_FILE;
+        memcpy(seg->entry,entry,ENTRY_SIZE);
+      }
+    else
+      {
+        seg->kind=SEG_RAW;
+        memset(seg->entry,0,ENTRY_SIZE);
+      }
+    debug_print("segment %lld..%lld payload %u\n",first,first+blocks-1,
+                seg->payload);
+  }
+
+/* store the blocks which do not belong to a file in chunks */
+void add_raw(struct archive *arc, struct arc_image *img, int device,
+             lif_blk_t first, lif_blk_t end, unsigned char **buf,
+             long long *buf_size)
+  {
+    lif_blk_t count;
+
+    for(; first<end; first+=count)
+      {
+        count= end-first < RAW_CHUNK ? end-first : RAW_CHUNK;
+        add_segment(arc,img,device,first,count,NULL,buf,buf_size);
+      }
+  }
+
+/* add an image file to the archive, returns -1 if it was not added */
+int add_image(struct archive *arc, char *path, unsigned char **buf,
+              long long *buf_size)
+  {
+    struct stat st;
+    struct arc_image *img;
+    struct lif_dir *dir;
+    int device, i;
+    lif_blk_t image_blocks, pos, start, end;
+    unsigned char tail[SECTOR_SIZE];
+    char *name;
+    FILE *fp;
+
+    if(stat(path,&st) || ! S_ISREG(st.st_mode) || lif_is_ovl_file(path))
+      {
+        fprintf(stderr,"%s is not an image file\n",path);
+        return(-1);
+      }
+    if((name=archive_name(path)) == NULL)
+      {
+        fprintf(stderr,"%s: the path must not contain ..\n",path);
+        return(-1);
+      }
+    for(i=0; i<arc->num_images; i++)
+      {
+        if(strcmp(arc->images[i].name,name) == 0)
+          {
+            fprintf(stderr,"Duplicate image name %s\n",name);
+            free(name);
+            return(-1);
+          }
+      }
+    if((device=lif_open(path,O_RDONLY | O_BINARY,0,0))==-1)
+      {
+        fprintf(stderr,"Error opening %s: %s\n",path,lif_errmsg());
+        free(name);
+        return(-1);
+      }
+    if((dir=lif_dir_open(device))==NULL)
+      {
+        fprintf(stderr,"%s: %s\n",path,lif_errmsg());
+        lif_close(device);
+        free(name);
+        return(-1);
+      }
+
+    img=new_image(arc);
+    img->name=name;
+    img->size=(long long) st.st_size;
+    image_blocks=img->size/SECTOR_SIZE;
+
+    /* files in the order of their start blocks. Files which overlap a
+       previous file or exceed the image are stored as raw blocks */
+    pos=0;
+    for(i=0; i<dir->files; i++)
+      {
+        start=dir->by_start[i].start;
+        end=start+dir->by_start[i].blocks;
+        if(start == end || start < pos || end > image_blocks) continue;
+        add_raw(arc,img,device,pos,start,buf,buf_size);
+        add_segment(arc,img,device,start,end-start,
+                    lif_dir_entry(dir,dir->by_start[i].slot),buf,buf_size);
+        pos=end;
+      }
+    add_raw(arc,img,device,pos,image_blocks,buf,buf_size);
+    lif_dir_close(dir);
+    if(lif_close(device)) lif_fatal();
+
+    /* bytes after the last complete block */
+    if(img->size % SECTOR_SIZE)
+      {
+        fp=fopen(path,"rb");
+        if(fp == NULL || fseek64(fp,image_blocks*SECTOR_SIZE,SEEK_SET) ||
+           fread(tail,1,(size_t) (img->size % SECTOR_SIZE),fp) !=
+           (size_t) (img->size % SECTOR_SIZE))
+          {
+            fprintf(stderr,"Error reading %s\n",path);
+            exit(1);
+          }
+        fclose(fp);
+        img->tail=put_payload(arc,tail,img->size % SECTOR_SIZE);
+      }
+    return(0);
+  }
+
+void write_catalog(struct archive *arc)
+  {
+    long long catalog_offset, table_offset;
+    struct arc_image *img;
+    struct arc_segment *seg;
+    unsigned char kind;
+    unsigned int i;
+    int j;
+
+    catalog_offset=arc->pos;
+    for(j=0; j<arc->num_images; j++)
+      {
+        img= &arc->images[j];
+        arc_write_u32(arc,(unsigned int) strlen(img->name));
+        arc_write(arc,img->name,strlen(img->name));
+        arc_write_u64(arc,(unsigned long long) img->size);
+        arc_write_u32(arc,img->tail);
+        arc_write_u32(arc,(unsigned int) img->num_segments);
+        for(i=0; i<(unsigned int) img->num_segments; i++)
+          {
+            seg= &img->segments[i];
+            arc_write_u64(arc,(unsigned long long) seg->first);
+            arc_write_u64(arc,(unsigned long long) seg->blocks);
+            arc_write_u32(arc,seg->payload);
+            kind=(unsigned char) seg->kind;
+            arc_write(arc,&kind,1);
+            if(seg->kind == SEG_FILE) arc_write(arc,seg->entry,ENTRY_SIZE);
+          }
+      }
+    table_offset=arc->pos;
+    for(i=0; i<arc->num_payloads; i++)
+      {
+        arc_write(arc,arc->payloads[i].hash,LIF_HASH_SIZE);
+        arc_write_u64(arc,(unsigned long long) arc->payloads[i].offset);
+        arc_write_u64(arc,(unsigned long long) arc->payloads[i].length);
+      }
+    arc_write_u64(arc,(unsigned long long) catalog_offset);
+    arc_write_u32(arc,(unsigned int) arc->num_images);
+    arc_write_u64(arc,(unsigned long long) table_offset);
+    arc_write_u32(arc,arc->num_payloads);
+    arc_write(arc,ARC_TRAILER,8);
+  }
+
+int create_archive(char *filename, char **paths, int num_paths, int verbose)
+  {
+    struct archive arc;
+    unsigned char *buf;
+    long long buf_size;
+    int i, errors;
+
+    memset(&arc,0,sizeof(arc));
+    if(strcmp(filename,"-") == 0)
+      {
+        SETMODE_STDOUT_BINARY;
+        arc.fp=stdout;
+      }
+    else if((arc.fp=fopen(filename,"wb")) == NULL)
+      {
+        fprintf(stderr,"can't open File %s\n",filename);
+        exit(2);
+      }
+    index_payloads(&arc);
+    arc_write(&arc,ARC_MAGIC,8);
+    buf=NULL;
+    buf_size=0;
+    errors=0;
+    for(i=0; i<num_paths; i++)
+      {
+        if(add_image(&arc,paths[i],&buf,&buf_size)) errors++;
+        else if(verbose) fprintf(stderr,"added %s\n",paths[i]);
+      }
+    free(buf);
+    write_catalog(&arc);
+    if(fflush(arc.fp) || (arc.fp != stdout && fclose(arc.fp)))
+      {
+        fprintf(stderr,"Error writing archive\n");
+        exit(1);
+      }
+    if(verbose)
+       fprintf(stderr,"%d images, %lld bytes, %lld bytes stored in %u payloads\n",
+               arc.num_images,arc.total,arc.stored,arc.num_payloads);
+    return(errors);
+  }
+
+/* archive input */
+
+void arc_read(struct archive *arc, void *data, size_t len)
+  {
+    if(fread(data,1,len,arc->fp) != len)
+      {
+        fprintf(stderr,"Error reading archive\n");
+        exit(1);
+      }
+  }
+
+unsigned int arc_read_u32(struct archive *arc)
+  {
+    unsigned char data[4];
+
+    arc_read(arc,data,4);
+    return(get_lif_int(data,4));
+  }
+
+unsigned long long arc_read_u64(struct archive *arc)
+  {
+    unsigned char data[8];
+
+    arc_read(arc,data,8);
+    return(get_u64(data));
+  }
+
+void invalid_archive(void)
+  {
+    fprintf(stderr,"This is not a valid lifarc archive\n");
+    exit(1);
+  }
+
+/* allocate an array of n+1 elements read from an archive */
+void *xalloc_array(unsigned long long n, size_t size)
+  {
+    if(n >= ((size_t) -1)/size) invalid_archive();
+    return(xrealloc(NULL,((size_t) n+1)*size));
+  }
+
+/* bytes left in the archive before the trailer */
+long long arc_left(struct archive *arc, long long end)
+  {
+    return(end-(long long) ftell64(arc->fp));
+  }
+
+/* read the catalog and the payload table of an archive. All counts and
+   offsets are checked against the size of the archive before they are
+   used, the archive may come from anywhere */
+void open_archive(struct archive *arc, char *filename)
+  {
+    unsigned char magic[8], trailer[TRAILER_SIZE];
+    long long catalog_offset, table_offset, end;
+    unsigned int num_segments;
+    struct arc_image *img;
+    struct arc_segment *seg;
+    unsigned int i, len, num_images;
+    unsigned char kind;
+    int j;
+
+    memset(arc,0,sizeof(struct archive));
+    if((arc->fp=fopen(filename,"rb")) == NULL)
+      {
+        fprintf(stderr,"can't open File %s\n",filename);
+        exit(2);
+      }
+    if(fread(magic,1,8,arc->fp) != 8 || memcmp(magic,ARC_MAGIC,8) ||
+       fseek64(arc->fp,-TRAILER_SIZE,SEEK_END) ||
+       fread(trailer,1,TRAILER_SIZE,arc->fp) != TRAILER_SIZE ||
+       memcmp(trailer+24,ARC_TRAILER,8)) invalid_archive();
+    end=(long long) ftell64(arc->fp)-TRAILER_SIZE;
+    catalog_offset=(long long) get_u64(trailer);
+    num_images=get_lif_int(trailer+8,4);
+    table_offset=(long long) get_u64(trailer+12);
+    arc->num_payloads=get_lif_int(trailer+20,4);
+    if(catalog_offset < 8 || catalog_offset > end ||
+       table_offset < 8 || table_offset > end ||
+       (long long) arc->num_payloads*PAYLOAD_RECORD > end-table_offset ||
+       (long long) num_images*IMAGE_RECORD > end-catalog_offset)
+       invalid_archive();
+
+    if(fseek64(arc->fp,table_offset,SEEK_SET)) invalid_archive();
+    arc->payloads=xalloc_array(arc->num_payloads,sizeof(struct arc_payload));
+    for(i=0; i<arc->num_payloads; i++)
+      {
+        arc_read(arc,arc->payloads[i].hash,LIF_HASH_SIZE);
+        arc->payloads[i].offset=(long long) arc_read_u64(arc);
+        arc->payloads[i].length=(long long) arc_read_u64(arc);
+        if(arc->payloads[i].offset < 8 || arc->payloads[i].length < 0 ||
+           arc->payloads[i].offset > end ||
+           arc->payloads[i].length > end-arc->payloads[i].offset)
+           invalid_archive();
+      }
+
+    if(fseek64(arc->fp,catalog_offset,SEEK_SET)) invalid_archive();
+    for(j=0; j<(int) num_images; j++)
+      {
+        img=new_image(arc);
+        len=arc_read_u32(arc);
+        if(len > 4096) invalid_archive();
+        img->name=xrealloc(NULL,len+1);
+        arc_read(arc,img->name,len);
+        img->name[len]='\0';
+        if(strlen(img->name) != len || ! valid_name(img->name))
+          {
+            fprintf(stderr,"Invalid image name %s in archive\n",img->name);
+            exit(1);
+          }
+        img->size=(long long) arc_read_u64(arc);
+        img->tail=arc_read_u32(arc);
+        num_segments=arc_read_u32(arc);
+        if(num_segments > INT_MAX ||
+           (long long) num_segments*SEGMENT_RECORD > arc_left(arc,end))
+           invalid_archive();
+        img->num_segments=(int) num_segments;
+        img->segments=xalloc_array(num_segments,sizeof(struct arc_segment));
+        for(i=0; i<num_segments; i++)
+          {
+            seg= &img->segments[i];
+            seg->first=(lif_blk_t) arc_read_u64(arc);
+            seg->blocks=(lif_blk_t) arc_read_u64(arc);
+            if(seg->first < 0 || seg->blocks < 0 ||
+               seg->blocks > end/SECTOR_SIZE) invalid_archive();
+            seg->payload=arc_read_u32(arc);
+            arc_read(arc,&kind,1);
+            seg->kind=kind;
+            if(seg->kind == SEG_FILE) arc_read(arc,seg->entry,ENTRY_SIZE);
+            if(seg->payload >= arc->num_payloads ||
+               arc->payloads[seg->payload].length != seg->blocks*SECTOR_SIZE)
+               invalid_archive();
+          }
+        if(img->tail != NO_PAYLOAD && img->tail >= arc->num_payloads)
+           invalid_archive();
+      }
+  }
+
+/* read a payload into buf */
+void read_payload(struct archive *arc, unsigned int payload,
+                  unsigned char **buf, long long *buf_size)
+  {
+    struct arc_payload *p;
+
+    p= &arc->payloads[payload];
+    if(p->length > *buf_size)
+      {
+        *buf_size=p->length;
+        *buf=xrealloc(*buf,(size_t) *buf_size);
+      }
+    if(fseek64(arc->fp,p->offset,SEEK_SET)) invalid_archive();
+    arc_read(arc,*buf,(size_t) p->length);
+  }
+
+/* image selected by the names of the command line, all without names */
+int selected(struct arc_image *img, char **names, int num_names, char *found)
+  {
+    int i, ret;
+
+    if(num_names == 0) return(1);
+    ret=0;
+    for(i=0; i<num_names; i++)
+      {
+        if(strcmp(img->name,names[i]) == 0)
+          {
+            found[i]=1;
+            ret=1;
+          }
+      }
+    return(ret);
+  }
+
+char *found_flags(int num_names)
+  {
+    char *found;
+
+    found=calloc(num_names+1,1);
+    if(found == NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    return(found);
+  }
+
+/* report image names of the command line which are not in the archive */
+int check_found(char **names, int num_names, char *found)
+  {
+    int i, errors;
+
+    errors=0;
+    for(i=0; i<num_names; i++)
+      {
+        if(found[i]) continue;
+        fprintf(stderr,"Image %s not found\n",names[i]);
+        errors++;
+      }
+    free(found);
+    return(errors);
+  }
+
+int list_archive(char *filename, char **names, int num_names, int verbose)
+  {
+    struct archive arc;
+    struct arc_image *img;
+    struct arc_segment *seg;
+    char *found;
+    char file_type[10];
+    char hex[LIF_HASH_HEX];
+    int i, j, length;
+
+    open_archive(&arc,filename);
+    found=found_flags(num_names);
+    for(i=0; i<arc.num_images; i++)
+      {
+        img= &arc.images[i];
+        if(! selected(img,names,num_names,found)) continue;
+        printf("%s %lld\n",img->name,img->size);
+        if(! verbose) continue;
+        for(j=0; j<img->num_segments; j++)
+          {
+            seg= &img->segments[j];
+            if(seg->kind != SEG_FILE) continue;
+            length=file_length(seg->entry,file_type);
+            lif_hash_hex(arc.payloads[seg->payload].hash,hex);
+            printf("   %.10s  %-10s %7d %6lld %6lld  %.16s\n",
+                   (char *) seg->entry,file_type,length,seg->first,
+                   seg->blocks,hex);
+          }
+      }
+    fclose(arc.fp);
+    return(check_found(names,num_names,found));
+  }
+
+/* path of an output file, existing files are not overwritten. The
+   directories of a relative image name are created below output_dir */
+char *output_path(char *output_dir, char *name)
+  {
+    char *path, *p;
+    struct stat st;
+
+    path=xrealloc(NULL,strlen(output_dir)+strlen(name)+2);
+    if(output_dir[0]) sprintf(path,"%s/%s",output_dir,name);
+    else strcpy(path,name);
+    for(p=path+strlen(path)-strlen(name); (p=strchr(p,'/')) != NULL; p++)
+      {
+        *p='\0';
+        if(make_dir(path) && errno != EEXIST)
+          {
+            fprintf(stderr,"can't create directory %s\n",path);
+            free(path);
+            return(NULL);
+          }
+        *p='/';
+      }
+    if(stat(path,&st) == 0)
+      {
+        fprintf(stderr,"%s already exists\n",path);
+        free(path);
+        return(NULL);
+      }
+    return(path);
+  }
+
+int extract_images(char *filename, char *output_dir, char **names,
+                   int num_names)
+  {
+    struct archive arc;
+    struct arc_image *img;
+    struct arc_segment *seg;
+    unsigned char *buf;
+    long long buf_size;
+    char *found, *path;
+    int i, j, device, errors, count;
+    lif_blk_t block;
+    FILE *fp;
+
+    open_archive(&arc,filename);
+    found=found_flags(num_names);
+    buf=NULL;
+    buf_size=0;
+    errors=0;
+    for(i=0; i<arc.num_images; i++)
+      {
+        img= &arc.images[i];
+        if(! selected(img,names,num_names,found)) continue;
+        if((path=output_path(output_dir,img->name)) == NULL)
+          {
+            errors++;
+            continue;
+          }
+        if((device=lif_open(path,O_CREAT | O_BINARY | O_TRUNC | O_WRONLY,S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH,0))==-1)
+          {
+            fprintf(stderr,"Error opening %s: %s\n",path,lif_errmsg());
+            exit(1);
+          }
+        for(j=0; j<img->num_segments; j++)
+          {
+            seg= &img->segments[j];
+            read_payload(&arc,seg->payload,&buf,&buf_size);
+            for(block=0; block<seg->blocks; block+=count)
+              {
+                count=IO_BLOCKS;
+                if(seg->blocks-block < IO_BLOCKS) count=(int) (seg->blocks-block);
+                if(lif_write_blocks(device,seg->first+block,count,
+                                    buf+(size_t) block*SECTOR_SIZE)) lif_fatal();
+              }
+          }
+        if(lif_close(device)) lif_fatal();
+        if(img->tail != NO_PAYLOAD)
+          {
+            read_payload(&arc,img->tail,&buf,&buf_size);
+            fp=fopen(path,"ab");
+            if(fp == NULL ||
+               fwrite(buf,1,(size_t) arc.payloads[img->tail].length,fp) !=
+               (size_t) arc.payloads[img->tail].length || fclose(fp))
+              {
+                fprintf(stderr,"Error writing %s\n",path);
+                exit(1);
+              }
+          }
+        free(path);
+      }
+    free(buf);
+    fclose(arc.fp);
+    return(errors+check_found(names,num_names,found));
+  }
+
+int get_files(char *filename, char *output_dir, char *image, char **names,
+              int num_names, int remove_dir_flag, int block_flag)
+  {
+    struct archive arc;
+    struct arc_image *img;
+    struct arc_segment *seg;
+    unsigned char *buf;
+    long long buf_size, length;
+    char *found, *path;
+    char name[NAME_LEN+1];
+    int i, j, len, errors, match;
+    FILE *fp;
+
+    for(i=0; i<num_names; i++)
+      {
+        if(strcmp(names[i],"all") && strpbrk(names[i],"*?") == NULL &&
+           check_filename(names[i])==0)
+          {
+            fprintf(stderr,"Illegal file name %s\n",names[i]);
+            exit(1);
+          }
+      }
+    open_archive(&arc,filename);
+    img=NULL;
+    for(i=0; i<arc.num_images; i++)
+      {
+        if(strcmp(arc.images[i].name,image) == 0) img= &arc.images[i];
+      }
+    if(img == NULL)
+      {
+        fprintf(stderr,"Image %s not found\n",image);
+        exit(2);
+      }
+    found=found_flags(num_names);
+    buf=NULL;
+    buf_size=0;
+    errors=0;
+    for(j=0; j<img->num_segments; j++)
+      {
+        seg= &img->segments[j];
+        if(seg->kind != SEG_FILE) continue;
+        match=0;
+        for(i=0; i<num_names; i++)
+          {
+            if(strcmp(names[i],"all") && !match_name(names[i],(char *) seg->entry))
+               continue;
+            found[i]=1;
+            match=1;
+          }
+        if(! match) continue;
+
+        /* the output file is named like the LIF file */
+        for(len=NAME_LEN; len>0 && seg->entry[len-1]==' '; len--) ;
+        sprintf(name,"%.*s",len,(char *) seg->entry);
+        if(check_filename(name) == 0)
+          {
+            fprintf(stderr,"Illegal file name %s in archive\n",name);
+            errors++;
+            continue;
+          }
+        if((path=output_path(output_dir,name)) == NULL)
+          {
+            errors++;
+            continue;
+          }
+        if(block_flag) length=seg->blocks*SECTOR_SIZE;
+        else length=file_length(seg->entry,NULL);
+        if(length > seg->blocks*SECTOR_SIZE) length=seg->blocks*SECTOR_SIZE;
+        if(length < 0) length=0;
+        read_payload(&arc,seg->payload,&buf,&buf_size);
+        fp=fopen(path,"wb");
+        if(fp == NULL)
+          {
+            fprintf(stderr,"can't open File %s\n",path);
+            exit(2);
+          }
+        if(! remove_dir_flag) fwrite(seg->entry,1,ENTRY_SIZE,fp);
+        fwrite(buf,1,(size_t) length,fp);
+        if(fclose(fp))
+          {
+            fprintf(stderr,"Error writing %s\n",path);
+            exit(1);
+          }
+        free(path);
+      }
+    free(buf);
+    fclose(arc.fp);
+    for(i=0; i<num_names; i++)
+      {
+        if(found[i] || strcmp(names[i],"all") == 0) continue;
+        fprintf(stderr,"File %s not found\n",names[i]);
+        errors++;
+      }
+    free(found);
+    return(errors);
+  }
+
+int main(int argc, char **argv)
+  {
+    int option; /* Command line option character */
+    int mode; /* c, t, x or g */
+    int verbose, remove_dir_flag, block_flag;
+    char *output_dir;
+    int errors;
+
+    /* Process command line options */
+    optind=1;
+    mode=0;
+    verbose=0;
+    remove_dir_flag=0;
+    block_flag=0;
+    output_dir="";
+    while ((option=getopt(argc,argv,"ctxgvrbd:?"))!=-1)
+      {
+        switch(option)
+          {
+            case 'c' :
+            case 't' :
+            case 'x' :
+            case 'g' : if (mode != 0) usage();
+                       mode=option;
+                       break;
+            case 'v' : verbose=1;
+                       break;
+            case 'r' : remove_dir_flag=1;
+                       break;
+            case 'b' : block_flag=1;
+                       break;
+            case 'd' : output_dir=optarg;
+                       break;
+            case '?' : usage();
+                       break;
+          }
+      }
+    if(optind > argc-1) usage();
+    switch(mode)
+      {
+        case 'c' : if(optind > argc-2) usage();
+                   errors=create_archive(argv[optind],argv+optind+1,
+                                         argc-optind-1,verbose);
+                   break;
+        case 't' : errors=list_archive(argv[optind],argv+optind+1,
+                                       argc-optind-1,verbose);
+                   break;
+        case 'x' : errors=extract_images(argv[optind],output_dir,
+                                         argv+optind+1,argc-optind-1);
+                   break;
+        case 'g' : if(optind > argc-3) usage();
+                   errors=get_files(argv[optind],output_dir,argv[optind+1],
+                                    argv+optind+2,argc-optind-2,
+                                    remove_dir_flag,block_flag);
+                   break;
+        default  : usage();
+                   errors=0;
+      }
+    exit(errors ? 2 : 0);
+  }
@@ -0,0 +1,405 @@
+/* lifbuild.c -- build a LIF image file from a manifest of host files */
+/* 2026, placed under the GPL */
+
+/* The manifest has one line per file with the fields
+
+   host-file  LIF-name  type  [implementation]
+
+   separated by blanks or tabs. The type is a type name like TEXT or
+   SDATA or a type code like 0xE0D0, the implementation bytes are the
+   bytes 26..31 of the directory entry as 12 hex digits, as lifdir -j
+   shows them. Empty lines and lines starting with # are ignored.
+
+   All manifest entries are checked and the whole layout is computed
+   before anything is written. The image is then written front to back in
+   one sequential stream: the volume header, the directory and the files
+   in manifest order without gaps, so it may go to standard output. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "lif_dir_utils.h"
+#include "lif_create_entry.h"
+#include "lif_const.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+   do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+/* a file of the new image */
+struct build_file {
+   char *path;                 /* host file */
+   int line;                   /* line of the manifest */
+   long long length;           /* file length in bytes */
+   unsigned char entry[ENTRY_SIZE]; /* directory entry of the file */
+};
+
+static char *remove_name;      /* incomplete output image */
+
+void usage(void)
+  {
+    fprintf(stderr,"Usage: lifbuild -m mediumtype [-n directorysize] [-l label] [-z] [-v]\n");
+    fprintf(stderr,"       manifest lif-image-file\n");
+    fprintf(stderr,"\n");
+    fprintf(stderr,"      -m medium type (cass | disk | hdrive1 | hdrive2 | hdrive4 |\n");
+    fprintf(stderr,"         hdrive8 | hdrive16)\n");
+    fprintf(stderr,"      -n number of directory entries, default is the number of files\n");
+    fprintf(stderr,"         rounded up to a full directory block\n");
+    fprintf(stderr,"      -l volume label\n");
+    fprintf(stderr,"      -z extend the image to the full medium size\n");
+    fprintf(stderr,"      -v list the files on standard error\n");
+    fprintf(stderr,"      manifest lines: host-file LIF-name type [implementation]\n");
+    fprintf(stderr,"      a file name - is standard input or standard output\n");
+    exit(1);
+  }
+
+void *xmalloc(size_t size)
+  {
+    void *p;
+
+    if((p=malloc(size)) == NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    return(p);
+  }
+
+/* remove the incomplete image if the program exits with an error */
+void remove_output(void)
+  {
+    if(remove_name != NULL) remove(remove_name);
+  }
+
+void manifest_error(char *manifest, int line, char *msg, char *field)
+  {
+    fprintf(stderr,"%s line %d: %s %s\n",manifest,line,msg,field);
+    exit(2);
+  }
+
+/* parse the implementation bytes, 12 hex digits */
+int parse_impl(char *hex, unsigned char *data)
+  {
+    int i;
+    unsigned int byte;
+
+    if(strlen(hex) != 12 || strspn(hex,"0123456789ABCDEFabcdef") != 12)
+       return(-1);
+    for(i=0; i<6; i++)
+      {
+        sscanf(hex+2*i,"%2x",&byte);
+        data[i]=(unsigned char) byte;
+      }
+    return(0);
+  }
+
+/* read the manifest and check every file. Returns the number of files */
+int read_manifest(char *manifest, struct build_file **files)
+  {
+    FILE *fp;
+    char *line, *path, *name, *type, *impl, *extra, *end;
+    size_t len;
+    ssize_t read;
+    int line_no, num_files, alloc_files;
+    long type_code;
+    struct stat st;
+    struct build_file *f;
+
+    if(strcmp(manifest,"-") == 0) fp=stdin;
+    else if((fp=fopen(manifest,"r")) == NULL)
+      {
+        fprintf(stderr,"can't open File %s\n",manifest);
+        exit(2);
+      }
+    *files=NULL;
+    num_files=0;
+    alloc_files=0;
+    line=NULL;
+    len=0;
+    line_no=0;
+    while((read=getline(&line,&len,fp)) != -1)
+      {
+        line_no++;
+        while(read > 0 && (line[read-1] == '\n' || line[read-1] == '\r'))
+           line[--read]='\0';
+        path=strtok(line," \t");
+        if(path == NULL || *path == '#') continue;
+        name=strtok(NULL," \t");
+        type=strtok(NULL," \t");
+        impl=strtok(NULL," \t");
+        extra=strtok(NULL," \t");
+        if(type == NULL || extra != NULL)
+           manifest_error(manifest,line_no,"expected host-file LIF-name type [implementation]","");
+
+        if(num_files == alloc_files)
+          {
+            alloc_files=2*alloc_files+64;
+            *files=realloc(*files,alloc_files*sizeof(struct build_file));
+            if(*files == NULL)
+              {
+                fprintf(stderr,"Out of memory\n");
+                exit(1);
+              }
+          }
+        f=(*files)+num_files;
+        f->line=line_no;
+        if((f->path=strdup(path)) == NULL)
+          {
+            fprintf(stderr,"Out of memory\n");
+            exit(1);
+          }
+
+        if(check_filename(name) == 0)
+           manifest_error(manifest,line_no,"illegal file name",name);
+        type_code=get_filetype(type);
+        if(type_code == -1)
+          {
+            type_code=strtol(type,&end,0);
+            if(*end != '\0' || type_code <= 0 || type_code > 0xFFFE)
+               manifest_error(manifest,line_no,"illegal file type",type);
+          }
+
+        /* the host file */
+        if(stat(path,&st) != 0 || !S_ISREG(st.st_mode))
+           manifest_error(manifest,line_no,"can't open File",path);
+        f->length=(long long) st.st_size;
+        if(f->length > 0x7FFFFFFFLL)
+           manifest_error(manifest,line_no,"file too large",path);
+
+        create_entry(f->entry,name,(unsigned int) type_code,0,
+                     (unsigned int) f->length,0);
+        if(impl != NULL && parse_impl(impl,f->entry+26))
+           manifest_error(manifest,line_no,"illegal implementation bytes",impl);
+        debug_print("%s %.*s type %lx length %lld\n",path,NAME_LEN,
+                    (char *) f->entry,type_code,f->length);
+        num_files++;
+      }
+    free(line);
+    if(fp != stdin) fclose(fp);
+    return(num_files);
+  }
+
+static int compare_name(const void *a, const void *b)
+  {
+    return(memcmp((*(struct build_file * const *) a)->entry,
+                  (*(struct build_file * const *) b)->entry,NAME_LEN));
+  }
+
+void image_write(FILE *fp, const void *data, size_t len)
+  {
+    if(fwrite(data,1,len,fp) != len)
+      {
+        fprintf(stderr,"Error writing LIF image file\n");
+        exit(1);
+      }
+  }
+
+int main(int argc, char **argv)
+  {
+    int option; /* Command line option character */
+    char *medium; /* medium type */
+    char *label; /* volume label, NULL for a blank label */
+    int dirsize; /* number of directory entries */
+    int zero_data; /* extend the image to the medium size */
+    int verbose; /* list the files */
+    char *manifest, *image_name;
+
+    struct build_file *files; /* files in manifest order */
+    struct build_file **order; /* files sorted by name */
+    int num_files;
+    int tracks, heads, sectors; /* medium geometry */
+    lif_blk_t medium_size; /* blocks of the medium */
+    int dir_length; /* directory blocks */
+    lif_blk_t next_block; /* next free block */
+    lif_blk_t blocks; /* blocks of a file */
+    long long done, count;
+    unsigned char *data; /* transfer buffer */
+    unsigned char date_entry[ENTRY_SIZE]; /* time stamp of the volume */
+    char padded_label[LABEL_LEN];
+    int i, temp;
+    FILE *fp, *in;
+    struct stat st;
+
+    /* Process command line options */
+    medium=NULL;
+    label=NULL;
+    dirsize=0;
+    zero_data=0;
+    verbose=0;
+    optind=1;
+    while ((option=getopt(argc,argv,"m:n:l:zv?"))!=-1)
+      {
+        switch(option)
+          {
+            case 'm' : medium=optarg;
+                       break;
+            case 'n' : if (sscanf(optarg,"%d",&dirsize)!= 1 || dirsize <= 0)
+                          usage();
+                       break;
+            case 'l' : label=optarg;
+                       break;
+            case 'z' : zero_data=1;
+                       break;
+            case 'v' : verbose=1;
+                       break;
+            case '?' : usage();
+                       break;
+          }
+      }
+    if(optind != argc-2 || medium == NULL) usage();
+    manifest=argv[optind];
+    image_name=argv[optind+1];
+    medium_size=get_medium(medium,&tracks,&heads,&sectors);
+    if(medium_size == 0) usage();
+    if(label != NULL && check_labelname(label) == 0)
+      {
+        fprintf(stderr,"Illegal volume label\n");
+        exit(1);
+      }
+
+    /* the target must be a new file, an existing image may be in use by
+       another utility and is not truncated */
+    if(strcmp(image_name,"-") != 0 && stat(image_name,&st) == 0)
+      {
+        fprintf(stderr,"Output LIF image file already exists\n");
+        exit(1);
+      }
+
+    /* check all files and compute the layout before anything is written */
+    num_files=read_manifest(manifest,&files);
+    order=xmalloc((num_files+1)*sizeof(struct build_file *));
+    for(i=0; i<num_files; i++) order[i]=&files[i];
+    qsort(order,num_files,sizeof(struct build_file *),compare_name);
+    for(i=1; i<num_files; i++)
+      {
+        if(memcmp(order[i-1]->entry,order[i]->entry,NAME_LEN) == 0)
+          {
+            fprintf(stderr,"%s line %d: Duplicate filename: %.*s\n",manifest,
+                    order[i]->line,NAME_LEN,(char *) order[i]->entry);
+            exit(2);
+          }
+      }
+    free(order);
+
+    if(dirsize == 0) dirsize= num_files > 0 ? num_files : 1;
+    temp= dirsize* ENTRY_SIZE;
+    dir_length= temp/SECTOR_SIZE + (int) ((temp % SECTOR_SIZE) !=0);
+    if (dir_length > medium_size / 3) {
+       fprintf(stderr,"directory size too large\n");
+       exit(1);
+    }
+    if(num_files > dir_length*8)
+      {
+        fprintf(stderr,"Directory full\n");
+        exit(2);
+      }
+    next_block=2+dir_length;
+    for(i=0; i<num_files; i++)
+      {
+        blocks=get_lif_int(files[i].entry+16,4);
+        put_lif_int(files[i].entry+12,4,(unsigned int) next_block);
+        next_block+=blocks;
+      }
+    if(next_block > medium_size)
+      {
+        fprintf(stderr,"No room\n");
+        exit(2);
+      }
+    debug_print("dir blocks %d, last block %lld\n",dir_length,next_block-1);
+
+    /* open the image */
+    if(strcmp(image_name,"-") == 0)
+      {
+        SETMODE_STDOUT_BINARY;
+        fp=stdout;
+      }
+    else if((fp=fopen(image_name,"wb")) == NULL)
+      {
+        fprintf(stderr,"can't open File %s\n",image_name);
+        exit(2);
+      }
+    else
+      {
+        remove_name=image_name;
+        atexit(remove_output);
+      }
+    data=xmalloc(IO_BLOCKS*SECTOR_SIZE);
+
+    /* the volume header and block 1 */
+    memset(data,0,2*SECTOR_SIZE);
+    put_lif_int(data+0,2,0x8000);
+    if(label != NULL) pad_label(label,padded_label);
+    else memset(padded_label,' ',LABEL_LEN);
+    memcpy(data+2,padded_label,LABEL_LEN);
+    put_lif_int(data+8,4,2);
+    put_lif_int(data+16,4,dir_length);
+    put_lif_int(data+20,2,1);
+    put_lif_int(data+24,4,tracks);
+    put_lif_int(data+28,4,heads);
+    put_lif_int(data+32,4,sectors);
+    put_time(date_entry);
+    for(i=36;i<42;i++) data[i]= date_entry[i-16];
+    image_write(fp,data,2*SECTOR_SIZE);
+
+    /* the directory, unused slots are 0xFF */
+    for(i=0; i<dir_length*8; i++)
+      {
+        if(i < num_files) memcpy(data+(i % IO_BLOCKS)*ENTRY_SIZE,files[i].entry,ENTRY_SIZE);
+        else memset(data+(i % IO_BLOCKS)*ENTRY_SIZE,0xFF,ENTRY_SIZE);
+        if(i % IO_BLOCKS == IO_BLOCKS-1 || i == dir_length*8-1)
+           image_write(fp,data,(size_t) (i % IO_BLOCKS+1)*ENTRY_SIZE);
+      }
+
+    /* the files, the last block of a file is padded with zeros */
+    for(i=0; i<num_files; i++)
+      {
+        if(verbose) fprintf(stderr,"%s\n",files[i].path);
+        if((in=fopen(files[i].path,"rb")) == NULL)
+          {
+            fprintf(stderr,"can't open File %s\n",files[i].path);
+            exit(2);
+          }
+        blocks=get_lif_int(files[i].entry+16,4);
+        for(done=0; done<(long long) blocks*SECTOR_SIZE; done+=count)
+          {
+            count=(long long) blocks*SECTOR_SIZE-done;
+            if(count > IO_BLOCKS*SECTOR_SIZE) count=IO_BLOCKS*SECTOR_SIZE;
+            memset(data,0,(size_t) count);
+            temp= files[i].length-done < count ? (int) (files[i].length-done) : (int) count;
+            if(fread(data,1,(size_t) temp,in) != (size_t) temp)
+              {
+                fprintf(stderr,"%s: file changed while reading\n",files[i].path);
+                exit(2);
+              }
+            image_write(fp,data,(size_t) count);
+          }
+        fclose(in);
+      }
+
+    /* zeros up to the end of the medium */
+    if(zero_data)
+      {
+        memset(data,0,IO_BLOCKS*SECTOR_SIZE);
+        for( ; next_block<medium_size; next_block+=count)
+          {
+            count=medium_size-next_block;
+            if(count > IO_BLOCKS) count=IO_BLOCKS;
+            image_write(fp,data,(size_t) count*SECTOR_SIZE);
+          }
+      }
+
+    if(fflush(fp) || (fp != stdout && fclose(fp)))
+      {
+        fprintf(stderr,"Error writing LIF image file\n");
+        exit(1);
+      }
+    remove_name=NULL;
+    free(data);
+    for(i=0; i<num_files; i++) free(files[i].path);
+    free(files);
+    exit(0);
+  }
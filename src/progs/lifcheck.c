@@ -0,0 +1,224 @@
+/* lifcheck.c -- check the consistency of a LIF disk */
+/* 2026, placed under the GPL */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "lif_block.h"
+#include "lif_error.h"
+#include "lif_dir_utils.h"
+#include "lif_const.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+   do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+/* csv separator */
+#define SEP ','
+
+static int csv_flag;      /* csv output */
+static int num_errors;    /* number of errors found */
+static int num_warnings;  /* number of warnings found */
+
+void usage(void)
+  {
+    fprintf(stderr,"Usage: lifcheck [-c] lif-image-filename\n");
+    fprintf(stderr,"\n");
+    fprintf(stderr,"      -c output the findings as csv\n");
+    fprintf(stderr,"      the exit status is 2 if errors were found\n");
+    exit(1);
+  }
+
+/* report a finding. entry is NULL for findings which do not belong to
+   a file, first and last are -1 if there is no block range */
+void report(int error, char *check, int slot, unsigned char *entry,
+            lif_blk_t first, lif_blk_t last, char *message)
+  {
+    int len;
+
+    if(error) num_errors++; else num_warnings++;
+    len=0;
+    if(entry != NULL)
+       for(len=NAME_LEN; len>0 && entry[len-1]==' '; len--) ;
+    if(csv_flag)
+      {
+        printf("%s%c%s%c%d%c%.*s%c%lld%c%lld%c%s\n",error ? "error" : "warning",
+               SEP,check,SEP,slot,SEP,len,entry ? (char *) entry : "",SEP,
+               first,SEP,last,SEP,message);
+        return;
+      }
+    printf("%s: ",error ? "error" : "warning");
+    if(entry != NULL) printf("%.*s: ",len,(char *) entry);
+    if(first != -1) printf("blocks %lld..%lld: ",first,last);
+    printf("%s\n",message);
+  }
+
+int main(int argc, char **argv)
+  {
+    int option; /* Command line option character */
+    int physical_flag; /* Option to use a physical device */
+    int lif_device; /* Descriptor of input device */
+
+    struct lif_dir *dir; /* directory of the medium */
+    unsigned char *entry, *other;
+    unsigned int tracks, surfaces, blocks; /* medium geometry */
+    lif_blk_t medium_size; /* blocks of the medium, 0 if unknown */
+    lif_blk_t dir_end; /* first block after the directory */
+    lif_blk_t start, end; /* blocks of a file, end is exclusive */
+    lif_blk_t max_end; /* end of the files visited so far */
+    lif_blk_t unused; /* unused blocks between files */
+    long long length; /* file length in bytes */
+    int max_slot; /* file with the end max_end */
+    int slot, i, j;
+    lif_blk_t used; /* blocks in files */
+    char name[NAME_LEN+1]; /* file name without padding */
+    char message[80];
+
+    /* Process command line options */
+    optind=1;
+    physical_flag=0;
+    csv_flag=0;
+    while ((option=getopt(argc,argv,"cp?"))!=-1)
+      {
+        switch(option)
+          {
+            case 'c' : csv_flag=1;
+                       break;
+            case 'p' : physical_flag=1;
+                       break;
+            case '?' : usage();
+                       break;
+          }
+      }
+    if( optind != argc-1 ) usage();
+
+    /* Open lif device, the volume header and the directory are read
+       in one sequential pass */
+    if((lif_device=lif_open(argv[optind],O_RDONLY | O_BINARY,0,physical_flag))==-1)
+      {
+        fprintf(stderr,"Error opening %s: %s\n",argv[optind],lif_errmsg());
+        exit(1);
+      }
+    if((dir=lif_dir_open(lif_device))==NULL) lif_fatal();
+
+    /* medium size */
+    tracks=get_lif_int(dir->header+24,4);
+    surfaces=get_lif_int(dir->header+28,4);
+    blocks=get_lif_int(dir->header+32,4);
+    medium_size= (lif_blk_t) tracks*surfaces*blocks;
+    if((tracks == surfaces) && (surfaces == blocks))
+      {
+        report(1,"medium",-1,NULL,-1,-1,"medium was not initialized properly");
+        medium_size=0;
+      }
+    else if(medium_size == 0)
+      {
+        report(1,"medium",-1,NULL,-1,-1,"medium size is zero");
+      }
+
+    /* location of the directory */
+    dir_end=dir->start+dir->length;
+    if(dir->start < 2)
+       report(1,"directory",-1,NULL,dir->start,dir_end-1,
+              "directory overlaps the volume header");
+    if(medium_size != 0 && dir_end > medium_size)
+       report(1,"directory",-1,NULL,dir->start,dir_end-1,
+              "directory beyond end of medium");
+
+    /* the slots behind the end of directory mark must be unused */
+    for(slot=dir->used+1; slot<dir->slots; slot++)
+      {
+        entry=lif_dir_entry(dir,slot);
+        i=get_lif_int(entry+10,2);
+        if(i == 0xFFFF || i == 0) continue;
+        for(j=0; j<ENTRY_SIZE && entry[j] == 0xFF; j++) ;
+        if(j == ENTRY_SIZE) continue;
+        report(0,"endmark",slot,NULL,-1,-1,
+               "entry behind the end of directory mark");
+      }
+
+    /* check the files one by one */
+    for(slot=0; slot<dir->used; slot++)
+      {
+        entry=lif_dir_entry(dir,slot);
+        if(get_lif_int(entry+10,2)==0) continue; /* Skip deleted files */
+        start=get_lif_int(entry+12,4);
+        end=start+get_lif_int(entry+16,4);
+        debug_print("slot %d blocks %lld..%lld\n",slot,start,end-1);
+
+        for(i=0; i<NAME_LEN && entry[i] != ' '; i++) name[i]=entry[i];
+        name[i]='\0';
+        if(check_filename(name) == 0)
+           report(0,"name",slot,entry,-1,-1,"illegal file name");
+        i=lif_dir_find(dir,(char *) entry);
+        if(i != slot)
+           report(0,"name",slot,entry,-1,-1,"duplicate file name");
+
+        if(start < dir_end && end > 0 && end != start)
+           report(1,"start",slot,entry,start,end-1,
+                  "file overlaps the volume header or the directory");
+        if(medium_size != 0 && end > medium_size)
+           report(1,"extent",slot,entry,start,end-1,
+                  "file beyond end of medium");
+
+        length=file_length(entry,NULL);
+        if(length > (long long) (end-start)*SECTOR_SIZE)
+          {
+            sprintf(message,"file length %lld exceeds %lld blocks",length,end-start);
+            report(1,"length",slot,entry,start,end-1,message);
+          }
+        else if((length+SECTOR_SIZE-1)/SECTOR_SIZE < end-start)
+          {
+            sprintf(message,"file length %lld uses less than %lld blocks",length,end-start);
+            report(0,"length",slot,entry,start,end-1,message);
+          }
+      }
+
+    /* overlaps and unused space, the files are sorted by start block.
+       Each file is compared with the file which reaches furthest of all
+       files before it */
+    max_end=dir_end;
+    max_slot=-1;
+    unused=0;
+    used=0;
+    for(i=0; i<dir->files; i++)
+      {
+        start=dir->by_start[i].start;
+        end=start+dir->by_start[i].blocks;
+        used+=end-start;
+        if(start == end) continue; /* files without blocks */
+        entry=lif_dir_entry(dir,dir->by_start[i].slot);
+        if(start < max_end && max_slot != -1)
+          {
+            other=lif_dir_entry(dir,max_slot);
+            sprintf(message,"file overlaps %.*s",NAME_LEN,(char *) other);
+            for(j=(int) strlen(message); j>0 && message[j-1]==' '; j--)
+               message[j-1]='\0';
+            report(1,"overlap",dir->by_start[i].slot,entry,start,
+                   (end < max_end ? end : max_end)-1,message);
+          }
+        else if(start > max_end)
+          {
+            unused+=start-max_end;
+            report(0,"unused",-1,NULL,max_end,start-1,
+                   "unused blocks between files");
+          }
+        if(end > max_end)
+          {
+            max_end=end;
+            max_slot=dir->by_start[i].slot;
+          }
+      }
+
+    if(!csv_flag)
+      {
+        printf("%d files, %lld blocks used by files, %lld unused blocks between files\n",
+               dir->files,used,unused);
+        printf("%d errors, %d warnings\n",num_errors,num_warnings);
+      }
+    lif_dir_close(dir);
+    if (lif_close(lif_device)) lif_fatal();
+    exit(num_errors ? 2 : 0);
+  }
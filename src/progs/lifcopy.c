@@ -0,0 +1,307 @@
+/* lifcopy.c -- copy the files of a LIF image file to a new LIF image file */
+/* 2026, placed under the GPL */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "lif_block.h"
+#include "lif_error.h"
+#include "lif_dir_utils.h"
+#include "lif_create_entry.h"
+#include "lif_const.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+   do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+
+static char *remove_name;      /* incomplete output image */
+
+/* a file to copy */
+struct copy_file {
+   unsigned char *entry;     /* directory entry in the source image */
+   lif_blk_t new_start;      /* first block in the target image */
+};
+
+void usage(void)
+  {
+    fprintf(stderr,
+    "Usage: lifcopy [-m mediumtype] [-n directorysize] [-z] lif-image-filename1\n");
+    fprintf(stderr,
+    "               lif-image-filename2 [name ...]\n");
+    fprintf(stderr,"\n");
+    fprintf(stderr,
+    "      -m Medium type of the new image (cass | disk | hdrive1 | hdrive2 |\n");
+    fprintf(stderr,
+    "         hdrive4 | hdrive8 | hdrive16), default is the source medium\n");
+    fprintf(stderr,
+    "      -n number of directory entries of the new image, default is the\n");
+    fprintf(stderr,
+    "         directory size of the source image\n");
+    fprintf(stderr,
+    "      -z extend the new image to the full medium size\n");
+    fprintf(stderr,
+    "      name is a file name, a pattern with * and ? or all (default)\n");
+    exit(1);
+  }
+
+void remove_output(void)
+  {
+    if(remove_name != NULL) remove(remove_name);
+  }
+
+static int compare_start(const void *a, const void *b)
+  {
+    lif_blk_t start_a, start_b;
+
+    start_a= get_lif_int(((const struct copy_file *) a)->entry+12,4);
+    start_b= get_lif_int(((const struct copy_file *) b)->entry+12,4);
+    return((start_a > start_b) - (start_a < start_b));
+  }
+
+/* copy blocks from the source to the target image, IO_BLOCKS blocks at
+   a time */
+void copy_blocks(int source, lif_blk_t from, int target, lif_blk_t to,
+                 lif_blk_t blocks, unsigned char *data)
+  {
+    lif_blk_t block;
+    int count;
+
+    for(block=0; block<blocks; block+=count)
+      {
+        count=IO_BLOCKS;
+        if(blocks-block < IO_BLOCKS) count=(int) (blocks-block);
+        if (lif_read_blocks(source,from+block,count,data)) lif_fatal();
+        if (lif_write_blocks(target,to+block,count,data)) lif_fatal();
+      }
+  }
+
+int main(int argc, char **argv)
+  {
+    int option; /* Command line option character */
+    char *medium; /* medium type of the target image */
+    int dirsize; /* number of directory entries of the target image */
+    int zero_data; /* extend the target image to the medium size */
+    int source, target; /* image descriptors */
+    struct stat st;
+
+    struct lif_dir *dir; /* directory of the source image */
+    struct copy_file *files; /* files to copy in directory order */
+    struct copy_file *order; /* files to copy in start block order */
+    char *selected_flags; /* slot was selected */
+    int num_files;
+    int num_names, found;
+    char **names;
+    unsigned char *entry;
+    unsigned char header[SECTOR_SIZE]; /* volume header of the target */
+    unsigned char *dir_blocks; /* directory of the target */
+    unsigned char *data; /* transfer buffer */
+    int tracks, heads, sectors; /* medium geometry */
+    lif_blk_t medium_size; /* blocks of the target medium */
+    int dir_length; /* directory blocks of the target */
+    lif_blk_t next_block; /* next free block in the target */
+    int slot, i, temp;
+
+    /* Process command line options */
+    medium=NULL;
+    dirsize=0;
+    zero_data=0;
+    optind=1;
+    while ((option=getopt(argc,argv,"m:n:z?"))!=-1)
+      {
+        switch(option)
+          {
+            case 'm' : medium=optarg;
+                       break;
+            case 'n' : if (sscanf(optarg,"%d",&dirsize)!= 1 || dirsize <= 0)
+                          usage();
+                       break;
+            case 'z' : zero_data=1;
+                       break;
+            case '?' : usage();
+                       break;
+          }
+      }
+    if(optind > argc-2) usage();
+
+    /* the target must be a new file */
+    if(stat(argv[optind+1],&st) == 0)
+      {
+        fprintf(stderr,"Output LIF image file already exists\n");
+        exit(1);
+      }
+
+    /* Open the source image and read its directory */
+    if((source=lif_open(argv[optind],O_RDONLY | O_BINARY,0,0))==-1)
+      {
+        fprintf(stderr,"Error opening %s: %s\n",argv[optind],lif_errmsg());
+        exit(1);
+      }
+    if((dir=lif_dir_open(source))==NULL) lif_fatal();
+
+    /* geometry of the target medium */
+    if(medium != NULL)
+      {
+        medium_size=get_medium(medium,&tracks,&heads,&sectors);
+        if(medium_size == 0) usage();
+      }
+    else
+      {
+        tracks=get_lif_int(dir->header+24,4);
+        heads=get_lif_int(dir->header+28,4);
+        sectors=get_lif_int(dir->header+32,4);
+        if((tracks == heads) && (heads == sectors))
+          {
+            fprintf(stderr,"Medium was not initialized properly\n");
+            exit(1);
+          }
+        medium_size= (lif_blk_t) tracks*heads*sectors;
+      }
+
+    /* size of the target directory in blocks */
+    if(dirsize > 0)
+      {
+        temp= dirsize* ENTRY_SIZE;
+        dir_length= temp/SECTOR_SIZE + (int) ((temp % SECTOR_SIZE) !=0);
+      }
+    else
+      {
+        dir_length= dir->length;
+      }
+    if (dir_length > medium_size / 3) {
+       fprintf(stderr,"directory size too large\n");
+       exit(1);
+    }
+
+    /* select the files in directory order, all files by default */
+    names=argv+optind+2;
+    num_names=argc-optind-2;
+    files=malloc((dir->used+1)*sizeof(struct copy_file));
+    order=malloc((dir->used+1)*sizeof(struct copy_file));
+    selected_flags=calloc(dir->used+1,1);
+    if(files == NULL || order == NULL || selected_flags == NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    for(i=0; i<num_names; i++)
+      {
+        if(strcmp(names[i],"all") && strpbrk(names[i],"*?") == NULL &&
+           check_filename(names[i])==0)
+          {
+            fprintf(stderr,"Illegal file name %s\n",names[i]);
+            exit(1);
+          }
+        found=0;
+        for(slot=0; slot<dir->used; slot++)
+          {
+            entry=lif_dir_entry(dir,slot);
+            if(get_lif_int(entry+10,2)==0) continue; /* Skip deleted files */
+            if(strcmp(names[i],"all") && !match_name(names[i],(char *) entry))
+               continue;
+            found=1;
+            selected_flags[slot]=1;
+          }
+        if(!found && strcmp(names[i],"all"))
+          {
+            fprintf(stderr,"File %s not found\n",names[i]);
+            exit(2);
+          }
+      }
+
+    /* lay out the files contiguously behind the new directory */
+    num_files=0;
+    next_block=2+dir_length;
+    for(slot=0; slot<dir->used; slot++)
+      {
+        entry=lif_dir_entry(dir,slot);
+        if(get_lif_int(entry+10,2)==0) continue; /* Skip deleted files */
+        if(num_names > 0 && !selected_flags[slot]) continue;
+        files[num_files].entry=entry;
+        files[num_files].new_start=next_block;
+        next_block+=get_lif_int(entry+16,4);
+        num_files++;
+      }
+    if(num_files > dir_length*8)
+      {
+        fprintf(stderr,"Directory full\n");
+        exit(2);
+      }
+    if(next_block > medium_size)
+      {
+        fprintf(stderr,"No room\n");
+        exit(2);
+      }
+
+    /* Create the target image, a file created since the check above is
+       not overwritten. The target is removed if the copy fails */
+    if((target=lif_open(argv[optind+1],O_CREAT | O_EXCL | O_BINARY | O_TRUNC | O_WRONLY,S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH,0))==-1)
+      {
+        fprintf(stderr,"Error opening %s: %s\n",argv[optind+1],lif_errmsg());
+        exit(1);
+      }
+    remove_name=argv[optind+1];
+    atexit(remove_output);
+
+    /* copy the file blocks, the source image is read in the order of the
+       start blocks, so it is read front to back once */
+    data=malloc(IO_BLOCKS*SECTOR_SIZE);
+    if(data == (unsigned char *) NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    memcpy(order,files,num_files*sizeof(struct copy_file));
+    qsort(order,num_files,sizeof(struct copy_file),compare_start);
+    for(i=0; i<num_files; i++)
+      {
+        debug_print("copy blocks %u..%u to %lld\n",
+                    get_lif_int(order[i].entry+12,4),
+                    get_lif_int(order[i].entry+12,4)+get_lif_int(order[i].entry+16,4)-1,
+                    order[i].new_start);
+        copy_blocks(source,get_lif_int(order[i].entry+12,4),target,
+                    order[i].new_start,get_lif_int(order[i].entry+16,4),data);
+      }
+    free(data);
+
+    /* write the new directory */
+    dir_blocks=malloc((size_t) dir_length*SECTOR_SIZE);
+    if(dir_blocks == (unsigned char *) NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    memset(dir_blocks,0xff,(size_t) dir_length*SECTOR_SIZE);
+    for(i=0; i<num_files; i++)
+      {
+        memcpy(dir_blocks+i*ENTRY_SIZE,files[i].entry,ENTRY_SIZE);
+        put_lif_int(dir_blocks+i*ENTRY_SIZE+12,4,(unsigned int) files[i].new_start);
+      }
+    if (lif_write_blocks(target,2,dir_length,dir_blocks)) lif_fatal();
+    free(dir_blocks);
+
+    /* write the volume header, the label of the source is kept */
+    memcpy(header,dir->header,SECTOR_SIZE);
+    put_lif_int(header+8,4,2);
+    put_lif_int(header+16,4,dir_length);
+    put_lif_int(header+24,4,tracks);
+    put_lif_int(header+28,4,heads);
+    put_lif_int(header+32,4,sectors);
+    if (lif_write_block(target,0,header)) lif_fatal();
+    memset(header,0,SECTOR_SIZE);
+    if (lif_write_block(target,1,header)) lif_fatal();
+    if (zero_data && lif_resize(target,medium_size)) lif_fatal();
+
+    /* tidy up and quit */
+    free(files);
+    free(order);
+    free(selected_flags);
+    lif_dir_close(dir);
+    if (lif_close(target)) lif_fatal();
+    remove_name=NULL;
+    if (lif_close(source)) lif_fatal();
+    exit(0);
+  }
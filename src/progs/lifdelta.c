@@ -0,0 +1,560 @@
+/* lifdelta.c -- block delta between two LIF image files */
+/* 2026, placed under the GPL */
+
+/* A delta turns an old image into a new image. It consists of copy
+   records, which take blocks from another position of the old image, and
+   data records with the new contents of blocks. Blocks which did not
+   change are not part of the delta. The records are applied in place in
+   ascending block order, so a copy only uses source blocks at or behind
+   its destination, which have not been written yet. Files moved towards
+   the start of the medium by lifpack are found as copies.
+
+   Integers are stored MSB first. Layout of a delta:
+
+   magic "LIFDLT1\n"
+   u64 blocks of the old image, u64 blocks of the new image
+   32 byte SHA-256 hash of the old image, 32 byte hash of the new image
+   records:
+      'C' u64 destination, u64 source, u64 blocks
+      'D' u64 destination, u64 blocks, data
+      'Z' u64 destination, u64 blocks of zeros
+      'E' end of delta */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "lif_block.h"
+#include "lif_error.h"
+#include "lif_dir_utils.h"
+#include "lif_ovl.h"
+#include "lif_hash.h"
+#include "lif_const.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+   do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+#define DELTA_MAGIC "LIFDLT1\n"
+#define HEADER_SIZE (8+8+8+2*LIF_HASH_SIZE)
+
+/* match of a block of the new image */
+#define MATCH_SAME -2   /* same contents at the same position */
+#define MATCH_NONE -1   /* contents are in the delta */
+#define MATCH_ZERO -3   /* block of zeros */
+
+/* block hashes of an image */
+struct image {
+   char *name;
+   int device;
+   lif_blk_t blocks;
+   unsigned char (*hash)[LIF_HASH_SIZE];  /* hash of every block */
+   unsigned char image_hash[LIF_HASH_SIZE]; /* hash of all blocks */
+};
+
+/* old block hashes sorted by hash and position */
+struct block_key {
+   unsigned char hash[LIF_HASH_SIZE];
+   lif_blk_t pos;
+};
+
+static int verbose;
+
+void usage(void)
+  {
+    fprintf(stderr,"Usage: lifdelta [-v] old-image new-image delta-file\n");
+    fprintf(stderr,"       lifdelta -a [-v] delta-file image\n");
+    fprintf(stderr,"\n");
+    fprintf(stderr,"      create a delta which turns old-image into new-image,\n");
+    fprintf(stderr,"      delta-file - writes to standard output\n");
+    fprintf(stderr,"      -a apply a delta to image, delta-file - reads from\n");
+    fprintf(stderr,"         standard input\n");
+    fprintf(stderr,"      -v report the size of the delta\n");
+    exit(1);
+  }
+
+void *xmalloc(size_t size)
+  {
+    void *p;
+
+    p=malloc(size);
+    if(p == NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    return(p);
+  }
+
+void put_u64(unsigned char *data, unsigned long long value)
+  {
+    int i;
+
+    for(i=7; i>=0; i--)
+      {
+        data[i]= (unsigned char) (value & 0xFF);
+        value>>=8;
+      }
+  }
+
+unsigned long long get_u64(unsigned char *data)
+  {
+    unsigned long long value;
+    int i;
+
+    value=0;
+    for(i=0; i<8; i++) value= (value << 8) | data[i];
+    return(value);
+  }
+
+void write_data(FILE *fp, const void *data, size_t len)
+  {
+    if(fwrite(data,1,len,fp) != len)
+      {
+        fprintf(stderr,"Error writing delta\n");
+        exit(1);
+      }
+  }
+
+void read_data(FILE *fp, void *data, size_t len)
+  {
+    if(fread(data,1,len,fp) != len)
+      {
+        fprintf(stderr,"Delta is truncated\n");
+        exit(1);
+      }
+  }
+
+/* number of blocks of an image file */
+lif_blk_t image_blocks(char *name)
+  {
+    struct stat st;
+
+    if(stat(name,&st) || ! S_ISREG(st.st_mode) || lif_is_ovl_file(name))
+      {
+        fprintf(stderr,"%s is not an image file\n",name);
+        exit(1);
+      }
+    return((lif_blk_t) (st.st_size/SECTOR_SIZE));
+  }
+
+/* hash all blocks of an image in one sequential pass. If block_hashes is
+   zero only the hash of the whole image is computed */
+void hash_image(struct image *img, int block_hashes, unsigned char *data)
+  {
+    struct lif_hash ctx, block_ctx;
+    lif_blk_t block;
+    int count, i;
+
+    if(block_hashes)
+       img->hash=xmalloc((size_t) (img->blocks+1)*LIF_HASH_SIZE);
+    lif_hash_init(&ctx);
+    for(block=0; block<img->blocks; block+=count)
+      {
+        count=IO_BLOCKS;
+        if(img->blocks-block < IO_BLOCKS) count=(int) (img->blocks-block);
+        if(lif_read_blocks(img->device,block,count,data)) lif_fatal();
+        lif_hash_update(&ctx,data,(size_t) count*SECTOR_SIZE);
+        if(! block_hashes) continue;
+        for(i=0; i<count; i++)
+          {
+            lif_hash_init(&block_ctx);
+            lif_hash_update(&block_ctx,data+i*SECTOR_SIZE,SECTOR_SIZE);
+            lif_hash_final(&block_ctx,img->hash[block+i]);
+          }
+      }
+    lif_hash_final(&ctx,img->image_hash);
+  }
+
+static int compare_keys(const void *a, const void *b)
+  {
+    const struct block_key *ka= a, *kb= b;
+    int ret;
+
+    ret=memcmp(ka->hash,kb->hash,LIF_HASH_SIZE);
+    if(ret) return(ret);
+    return((ka->pos > kb->pos) - (ka->pos < kb->pos));
+  }
+
+/* find an old block with the contents hash at or behind position pos.
+   Returns the position or -1 */
+lif_blk_t find_block(struct block_key *keys, lif_blk_t num_keys,
+                     unsigned char *hash, lif_blk_t pos)
+  {
+    lif_blk_t lo, hi, mid;
+    int ret;
+
+    /* first key which is not less than (hash, pos) */
+    lo=0;
+    hi=num_keys;
+    while(lo < hi)
+      {
+        mid=(lo+hi)/2;
+        ret=memcmp(keys[mid].hash,hash,LIF_HASH_SIZE);
+        if(ret < 0 || (ret == 0 && keys[mid].pos < pos)) lo=mid+1;
+        else hi=mid;
+      }
+    if(lo < num_keys && memcmp(keys[lo].hash,hash,LIF_HASH_SIZE) == 0)
+       return(keys[lo].pos);
+    return(-1);
+  }
+
+/* files of the new image which are unchanged files of the old image at
+   the same or a higher position are copied as a whole */
+void match_files(struct image *old, struct image *new, lif_blk_t *match)
+  {
+    struct lif_dir *old_dir, *new_dir;
+    unsigned char *entry, *old_entry;
+    lif_blk_t start, old_start, blocks, i;
+    int slot, old_slot;
+
+    if((old_dir=lif_dir_open(old->device))==NULL ||
+       (new_dir=lif_dir_open(new->device))==NULL)
+      {
+        /* no LIF directory, only blocks are compared */
+        if(old_dir != NULL) lif_dir_close(old_dir);
+        return;
+      }
+    for(slot=0; slot<new_dir->used; slot++)
+      {
+        entry=lif_dir_entry(new_dir,slot);
+        if(get_lif_int(entry+10,2)==0) continue; /* Skip deleted files */
+        old_slot=lif_dir_find(old_dir,(char *) entry);
+        if(old_slot == -1) continue;
+        old_entry=lif_dir_entry(old_dir,old_slot);
+        start=get_lif_int(entry+12,4);
+        old_start=get_lif_int(old_entry+12,4);
+        blocks=get_lif_int(entry+16,4);
+        if(blocks != get_lif_int(old_entry+16,4) || old_start < start ||
+           start+blocks > new->blocks || old_start+blocks > old->blocks)
+           continue;
+        for(i=0; i<blocks; i++)
+          {
+            if(memcmp(new->hash[start+i],old->hash[old_start+i],LIF_HASH_SIZE))
+               break;
+          }
+        if(i < blocks) continue;
+        debug_print("file %.10s %lld -> %lld\n",(char *) entry,old_start,start);
+        for(i=0; i<blocks; i++)
+           match[start+i]= old_start == start ? MATCH_SAME : old_start+i;
+      }
+    lif_dir_close(old_dir);
+    lif_dir_close(new_dir);
+  }
+
+void put_record(FILE *fp, int type, lif_blk_t a, lif_blk_t b, lif_blk_t c)
+  {
+    unsigned char record[25];
+    size_t len;
+
+    record[0]=(unsigned char) type;
+    put_u64(record+1,(unsigned long long) a);
+    put_u64(record+9,(unsigned long long) b);
+    put_u64(record+17,(unsigned long long) c);
+    len= type == 'C' ? 25 : 17;
+    write_data(fp,record,len);
+  }
+
+int create_delta(char *old_name, char *new_name, char *delta_name)
+  {
+    struct image old, new;
+    struct block_key *keys;
+    lif_blk_t *match;
+    lif_blk_t i, j, copied, sent, zeroed;
+    unsigned char *data;
+    unsigned char header[HEADER_SIZE];
+    unsigned char zero_hash[LIF_HASH_SIZE];
+    struct lif_hash ctx;
+    FILE *fp;
+    int records;
+
+    data=xmalloc(IO_BLOCKS*SECTOR_SIZE);
+    old.name=old_name;
+    new.name=new_name;
+    old.blocks=image_blocks(old_name);
+    new.blocks=image_blocks(new_name);
+    if((old.device=lif_open(old_name,O_RDONLY | O_BINARY,0,0))==-1 ||
+       (new.device=lif_open(new_name,O_RDONLY | O_BINARY,0,0))==-1)
+      {
+        fprintf(stderr,"Error opening image: %s\n",lif_errmsg());
+        exit(1);
+      }
+    hash_image(&old,1,data);
+    hash_image(&new,1,data);
+
+    /* index of the old blocks */
+    keys=xmalloc((size_t) (old.blocks+1)*sizeof(struct block_key));
+    for(i=0; i<old.blocks; i++)
+      {
+        memcpy(keys[i].hash,old.hash[i],LIF_HASH_SIZE);
+        keys[i].pos=i;
+      }
+    qsort(keys,(size_t) old.blocks,sizeof(struct block_key),compare_keys);
+
+    /* find a source for every block of the new image. A copy is extended
+       from the previous block if possible, so moved extents result in one
+       copy record */
+    match=xmalloc((size_t) (new.blocks+1)*sizeof(lif_blk_t));
+    for(i=0; i<new.blocks; i++) match[i]=MATCH_NONE;
+    match_files(&old,&new,match);
+    for(i=0; i<new.blocks; i++)
+      {
+        if(match[i] != MATCH_NONE) continue;
+        if(i < old.blocks && memcmp(new.hash[i],old.hash[i],LIF_HASH_SIZE) == 0)
+          {
+            match[i]=MATCH_SAME;
+            continue;
+          }
+        if(i > 0 && match[i-1] >= 0 && match[i-1]+1 < old.blocks &&
+           memcmp(new.hash[i],old.hash[match[i-1]+1],LIF_HASH_SIZE) == 0)
+          {
+            match[i]=match[i-1]+1;
+            continue;
+          }
+        match[i]=find_block(keys,old.blocks,new.hash[i],i);
+      }
+    free(keys);
+
+    /* blocks of zeros without a source, e.g. an extended image */
+    memset(data,0,SECTOR_SIZE);
+    lif_hash_init(&ctx);
+    lif_hash_update(&ctx,data,SECTOR_SIZE);
+    lif_hash_final(&ctx,zero_hash);
+    for(i=0; i<new.blocks; i++)
+      {
+        if(match[i] == MATCH_NONE &&
+           memcmp(new.hash[i],zero_hash,LIF_HASH_SIZE) == 0) match[i]=MATCH_ZERO;
+      }
+
+    /* write the delta */
+    if(strcmp(delta_name,"-") == 0)
+      {
+        SETMODE_STDOUT_BINARY;
+        fp=stdout;
+      }
+    else if((fp=fopen(delta_name,"wb")) == NULL)
+      {
+        fprintf(stderr,"can't open File %s\n",delta_name);
+        exit(2);
+      }
+    memcpy(header,DELTA_MAGIC,8);
+    put_u64(header+8,(unsigned long long) old.blocks);
+    put_u64(header+16,(unsigned long long) new.blocks);
+    memcpy(header+24,old.image_hash,LIF_HASH_SIZE);
+    memcpy(header+24+LIF_HASH_SIZE,new.image_hash,LIF_HASH_SIZE);
+    write_data(fp,header,HEADER_SIZE);
+    copied=0;
+    sent=0;
+    zeroed=0;
+    records=0;
+    for(i=0; i<new.blocks; i=j)
+      {
+        if(match[i] == MATCH_SAME)
+          {
+            j=i+1;
+            continue;
+          }
+        if(match[i] >= 0)
+          {
+            for(j=i+1; j<new.blocks && match[j] == match[i]+(j-i); j++) ;
+            put_record(fp,'C',i,match[i],j-i);
+            copied+=j-i;
+          }
+        else if(match[i] == MATCH_ZERO)
+          {
+            for(j=i+1; j<new.blocks && match[j] == MATCH_ZERO; j++) ;
+            put_record(fp,'Z',i,j-i,0);
+            zeroed+=j-i;
+          }
+        else
+          {
+            for(j=i+1; j<new.blocks && j-i < IO_BLOCKS && match[j] == MATCH_NONE; j++) ;
+            put_record(fp,'D',i,j-i,0);
+            if(lif_read_blocks(new.device,i,(int) (j-i),data)) lif_fatal();
+            write_data(fp,data,(size_t) (j-i)*SECTOR_SIZE);
+            sent+=j-i;
+          }
+        records++;
+      }
+    write_data(fp,"E",1);
+    if(fflush(fp) || (fp != stdout && fclose(fp)))
+      {
+        fprintf(stderr,"Error writing delta\n");
+        exit(1);
+      }
+    if(verbose)
+       fprintf(stderr,"%lld blocks, %lld copied, %lld zeroed, %lld sent, %d records\n",
+               new.blocks,copied,zeroed,sent,records);
+    free(match);
+    free(old.hash);
+    free(new.hash);
+    free(data);
+    if(lif_close(old.device) || lif_close(new.device)) lif_fatal();
+    return(0);
+  }
+
+int apply_delta(char *delta_name, char *image_name)
+  {
+    struct image img;
+    unsigned char header[HEADER_SIZE];
+    unsigned char record[24];
+    unsigned char *data;
+    unsigned char type;
+    lif_blk_t new_blocks, dest, source, blocks, block, copied, sent, zeroed;
+    int count;
+    FILE *fp;
+
+    if(strcmp(delta_name,"-") == 0)
+      {
+        SETMODE_STDIN_BINARY;
+        fp=stdin;
+      }
+    else if((fp=fopen(delta_name,"rb")) == NULL)
+      {
+        fprintf(stderr,"can't open File %s\n",delta_name);
+        exit(2);
+      }
+    if(fread(header,1,HEADER_SIZE,fp) != HEADER_SIZE ||
+       memcmp(header,DELTA_MAGIC,8))
+      {
+        fprintf(stderr,"This is not a lifdelta file\n");
+        exit(1);
+      }
+    new_blocks=(lif_blk_t) get_u64(header+16);
+
+    /* the delta must be applied to the old image */
+    data=xmalloc(IO_BLOCKS*SECTOR_SIZE);
+    img.name=image_name;
+    img.blocks=image_blocks(image_name);
+    if((img.device=lif_open(image_name,O_RDWR | O_BINARY,0,0))==-1)
+      {
+        fprintf(stderr,"Error opening %s: %s\n",image_name,lif_errmsg());
+        exit(1);
+      }
+    hash_image(&img,0,data);
+    if(img.blocks != (lif_blk_t) get_u64(header+8) ||
+       memcmp(img.image_hash,header+24,LIF_HASH_SIZE))
+      {
+        fprintf(stderr,"The delta does not belong to %s\n",image_name);
+        exit(2);
+      }
+
+    copied=0;
+    sent=0;
+    zeroed=0;
+    for(;;)
+      {
+        read_data(fp,&type,1);
+        if(type == 'E') break;
+        if(type == 'C')
+          {
+            read_data(fp,record,24);
+            dest=(lif_blk_t) get_u64(record);
+            source=(lif_blk_t) get_u64(record+8);
+            blocks=(lif_blk_t) get_u64(record+16);
+            if(source < dest || source+blocks > img.blocks)
+              {
+                fprintf(stderr,"Invalid copy record\n");
+                exit(1);
+              }
+            /* forward copy, the source is at or behind the destination */
+            for(block=0; block<blocks; block+=count)
+              {
+                count=IO_BLOCKS;
+                if(blocks-block < IO_BLOCKS) count=(int) (blocks-block);
+                if(lif_read_blocks(img.device,source+block,count,data)) lif_fatal();
+                if(lif_write_blocks(img.device,dest+block,count,data)) lif_fatal();
+              }
+            copied+=blocks;
+          }
+        else if(type == 'D')
+          {
+            read_data(fp,record,16);
+            dest=(lif_blk_t) get_u64(record);
+            blocks=(lif_blk_t) get_u64(record+8);
+            if(blocks > IO_BLOCKS)
+              {
+                fprintf(stderr,"Invalid data record\n");
+                exit(1);
+              }
+            read_data(fp,data,(size_t) blocks*SECTOR_SIZE);
+            if(lif_write_blocks(img.device,dest,(int) blocks,data)) lif_fatal();
+            sent+=blocks;
+          }
+        else if(type == 'Z')
+          {
+            read_data(fp,record,16);
+            dest=(lif_blk_t) get_u64(record);
+            blocks=(lif_blk_t) get_u64(record+8);
+            memset(data,0,IO_BLOCKS*SECTOR_SIZE);
+            for(block=0; block<blocks; block+=count)
+              {
+                count=IO_BLOCKS;
+                if(blocks-block < IO_BLOCKS) count=(int) (blocks-block);
+                if(lif_write_blocks(img.device,dest+block,count,data)) lif_fatal();
+              }
+            zeroed+=blocks;
+          }
+        else
+          {
+            fprintf(stderr,"Invalid record in delta\n");
+            exit(1);
+          }
+      }
+    if(fp != stdin) fclose(fp);
+    if(lif_flush(img.device)) lif_fatal();
+    if(new_blocks != img.blocks && lif_resize(img.device,new_blocks)) lif_fatal();
+
+    /* check the result */
+    img.blocks=new_blocks;
+    hash_image(&img,0,data);
+    free(data);
+    if(lif_close(img.device)) lif_fatal();
+    if(memcmp(img.image_hash,header+24+LIF_HASH_SIZE,LIF_HASH_SIZE))
+      {
+        fprintf(stderr,"%s does not match the new image after applying the delta\n",
+                image_name);
+        exit(2);
+      }
+    if(verbose)
+       fprintf(stderr,"%lld blocks, %lld copied, %lld zeroed, %lld written\n",
+               new_blocks,copied,zeroed,sent);
+    return(0);
+  }
+
+int main(int argc, char **argv)
+  {
+    int option; /* Command line option character */
+    int apply_flag;
+
+    /* Process command line options */
+    optind=1;
+    apply_flag=0;
+    verbose=0;
+    while ((option=getopt(argc,argv,"av?"))!=-1)
+      {
+        switch(option)
+          {
+            case 'a' : apply_flag=1;
+                       break;
+            case 'v' : verbose=1;
+                       break;
+            case '?' : usage();
+                       break;
+          }
+      }
+    if(apply_flag)
+      {
+        if(optind != argc-2) usage();
+        apply_delta(argv[optind],argv[optind+1]);
+      }
+    else
+      {
+        if(optind != argc-3) usage();
+        create_delta(argv[optind],argv[optind+1],argv[optind+2]);
+      }
+    exit(0);
+  }
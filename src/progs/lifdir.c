@@ -3,9 +3,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include "config.h"
 #include "lif_block.h"
+#include "lif_error.h"
 #include "lif_dir_utils.h"
 #include "lif_const.h"
 
@@ -20,19 +22,131 @@
 /* csv separator */
 #define SEP ','
 
+/* output formats */
+#define FMT_LIST 0
+#define FMT_CSV  1
+#define FMT_TSV  2
+#define FMT_JSON 3
+
+/* All output goes through one buffer which is written to standard output
+   when it is full, so a directory entry costs no stdio call per field */
+#define OUT_SIZE 65536
+static char out_buf[OUT_SIZE];
+static int out_len;
+
+/* decimal text of every bcd byte, filled once by init_bcd */
+static char bcd_text[256][4];
+
+static const char hex_digits[]="0123456789ABCDEF";
+
+void out_flush(void)
+  {
+    if(out_len > 0 && fwrite(out_buf,1,out_len,stdout) != (size_t) out_len)
+      {
+        fprintf(stderr,"Error writing output\n");
+        exit(1);
+      }
+    out_len=0;
+  }
+
+void out_mem(const char *s, int n)
+  {
+    if(out_len+n > OUT_SIZE) out_flush();
+    memcpy(out_buf+out_len,s,n);
+    out_len+=n;
+  }
+
+void out_str(const char *s)
+  {
+    out_mem(s,(int) strlen(s));
+  }
+
+void out_char(char c)
+  {
+    if(out_len == OUT_SIZE) out_flush();
+    out_buf[out_len++]=c;
+  }
+
+void out_num(long long n)
+  {
+    char digits[24];
+    int i;
+    unsigned long long u;
+
+    i=sizeof(digits);
+    u= n < 0 ? -(unsigned long long) n : (unsigned long long) n;
+    do
+      {
+        digits[--i]=(char) ('0'+u%10);
+        u/=10;
+      }
+    while(u);
+    if(n < 0) digits[--i]='-';
+    out_mem(digits+i,(int) sizeof(digits)-i);
+  }
+
+/* output a string as json string. The characters of a LIF name
+   (latin1 set) are taken as ISO 8859-1, other strings like the path of
+   the image file are passed through as UTF-8 */
+void out_json_str(const char *s, int n, int latin1)
+  {
+    int i;
+    unsigned char c;
+
+    out_char('"');
+    for(i=0; i<n; i++)
+      {
+        c=(unsigned char) s[i];
+        if(c == '"' || c == '\\')
+          {
+            out_char('\\');
+            out_char((char) c);
+          }
+        else if(c < 0x20 || c == 0x7F || (latin1 && c > 0x7F))
+          {
+            out_mem("\\u00",4);
+            out_char(hex_digits[c>>4]);
+            out_char(hex_digits[c & 0x0F]);
+          }
+        else out_char((char) c);
+      }
+    out_char('"');
+  }
+
+void init_bcd(void)
+  {
+    int i;
+
+    for(i=0; i<256; i++)
+       sprintf(bcd_text[i],"%02d",bcd_to_dec((unsigned char) i));
+  }
+
 void print_date(unsigned char *date)
   {
     /* Print an HP-style date and time stamp. On entry, date points to
        the first byte of a 6-byte time stamp */
-    printf("%02d/%02d/%02d %02d:%02d:%02d",
-         bcd_to_dec(*(date+DAY_OFF)),
-         bcd_to_dec(*(date+MONTH_OFF)),
-         bcd_to_dec(*(date+YEAR_OFF)),
-         bcd_to_dec(*(date+HOUR_OFF)),
-         bcd_to_dec(*(date+MINUTE_OFF)),
-         bcd_to_dec(*(date+SECOND_OFF)));
+    out_str(bcd_text[*(date+DAY_OFF)]);
+    out_char('/');
+    out_str(bcd_text[*(date+MONTH_OFF)]);
+    out_char('/');
+    out_str(bcd_text[*(date+YEAR_OFF)]);
+    out_char(' ');
+    out_str(bcd_text[*(date+HOUR_OFF)]);
+    out_char(':');
+    out_str(bcd_text[*(date+MINUTE_OFF)]);
+    out_char(':');
+    out_str(bcd_text[*(date+SECOND_OFF)]);
+  }
+
+/* length of a file name without the trailing blanks */
+int name_length(unsigned char *entry)
+  {
+    int len;
+
+    for(len=0; len<NAME_LEN && entry[len] != ' '; len++) ;
+    return(len);
   }
-       
+
 void print_dir_entry(unsigned char *entry, int verbosity)
   {
     /* Decode and print a directory entry. entry points to a 32 byte 
@@ -40,107 +154,140 @@ void print_dir_entry(unsigned char *entry, int verbosity)
        owner's manual */
     int i; /* general counter */
     int length; /* File length from directory */
-    int total_blocks; /* Number of blocks occupied by file */
-    int start_block; /* file start block */
-    unsigned int implementation_byte; /* implementation byte */
+    lif_blk_t total_blocks; /* Number of blocks occupied by file */
+    lif_blk_t start_block; /* file start block */
+    char line[80]; /* formatted fields */
 
     char file_type[10]; /* storage for the file type string */
 
     /* Print the filename */
-    for(i=0; i<10; i++)
-      {
-        putchar(*(entry+i));
-      }
+    out_mem((char *) entry,NAME_LEN);
     /* default directory listing */
     if(verbosity > 0)
       {
        /* find and print the file type */
        length=file_length(entry,file_type);
-       printf("  %-10s  ",file_type);
        total_blocks=get_lif_int(entry+16,4);
        /* Print the length, both from the directory, and from the number of 
           blocks */
-       printf("%5d/%-5d    ",length,total_blocks*256);
+       sprintf(line,"  %-10s  %5d/%-5lld    ",file_type,length,total_blocks*256);
+       out_str(line);
        /* Print the file time and date */
        if(*(entry+21))
          {
            /* If the month is not 0, it's a valid date */
            print_date(entry+20);
          }
-       else printf("                 ");
+       else out_str("                 ");
       }
     /* output additional information */
     if (verbosity > 1)
       {
        start_block=get_lif_int(entry+12,4);
-       printf("%5d %5d ",start_block, total_blocks);
+       total_blocks=get_lif_int(entry+16,4);
+       sprintf(line,"%5lld %5lld ",start_block, total_blocks);
+       out_str(line);
        for(i=0; i<6; i++)
          {
-            implementation_byte=(unsigned char) get_lif_int(entry+26+i,1);
-            printf("%02X",implementation_byte);
+            out_char(hex_digits[entry[26+i]>>4]);
+            out_char(hex_digits[entry[26+i] & 0x0F]);
          }
-            
       }
     
-    printf("\n");
+    out_char('\n');
   } 
 
-void csv_dir_entry(unsigned char *entry)
+void sep_dir_entry(unsigned char *entry, char sep)
   {
-    /* Decode a directory entry and output it as csv. entry points to a 32 
-       byte directory entry, as described in appendix D of the HP71 HPIL
-       owner's manual */
+    /* Decode a directory entry and output it as csv or tab separated
+       values. entry points to a 32 byte directory entry, as described in
+       appendix D of the HP71 HPIL owner's manual */
     int i; /* general counter */
     int length; /* File length from directory */
     char file_type[10]; /* storage for the file type string */
 
     /* output the filename */
-    for(i=0; i<10; i++)
-      {
-	if( *(entry+i) == ' ') break;
-        putchar(*(entry+i));
-      }
-    printf("%c",SEP);
+    out_mem((char *) entry,name_length(entry));
+    out_char(sep);
 
     /* output the file type */
     length=file_length(entry,file_type);
-    printf("%s",file_type);
-    printf("%c",SEP);
+    out_str(file_type);
+    out_char(sep);
 
     /* output the file type in hex */
-    printf("%d", get_lif_int(entry+10,2));
-    printf("%c",SEP);
+    out_num(get_lif_int(entry+10,2));
+    out_char(sep);
 
     /* output the file length */
-    printf("%d",length);
-    printf("%c",SEP);
+    out_num(length);
+    out_char(sep);
 
     /* output the start block */
-    printf("%d",get_lif_int(entry+12,4));
-    printf("%c",SEP);
+    out_num(get_lif_int(entry+12,4));
+    out_char(sep);
 
     /* output the number of blocks */
-    printf("%d",get_lif_int(entry+16,4));
+    out_num(get_lif_int(entry+16,4));
 
     /* output date and time */
     for (i=0; i<6; i++) 
       {
-	 printf("%c",SEP);
-         printf("%d",bcd_to_dec(*(entry+20+i)));
+         out_char(sep);
+         out_num(bcd_to_dec(*(entry+20+i)));
       }
 
     /* output the impelentation bytes */
     for(i=0; i<6; i++)
       {
-         printf("%c",SEP);
-         printf("%d",get_lif_int(entry+26+i,1));
+         out_char(sep);
+         out_num(entry[26+i]);
       }
-    printf("\n");
+    out_char('\n');
   } 
 
+void json_dir_entry(const char *image, unsigned char *entry)
+  {
+    /* Decode a directory entry and output it as one json object */
+    int i; /* general counter */
+    int length; /* File length from directory */
+    char file_type[10]; /* storage for the file type string */
+
+    out_str("{\"image\":");
+    out_json_str(image,(int) strlen(image),0);
+    out_str(",\"name\":");
+    out_json_str((char *) entry,name_length(entry),1);
+    length=file_length(entry,file_type);
+    out_str(",\"type\":");
+    out_json_str(file_type,(int) strlen(file_type),0);
+    out_str(",\"type_code\":");
+    out_num(get_lif_int(entry+10,2));
+    out_str(",\"length\":");
+    out_num(length);
+    out_str(",\"start\":");
+    out_num(get_lif_int(entry+12,4));
+    out_str(",\"blocks\":");
+    out_num(get_lif_int(entry+16,4));
+    out_str(",\"date\":");
+    if(*(entry+21))
+      {
+        out_char('"');
+        print_date(entry+20);
+        out_char('"');
+      }
+    else out_str("null");
+    out_str(",\"implementation\":\"");
+    for(i=0; i<6; i++)
+      {
+         out_char(hex_digits[entry[26+i]>>4]);
+         out_char(hex_digits[entry[26+i] & 0x0F]);
+      }
+    out_str("\"}\n");
+  }
+
 void usage(void)
   {
-     fprintf(stderr,"Usage:lifdir [-n] [-v l] <lif-image-file>\n");
+     fprintf(stderr,"Usage:lifdir [-n] [-v l] [-c | -t | -j] <lif-image-file> ...\n");
      fprintf(stderr,"\n");
      fprintf(stderr,"      -n flag to display file names only\n");
      fprintf(stderr,"      -v l verbosity level\n");
@@ -150,32 +297,31 @@ void usage(void)
      fprintf(stderr,"              implementation bytes to directory listing\n");
      fprintf(stderr,"      -c output all directory information as csv,\n");
      fprintf(stderr,"         see program documentation for details.\n");
+     fprintf(stderr,"      -t output all directory information as tab separated\n");
+     fprintf(stderr,"         values, preceded by the image file name\n");
+     fprintf(stderr,"      -j output all directory information as json, one\n");
+     fprintf(stderr,"         object per file\n");
      fprintf(stderr,"\n");
-     fprintf(stderr,"         Note: verbosity level and csv output options are\n");
-     fprintf(stderr,"         mutually exclusive.\n");
+     fprintf(stderr,"         Note: verbosity level and csv, tsv or json output options\n");
+     fprintf(stderr,"         are mutually exclusive.\n");
      exit(1);
   }
 
-int main(int argc, char **argv)
+/* list the directory of one image, returns -1 on error */
+int list_image(char *image, int format, int verbosity, int physical_flag)
   {
-    /* system variables */
-    int option; /* Command line option character */
     int input_device; /* Input file or device descriptor */
-    int verbosity;    /* extent of information */
-    int csv_flag;     /* csv output */
-    int physical_flag; /* pyhsical disk access flag */
-    char *snum_verbosity= (char *) NULL; /* arg to -v option */
-    int i; /* General index counter */
     unsigned char data[SECTOR_SIZE]; /* buffer to hold current block */
+    char line[80]; /* formatted volume information */
 
     /* LIF disk values */
     unsigned int dir_start; /* first block of directory */
     unsigned int dir_length; /* Number of blocks in directory */
-    unsigned int last_block; /* last used block on the disk */
+    lif_blk_t last_block; /* last used block on the disk */
     unsigned int surfaces;  /* no of disk surfaces in lif header */
     unsigned int tracks; /* no of tracks in lif header */
     unsigned int blocks; /* no of blocks in lif header */
-    unsigned int totalsize; /* size of medium in blocks */
+    lif_blk_t totalsize; /* size of medium in blocks */
     unsigned int num_files; /* number of files on medium */
 
 
@@ -184,103 +330,62 @@ int main(int argc, char **argv)
     unsigned int dir_entry; /* Directory entry within current block */
     unsigned int dir_block; /* Current block offset from start of directory */
     unsigned int file_type; /* File type word */
+    unsigned char *entry;
 
     /* file specific values */
     unsigned int file_start;
     unsigned int file_len;
 
-    /* process command line options */
-    optind=1;
-    physical_flag=0;
-    verbosity=-1;
-    csv_flag=0;
-    while((option=getopt(argc,argv,"v:npc?"))!=-1)
-      {
-        switch(option)
-          {
-             case 'n' : verbosity=0;
-                        break;
-             case 'v' : snum_verbosity=optarg;
-                        break;
-             case 'p' : physical_flag=1;
-                        break;
-             case 'c' : csv_flag=1;
-                        break;
-             case '?' : usage();
-           }
-       }
-
-    /* Is one input device specified? */
-    if(optind != argc-1)
-      {
-        /* if not, give error */
-        usage();
-      }
-    /* get number of verbosity level */
-    if ( snum_verbosity != (char *) NULL) {
-       if (sscanf(snum_verbosity,"%d",&verbosity) !=1) {
-          printf("Err2");
-          usage();
-       }
-       if (verbosity < 0 || verbosity > 2) usage();
-    }
-
-    /* error if verbosity and csv specified */
-    if (csv_flag == 1 && verbosity != -1) usage();
-
-    /* set default verbodity level if not specified or csv */
-    if (verbosity == -1) {
-       if (csv_flag == 1) verbosity=0;
-       else verbosity=1;
-    }
-    
     /* open input device */
-    if((input_device=lif_open(argv[argc-1],O_RDONLY | O_BINARY,0,physical_flag))==-1)
+    if((input_device=lif_open(image,O_RDONLY | O_BINARY,0,physical_flag))==-1)
       {
-        fprintf(stderr,"Error opening %s\n",argv[argc-1]);
-        exit(1);
+        out_flush();
+        fprintf(stderr,"Error opening %s: %s\n",image,lif_errmsg());
+        return(-1);
       }
 
     /* Now read block 0, the volume label block */
-    lif_read_block(input_device,0,data);
+    if (lif_read_block(input_device,0,data)) goto error;
 
     /* Check that this is a LIF disk or image */
     if(get_lif_int(data+0,2)!=0x8000)
       {
-        fprintf(stderr,"This is not a LIF disk!\n");
-        exit(1);
+        out_flush();
+        fprintf(stderr,"%s: This is not a LIF disk!\n",image);
+        lif_close(input_device);
+        return(-1);
       }
+    totalsize=0;
     if(verbosity > 0) 
       {
-       printf("Volume : ");
+       out_str("Volume : ");
        if((*(data+2))!=' ')
        {
            /* There is a volume label */
-           for(i=2; i<8; i++)
-             {
-               putchar(*(data+i));
-             }
-           printf(" ");
+           out_mem((char *) data+2,6);
+           out_char(' ');
           }
 
         /* If the time stamp month is non-zero, print the time stamp */
        if(*(data+37))
          {
-           printf(", formatted : "); 
+           out_str(", formatted : "); 
            print_date(data+36);
          }
-       printf("\n");
+       out_char('\n');
       /* Print volume size */
       tracks=get_lif_int(data+24,4);
       surfaces=get_lif_int(data+28,4);
       blocks=get_lif_int(data+32,4);
-      totalsize= tracks*surfaces*blocks;
-      printf("Tracks: %d Surfaces: %d Blocks/Track: %d",tracks,surfaces,blocks);
+      totalsize= (lif_blk_t) tracks*surfaces*blocks;
+      sprintf(line,"Tracks: %d Surfaces: %d Blocks/Track: %d",tracks,surfaces,blocks);
+      out_str(line);
       if(totalsize==0 || blocks == 0x9a009a0)
       {
-         printf(".\nWarning the medium was not initialized properly!\n");
+         out_str(".\nWarning the medium was not initialized properly!\n");
       } else {
-         printf(" Total size: %d Blocks, %d Bytes\n",totalsize,totalsize*256);
+         sprintf(line," Total size: %lld Blocks, %lld Bytes\n",totalsize,totalsize*256);
+         out_str(line);
       }
     }
 
@@ -294,10 +399,11 @@ int main(int argc, char **argv)
     for(dir_block=0; dir_block<dir_length; dir_block++)
       {
          dir_end=0;
-         lif_read_block(input_device,dir_block+dir_start,data);
+         if (lif_read_block(input_device,dir_block+dir_start,data)) goto error;
          for(dir_entry=0; dir_entry<8; dir_entry++)
            {
-             file_type=get_lif_int((data+(dir_entry<<5)+10),2);
+             entry=data+(dir_entry<<5);
+             file_type=get_lif_int(entry+10,2);
              if(file_type==0) { continue; } /* Skip over deleted files */
              if(file_type==0xffff)
                {
@@ -305,27 +411,129 @@ int main(int argc, char **argv)
                  dir_end=1;
                  break;
                }
-	    if ( csv_flag) 
-	      {
-                 csv_dir_entry(data+(dir_entry<<5));
-	      }
-	    else
-	      {
-                 print_dir_entry(data+(dir_entry<<5),verbosity);
-	      }
-            file_start=get_lif_int(data+(dir_entry<<5)+12,4);
-            file_len=get_lif_int(data+(dir_entry<<5)+16,4);
+             switch(format)
+               {
+                 case FMT_CSV  : sep_dir_entry(entry,SEP);
+                                 break;
+                 case FMT_TSV  : out_str(image);
+                                 out_char('\t');
+                                 sep_dir_entry(entry,'\t');
+                                 break;
+                 case FMT_JSON : json_dir_entry(image,entry);
+                                 break;
+                 default       : print_dir_entry(entry,verbosity);
+                                 break;
+               }
+            file_start=get_lif_int(entry+12,4);
+            file_len=get_lif_int(entry+16,4);
             /* update last used block */
-            last_block=file_start+file_len-1;
+            last_block=(lif_blk_t) file_start+file_len-1;
             num_files++;
            }
          if(dir_end) { break; } /* Quit at end of directory */
       }
-    lif_close(input_device);
+    if (lif_close(input_device))
+      {
+        out_flush();
+        fprintf(stderr,"%s: %s\n",image,lif_errmsg());
+        return(-1);
+      }
     if(verbosity > 0) {
-       printf("%d files (%d max), ",num_files,dir_length*8);
-       printf("last block used: %d of %d\n",last_block,totalsize);
+       sprintf(line,"%d files (%d max), ",num_files,dir_length*8);
+       out_str(line);
+       sprintf(line,"last block used: %lld of %lld\n",last_block,totalsize);
+       out_str(line);
     }
-    exit(0); 
+    return(0);
+
+error:
+    out_flush();
+    fprintf(stderr,"%s: %s\n",image,lif_errmsg());
+    lif_close(input_device);
+    return(-1);
   }
 
+int main(int argc, char **argv)
+  {
+    /* system variables */
+    int option; /* Command line option character */
+    int verbosity;    /* extent of information */
+    int format;       /* output format */
+    int physical_flag; /* pyhsical disk access flag */
+    char *snum_verbosity= (char *) NULL; /* arg to -v option */
+    int i; /* General index counter */
+    int errors; /* images which could not be listed */
+
+    /* process command line options */
+    optind=1;
+    physical_flag=0;
+    verbosity=-1;
+    format=FMT_LIST;
+    while((option=getopt(argc,argv,"v:npctj?"))!=-1)
+      {
+        switch(option)
+          {
+             case 'n' : verbosity=0;
+                        break;
+             case 'v' : snum_verbosity=optarg;
+                        break;
+             case 'p' : physical_flag=1;
+                        break;
+             case 'c' : if (format != FMT_LIST) usage();
+                        format=FMT_CSV;
+                        break;
+             case 't' : if (format != FMT_LIST) usage();
+                        format=FMT_TSV;
+                        break;
+             case 'j' : if (format != FMT_LIST) usage();
+                        format=FMT_JSON;
+                        break;
+             case '?' : usage();
+           }
+       }
+
+    /* Is at least one input device specified? */
+    if(optind > argc-1)
+      {
+        /* if not, give error */
+        usage();
+      }
+    /* get number of verbosity level */
+    if ( snum_verbosity != (char *) NULL) {
+       if (sscanf(snum_verbosity,"%d",&verbosity) !=1) {
+          printf("Err2");
+          usage();
+       }
+       if (verbosity < 0 || verbosity > 2) usage();
+    }
+
+    /* error if verbosity and csv, tsv or json specified */
+    if (format != FMT_LIST && verbosity != -1) usage();
+
+    /* set default verbodity level if not specified or csv */
+    if (verbosity == -1) {
+       if (format != FMT_LIST) verbosity=0;
+       else verbosity=1;
+    }
+
+    init_bcd();
+    errors=0;
+    for(i=optind; i<argc; i++)
+      {
+        /* separate the listings of several images */
+        if(format == FMT_LIST && argc-optind > 1)
+          {
+            if(i > optind) out_char('\n');
+            out_str(argv[i]);
+            out_str(":\n");
+          }
+        if(list_image(argv[i],format,verbosity,physical_flag)) errors++;
+      }
+    out_flush();
+    if(fflush(stdout))
+      {
+        fprintf(stderr,"Error writing output\n");
+        exit(1);
+      }
+    exit(errors ? 1 : 0); 
+  }
@@ -9,6 +9,7 @@
 #include<fcntl.h>
 #include <stdlib.h>
 #include"lif_phy.h"
+#include "lif_error.h"
 #include "lif_const.h"
 
 
@@ -36,7 +37,7 @@ int main(int argc, char **argv)
     /* open descriptor for output disk drive */
     if((output_device=lif_open_phy_device(argv[argc-1]))==-1)
       {
-        fprintf(stderr,"Error opening device %s\n",argv[argc-1]);
+        fprintf(stderr,"Error opening device %s: %s\n",argv[argc-1],lif_errmsg());
         exit(1);
       }
 
@@ -53,7 +54,7 @@ int main(int argc, char **argv)
     /* Now start writing to the disk */
     for(cylinder=0; cylinder<77; cylinder++)
       {
-        lif_seek_phy_device(output_device,cylinder);
+        if (lif_seek_phy_device(output_device,cylinder)) lif_fatal();
         for(head=0; head<2; head++)
           {
             for(sector=1; sector<17; sector++)
@@ -64,11 +65,11 @@ int main(int argc, char **argv)
                     fprintf(stderr,"Error reading input file\n");
                     exit(1);
                   }
-                lif_write_phy_device(output_device,cylinder,head,sector,data);
+                if (lif_write_phy_device(output_device,cylinder,head,sector,data)) lif_fatal();
               }
           }
       }
-    lif_close_phy_device(output_device);
+    if (lif_close_phy_device(output_device)) lif_fatal();
     if(argc==3)
       {
         fclose(input_file);
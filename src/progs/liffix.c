@@ -9,6 +9,7 @@
 #include <sys/stat.h>
 #include "config.h"
 #include "lif_block.h"
+#include "lif_error.h"
 #include "lif_dir_utils.h"
 #include "lif_const.h"
 #include "lif_create_entry.h"
@@ -82,11 +83,11 @@ int main(int argc, char **argv)
     /* Open lif device */
     if((lif_device=lif_open(argv[optind],O_RDWR | O_BINARY,0,physical_flag))==-1)
       {
-        fprintf(stderr,"Error opening %s\n",argv[optind]);
+        fprintf(stderr,"Error opening %s: %s\n",argv[optind],lif_errmsg());
         exit(1);
       }
     /* Now read block 0 to find where the directory is */
-    lif_read_block(lif_device,0,sector_data);
+    if (lif_read_block(lif_device,0,sector_data)) lif_fatal();
 
     /* Make sure it's a LIF disk */
     if(get_lif_int(sector_data+0,2)!=0x8000)
@@ -103,7 +104,7 @@ int main(int argc, char **argv)
     for(dir_block=0; dir_block<dir_length; dir_block++)
       {
          dir_end=0;
-         lif_read_block(lif_device,dir_block+dir_start,dir_data);
+         if (lif_read_block(lif_device,dir_block+dir_start,dir_data)) lif_fatal();
          for(dir_entry=0; dir_entry<8; dir_entry++)
            {
              file_type=get_lif_int((dir_data+(dir_entry<<5)+10),2);
@@ -183,8 +184,8 @@ int main(int argc, char **argv)
     put_lif_int(sector_data+20,2,1);
 
     /* Now write block 0  */
-    lif_write_block(lif_device,0,sector_data);
+    if (lif_write_block(lif_device,0,sector_data)) lif_fatal();
     /* tidy up and quit */
-    lif_close(lif_device);
+    if (lif_close(lif_device)) lif_fatal();
     exit(0);      
   }
@@ -4,8 +4,13 @@
 #include<stdio.h>
 #include<fcntl.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "config.h"
 #include"lif_block.h"
+#include "lif_error.h"
 #include"lif_dir_utils.h"
 #include "lif_const.h"
 
@@ -17,42 +22,198 @@ void usage(void)
     "Usage:lifget [-r] [-b] lif-image-filename filename output-file\n");
     fprintf(stderr,"      lifget [-r] [-b] lif-image-filename filename\n");
     fprintf(stderr,"      (Output goes to standard output)\n");
+    fprintf(stderr,"      lifget [-r] [-b] -d output-directory lif-image-filename name ...\n");
+    fprintf(stderr,"      (name is a file name, a pattern with * and ? or all)\n");
+    fprintf(stderr,"      lif-image-filename - reads the image from standard input\n");
     fprintf(stderr,"\n");
     fprintf(stderr,
     "      -r flag to remove directory entry on start of file \n"); 
     fprintf(stderr,"      -b flag to copy the blocks used by the file,\n");
     fprintf(stderr,"          ignoring the file length information\n");
+    fprintf(stderr,"      -d extract the selected files to output-directory\n");
     exit(1);
   }
 
 void file_copy(int input_device, FILE* output_file, 
-               int start, int length)
+               lif_blk_t start, long long length)
   {
     /* Copy length bytes starting at block start from LIF input_device
        to output_file */
   
-    unsigned int complete_blocks; /* Number of complete blocks to copy */
+    lif_blk_t complete_blocks; /* Number of complete blocks to copy */
     unsigned int leftover_bytes; /* And the odd bytes on the end */
-    unsigned int block; /* Current block offset from start */
-    unsigned char data[SECTOR_SIZE];
+    lif_blk_t block; /* Current block offset from start */
+    int count; /* Number of blocks in this transfer */
+    unsigned char *data;
 
+    data=malloc(IO_BLOCKS*SECTOR_SIZE);
+    if(data == (unsigned char *) NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
     complete_blocks=length/SECTOR_SIZE;
-    if(complete_blocks!=0)
+    /* Copy the complete blocks first, IO_BLOCKS blocks at a time */
+    for(block=0; block<complete_blocks; block+=count)
       {
-        /* Copy the complete blocks first */
-        for(block=0; block<complete_blocks; block++)
-          {
-            lif_read_block(input_device,start+block,data);
-            fwrite(data,sizeof(char),SECTOR_SIZE,output_file);
-          }
+        count=IO_BLOCKS;
+        if(complete_blocks-block < IO_BLOCKS) count=(int) (complete_blocks-block);
+        if (lif_read_blocks(input_device,start+block,count,data)) lif_fatal();
+        fwrite(data,sizeof(char),(size_t) count*SECTOR_SIZE,output_file);
       }
-    leftover_bytes=length%SECTOR_SIZE;
+    leftover_bytes=(unsigned int) (length%SECTOR_SIZE);
     if(leftover_bytes!=0)
       {
         /* Odd bytes on the end -- read one more block */
-        lif_read_block(input_device,start+complete_blocks,data);
+        if (lif_read_block(input_device,start+complete_blocks,data)) lif_fatal();
         fwrite(data,sizeof(char),leftover_bytes,output_file);
       }
+    free(data);
+  }
+
+void get_file(int input_device, FILE *output_file, unsigned char *entry,
+              int remove_dir_flag, int block_flag)
+  {
+    /* Copy the file of a directory entry to output_file */
+
+    lif_blk_t file_start; /* Starting block number of the file to copy */
+    long long file_len; /* Length of file in bytes */
+
+    /* If the -r flag was not specified, send the directory entry */
+    if(! remove_dir_flag)
+      {
+        fwrite(entry,sizeof(char),32,output_file);
+      }
+
+    /* Find the file start and length */
+    file_start=get_lif_int(entry+12,4);
+    if(block_flag)
+      {
+        file_len=(long long) get_lif_int(entry+16,4)*256;
+      }
+    else
+      {
+        file_len=file_length(entry,NULL);
+      }
+
+    /* Actually copy the file */ 
+    file_copy(input_device,output_file,file_start,file_len);
+  }
+
+static int compare_start(const void *a, const void *b)
+  {
+    lif_blk_t start_a, start_b;
+
+    start_a= get_lif_int(*(unsigned char * const *) a+12,4);
+    start_b= get_lif_int(*(unsigned char * const *) b+12,4);
+    return((start_a > start_b) - (start_a < start_b));
+  }
+
+/* create a new output file, an existing file is not overwritten */
+static FILE *create_output(char *path)
+  {
+    int fd;
+    FILE *fp;
+
+    fd=open(path,O_CREAT | O_EXCL | O_WRONLY | O_BINARY,
+            S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if(fd == -1) return((FILE *) NULL);
+    if((fp=fdopen(fd,"wb")) == (FILE *) NULL) close(fd);
+    return(fp);
+  }
+
+int get_files(int input_device, struct lif_dir *dir, char *output_dir,
+              char **names, int num_names, int remove_dir_flag,
+              int block_flag)
+  {
+    /* Copy all files selected by names to output_dir. The files are
+       copied in the order of their start blocks, so the medium is read
+       front to back once. Files with an illegal name or an existing
+       output file are skipped, returns the number of skipped files */
+
+    unsigned char **selected; /* directory entries of selected files */
+    char *selected_flags; /* slot was selected */
+    int num_selected;
+    int found; /* a name selected a file */
+    int slot, i, len, errors;
+    unsigned char *entry;
+    char name[NAME_LEN+1];
+    char *path;
+    FILE *output_file;
+
+    selected=malloc((dir->used+1)*sizeof(unsigned char *));
+    selected_flags=calloc(dir->used+1,1);
+    path=malloc(strlen(output_dir)+NAME_LEN+2);
+    if(selected == NULL || selected_flags == NULL || path == NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+
+    /* select files, a file is selected once even if several names
+       match it */
+    num_selected=0;
+    for(i=0; i<num_names; i++)
+      {
+        if(strcmp(names[i],"all") && strpbrk(names[i],"*?") == NULL &&
+           check_filename(names[i])==0)
+          {
+            fprintf(stderr,"Illegal file name %s\n",names[i]);
+            exit(1);
+          }
+        found=0;
+        for(slot=0; slot<dir->used; slot++)
+          {
+            entry=lif_dir_entry(dir,slot);
+            if(get_lif_int(entry+10,2)==0) continue; /* Skip deleted files */
+            if(strcmp(names[i],"all") && !match_name(names[i],(char *) entry))
+               continue;
+            found=1;
+            if(selected_flags[slot]) continue;
+            selected_flags[slot]=1;
+            selected[num_selected++]=entry;
+          }
+        if(!found && strcmp(names[i],"all"))
+          {
+            /* Give file not found error */
+            fprintf(stderr,"File %s not found\n",names[i]);
+            exit(2);
+          }
+      }
+    qsort(selected,num_selected,sizeof(unsigned char *),compare_start);
+
+    /* the output file is named like the LIF file, a name from the medium
+       must not leave output_dir */
+    errors=0;
+    for(i=0; i<num_selected; i++)
+      {
+        for(len=NAME_LEN; len>0 && selected[i][len-1]==' '; len--) ;
+        sprintf(name,"%.*s",len,(char *) selected[i]);
+        if(check_filename(name) == 0)
+          {
+            fprintf(stderr,"Illegal file name %s on medium\n",name);
+            errors++;
+            continue;
+          }
+        sprintf(path,"%s/%s",output_dir,name);
+        output_file=create_output(path);
+        if(output_file == (FILE *) NULL)
+          {
+            if(errno == EEXIST)
+               fprintf(stderr,"File %s already exists\n",path);
+            else
+               fprintf(stderr,"can't open File %s\n",path);
+            errors++;
+            continue;
+          }
+        get_file(input_device,output_file,selected[i],remove_dir_flag,
+                 block_flag);
+        fclose(output_file);
+      }
+    free(selected);
+    free(selected_flags);
+    free(path);
+    return(errors);
   }
 
 int main(int argc, char **argv)
@@ -62,37 +223,31 @@ int main(int argc, char **argv)
     int remove_dir_flag; /* Remove directory entry on start of output */
     int block_flag; /* Copy blocks */
     int physical_flag; /* Option to use a physical device */
+    char *output_dir; /* output directory of several files */
+    int errors; /* files which were not extracted */
 
     int input_device; /* Descriptor of input device */
     FILE *output_file; /* Output file stream */
     char cmp_name[10]; /* File name to look for */
     
     /* LIF disk values */
-    unsigned int dir_start; /* first block of the directory */
-    unsigned int dir_length; /* length of directory in blocks */
-
-    /* Directory search values */
-    unsigned int dir_end; /* Set at end of directory */
-    unsigned int found_file; /* Set when file found */
-    unsigned int dir_entry; /* Directory entry within current block */
-    unsigned int dir_block; /* Current block offset from start of directory */
-    unsigned int file_type; /* file type word */
-    unsigned char dir_data[SECTOR_SIZE]; /* Current directory block data */
-
-    /* File values */
-    int file_start; /* Starting block number of the file to copy */
-    int file_len; /* Length of file in bytes */
+    struct lif_dir *dir; /* directory of the medium */
+    int slot; /* directory slot of the file */
+    unsigned char *entry; /* directory entry of the file */
 
     /* Process command line options */
     remove_dir_flag=0;
     block_flag=0;
     physical_flag=0;
+    output_dir=NULL;
 
     optind=1;
-    while ((option=getopt(argc,argv,"prb?"))!=-1)
+    while ((option=getopt(argc,argv,"prbd:?"))!=-1)
       {
         switch(option)
           {
+            case 'd' : output_dir=optarg;
+                       break;
             case 'r' : remove_dir_flag=1;
                        break;
             case 'b' : block_flag=1;
@@ -104,14 +259,18 @@ int main(int argc, char **argv)
       }
 
     /* Are the right number of names specified ? */
-    if( (optind != argc-2) && (optind != argc-3) )
+    if(output_dir != NULL)
+      {
+        if(optind > argc-2) usage();
+      }
+    else if( (optind != argc-2) && (optind != argc-3) )
       {
         /* No, give an error */
         usage();
       }
 
     /* Check file name */
-    if(check_filename(argv[optind+1])==0)
+    if(output_dir == NULL && check_filename(argv[optind+1])==0)
       {
         fprintf(stderr,"Illegal file name\n");
         exit(1);
@@ -121,55 +280,30 @@ int main(int argc, char **argv)
     /* Open input device */
     if((input_device=lif_open(argv[optind],O_RDONLY | O_BINARY,0,physical_flag))==-1)
       {
-        fprintf(stderr,"Error opening %s\n",argv[optind]);
+        fprintf(stderr,"Error opening %s: %s\n",argv[optind],lif_errmsg());
         exit(1);
       }
 
 
-    /* Now read block 0 to find where the directory is */
-    lif_read_block(input_device,0,dir_data);
+    /* Read the directory */
+    if((dir=lif_dir_open(input_device))==NULL) lif_fatal();
 
-    /* Make sure it's a LIF disk */
-    if(get_lif_int(dir_data+0,2)!=0x8000)
+    /* Extract several files */
+    if(output_dir != NULL)
       {
-        fprintf(stderr,"This is not a LIF disk!\n");
-        exit(1);
+        errors=get_files(input_device,dir,output_dir,argv+optind+1,
+                         argc-optind-1,remove_dir_flag,block_flag);
+        lif_dir_close(dir);
+        if (lif_close(input_device)) lif_fatal();
+        exit(errors ? 2 : 0);
       }
 
-    /* Find the directory */
-    dir_start=get_lif_int(dir_data+8,4);
-    dir_length=get_lif_int(dir_data+16,4);
-
     /* Pad the filename with spaces to enable comparison */
     pad_name(argv[optind+1],cmp_name);
 
-    /* Scan the directory */
-    dir_end=0;
-    found_file=0;
-    for(dir_block=0; dir_block<dir_length; dir_block++)
-      {
-        lif_read_block(input_device,dir_block+dir_start,dir_data);
-        for(dir_entry=0; dir_entry<8; dir_entry++)
-          {
-            file_type=get_lif_int(dir_data+(dir_entry<<5)+10,2);
-            if(file_type==0) { continue; } /* Skip deleted files */ 
-            if(file_type==0xFFFF)
-              {
-                /* End of directory */
-                dir_end=1;
-                break;
-              }
-            if(compare_names((char *)dir_data+(dir_entry<<5),cmp_name))
-              {
-                /* Found the file */
-                found_file=1;
-                break;
-              }
-          }
-        if(dir_end || found_file) { break; }; /* Quit at end or if file found */
-      }
-
-    if(!found_file)
+    /* Look up the file */
+    slot=lif_dir_find(dir,cmp_name);
+    if(slot == -1)
       {
         /* Give file not found error */
         fprintf(stderr,"File %s not found\n",argv[optind+1]);
@@ -187,31 +321,15 @@ int main(int argc, char **argv)
         output_file=stdout;
       }
 
-    /* If the -d flag was specified, send the directory entry */
-    if(! remove_dir_flag)
-      {
-        fwrite(dir_data+(dir_entry<<5),sizeof(char),32,output_file);
-      }
-
-    /* Find the file start and length */
-    file_start=get_lif_int(dir_data+(dir_entry<<5)+12,4);
-    if(block_flag)
-      {
-        file_len=get_lif_int(dir_data+(dir_entry<<5)+16,4)*256;
-      }
-    else
-      {
-        file_len=file_length(dir_data+(dir_entry<<5),NULL);
-      }
-
-    /* Actually copy the file */ 
-    file_copy(input_device,output_file,file_start,file_len);
+    entry=lif_dir_entry(dir,slot);
+    get_file(input_device,output_file,entry,remove_dir_flag,block_flag);
 
     /* tidy up and quit */
     if(optind==argc-3)
       {
         fclose(output_file);
       }
-    lif_close(input_device);
+    lif_dir_close(dir);
+    if (lif_close(input_device)) lif_fatal();
     exit(0);      
   }
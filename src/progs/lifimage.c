@@ -15,6 +15,7 @@
 #include<fcntl.h>
 #include <stdlib.h>
 #include"lif_phy.h"
+#include "lif_error.h"
 #include "lif_const.h"
 
 
@@ -44,7 +45,7 @@ int main(int argc, char **argv)
     /* open file descriptor for disk drive */
     if((input_device=lif_open_phy_device(argv[1]))==-1)
       {
-         fprintf(stderr,"Error opening device %s\n",argv[1]);
+         fprintf(stderr,"Error opening device %s: %s\n",argv[1],lif_errmsg());
          exit(1);
       }
 
@@ -61,12 +62,12 @@ int main(int argc, char **argv)
      /* Now start reading the disk */
     for(cylinder=0; cylinder<77; cylinder++)
       {
-         lif_seek_phy_device(input_device,cylinder);
+         if (lif_seek_phy_device(input_device,cylinder)) lif_fatal();
          for(head=0; head<2; head++)
            {
              for(sector=1; sector<17; sector++)
                {
-                 lif_read_phy_device(input_device,cylinder,head,sector,data);
+                 if (lif_read_phy_device(input_device,cylinder,head,sector,data)) lif_fatal();
                  if(fwrite(data,sizeof(char),SECTOR_SIZE,output_file)
                     !=SECTOR_SIZE)
                    {
@@ -76,7 +77,7 @@ int main(int argc, char **argv)
                }
            }
       }
-    lif_close_phy_device(input_device);
+    if (lif_close_phy_device(input_device)) lif_fatal();
     if(argc==3)
       {
         fclose(output_file);
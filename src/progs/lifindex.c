@@ -0,0 +1,694 @@
+/* lifindex.c -- build a catalog index of many LIF image files */
+/* 2026, placed under the GPL */
+
+/* The index is a text file with one line for every image file followed
+   by one line for every file of the image. Fields are separated by tabs:
+
+   #lifindex 1
+   V path mtime size label date files      LIF image file
+   F name type typecode length start blocks date implementation hash
+   N path mtime size                        not a LIF image file
+
+   The lines of an image whose modification time and size did not change
+   are copied from the previous index, all other images are indexed by a
+   pool of worker threads, one image per task. A worker keeps several
+   reads of a file in flight with the lif_aio functions (io_uring on
+   Linux) and hashes the blocks in order as they arrive. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <pthread.h>
+#include "config.h"
+#include "lif_block.h"
+#include "lif_error.h"
+#include "lif_dir_utils.h"
+#include "lif_hash.h"
+#include "lif_const.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+   do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+#define INDEX_MAGIC "#lifindex 1"
+
+/* maximum number of worker threads, each worker has one image open */
+#define MAX_THREADS LIF_MAX_DEVICES
+
+/* pending reads of a worker and the blocks of one read, the buffer of a
+   worker is IO_BLOCKS blocks */
+#define AIO_DEPTH 4
+#define AIO_BLOCKS (IO_BLOCKS/AIO_DEPTH)
+
+/* growing text buffer for the index lines of an image */
+struct text {
+   char *buf;
+   size_t len;
+   size_t size;
+};
+
+/* an image file of the index */
+struct image {
+   char *path;
+   long long mtime;         /* modification time of the image file */
+   long long size;          /* size of the image file in bytes */
+   struct text lines;       /* index lines of the image */
+   int status;              /* 0: indexed or unchanged, -1: error */
+};
+
+/* work queue of the worker threads */
+static struct image **queue;
+static int queue_len;
+static int queue_next;
+static pthread_mutex_t queue_lock= PTHREAD_MUTEX_INITIALIZER;
+
+static int verbose_flag;
+
+void usage(void)
+  {
+    fprintf(stderr,"Usage: lifindex [-j threads] [-v] index-file directory|image ...\n");
+    fprintf(stderr,"       lifindex -q index-file name ...\n");
+    fprintf(stderr,"\n");
+    fprintf(stderr,"      -j number of worker threads, default is the number\n");
+    fprintf(stderr,"         of processors, at most %d\n",MAX_THREADS);
+    fprintf(stderr,"      -v report every indexed image on standard error\n");
+    fprintf(stderr,"      -q find files by name, name may be a pattern with * and ?\n");
+    exit(1);
+  }
+
+void *xmalloc(size_t size)
+  {
+    void *p;
+
+    p=malloc(size);
+    if(p == NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    return(p);
+  }
+
+char *xstrdup(const char *s)
+  {
+    char *p;
+
+    p=xmalloc(strlen(s)+1);
+    strcpy(p,s);
+    return(p);
+  }
+
+void text_append(struct text *t, const char *s, size_t n)
+  {
+    char *p;
+
+    if(t->len+n+1 > t->size)
+      {
+        t->size= t->size ? 2*t->size : 256;
+        while(t->len+n+1 > t->size) t->size*=2;
+        p=realloc(t->buf,t->size);
+        if(p == NULL)
+          {
+            fprintf(stderr,"Out of memory\n");
+            exit(1);
+          }
+        t->buf=p;
+      }
+    memcpy(t->buf+t->len,s,n);
+    t->len+=n;
+    t->buf[t->len]='\0';
+  }
+
+void text_printf(struct text *t, const char *fmt, ...)
+  {
+    char line[256];
+    va_list args;
+    int n;
+
+    va_start(args,fmt);
+    n=vsnprintf(line,sizeof(line),fmt,args);
+    va_end(args);
+    if(n < 0 || n >= (int) sizeof(line)) n=sizeof(line)-1;
+    text_append(t,line,n);
+  }
+
+/* append characters of a name or label, characters which would break
+   the line format are replaced by ? */
+void text_name(struct text *t, unsigned char *name, int len)
+  {
+    char c;
+    int i;
+
+    while(len > 0 && name[len-1] == ' ') len--;
+    for(i=0; i<len; i++)
+      {
+        c= (name[i] < 0x20 || name[i] == 0x7F) ? '?' : (char) name[i];
+        text_append(t,&c,1);
+      }
+  }
+
+/* append a time stamp, - if it is not valid */
+void text_date(struct text *t, unsigned char *date)
+  {
+    if(date[1] == 0)
+      {
+        text_append(t,"-",1);
+        return;
+      }
+    text_printf(t,"%02d/%02d/%02d %02d:%02d:%02d",bcd_to_dec(date[2]),
+                bcd_to_dec(date[1]),bcd_to_dec(date[0]),bcd_to_dec(date[3]),
+                bcd_to_dec(date[4]),bcd_to_dec(date[5]));
+  }
+
+/* a read of AIO_BLOCKS blocks of a file */
+struct chunk {
+   unsigned char *data;
+   int count;               /* blocks */
+   int state;               /* 0: pending, 1: read, -1: failed */
+};
+
+/* hash the blocks of a file, returns -1 if they cannot be read. Chunk
+   k of the file is read into buffer k % AIO_DEPTH, up to AIO_DEPTH
+   chunks are pending while the oldest one is hashed */
+int hash_file(int device, struct lif_aio *aio, lif_blk_t start,
+              lif_blk_t blocks, unsigned char *data, char *hex)
+  {
+    struct lif_hash ctx;
+    unsigned char digest[LIF_HASH_SIZE];
+    struct chunk chunks[AIO_DEPTH];
+    struct chunk *c;
+    lif_blk_t num_chunks, queued, hashed;
+    void *user;
+    int i, status, iret;
+    char errmsg[256];
+
+    for(i=0; i<AIO_DEPTH; i++)
+       chunks[i].data=data+(size_t) i*AIO_BLOCKS*SECTOR_SIZE;
+    num_chunks=(blocks+AIO_BLOCKS-1)/AIO_BLOCKS;
+    queued=0;
+    hashed=0;
+    iret=0;
+    lif_hash_init(&ctx);
+    while(hashed < num_chunks)
+      {
+        /* a buffer is free when its previous chunk was hashed */
+        while(queued < num_chunks && queued < hashed+AIO_DEPTH)
+          {
+            c= &chunks[queued % AIO_DEPTH];
+            c->count=AIO_BLOCKS;
+            if(blocks-queued*AIO_BLOCKS < AIO_BLOCKS)
+               c->count=(int) (blocks-queued*AIO_BLOCKS);
+            c->state=0;
+            if(lif_aio_read(aio,device,start+queued*AIO_BLOCKS,c->count,
+                            c->data,c)) break;
+            queued++;
+          }
+        c= &chunks[hashed % AIO_DEPTH];
+        if(queued == hashed || c->state < 0)
+          {
+            iret= -1;
+            break;
+          }
+        if(c->state == 0)
+          {
+            status=lif_aio_wait(aio,&user);
+            if(user == NULL)
+              {
+                iret= -1;
+                break;
+              }
+            ((struct chunk *) user)->state=status;
+            continue;
+          }
+        lif_hash_update(&ctx,c->data,(size_t) c->count*SECTOR_SIZE);
+        hashed++;
+      }
+
+    /* the buffers of reads which are still pending are not reused before
+       the reads are completed, the message of the first error is kept */
+    if(iret) snprintf(errmsg,sizeof(errmsg),"%s",lif_errmsg());
+    while(lif_aio_wait(aio,&user) != 0 && user != NULL)
+       ;
+    if(iret)
+      {
+        lif_set_error("%s",errmsg);
+        return(-1);
+      }
+    lif_hash_final(&ctx,digest);
+    lif_hash_hex(digest,hex);
+    return(0);
+  }
+
+/* index one image file. Files which are not LIF images get an N line */
+void index_image(struct image *img, struct lif_aio *aio, unsigned char *data)
+  {
+    int device, slot, i;
+    int lif_flag; /* image has a LIF volume header */
+    struct lif_dir *dir;
+    unsigned char *entry;
+    char (*hashes)[LIF_HASH_HEX];
+    char file_type[10];
+
+    img->lines.len=0;
+    device= -1;
+    lif_flag=0;
+    if(img->size >= SECTOR_SIZE)
+      {
+        if((device=lif_open(img->path,O_RDONLY | O_BINARY,0,0))==-1)
+          {
+            fprintf(stderr,"Error opening %s: %s\n",img->path,lif_errmsg());
+            img->status= -1;
+            return;
+          }
+        if(lif_read_block(device,0,data))
+          {
+            fprintf(stderr,"%s: %s\n",img->path,lif_errmsg());
+            lif_close(device);
+            img->status= -1;
+            return;
+          }
+        lif_flag= get_lif_int(data,2) == 0x8000;
+      }
+    if(! lif_flag)
+      {
+        if(device != -1) lif_close(device);
+        text_append(&img->lines,"N\t",2);
+        text_append(&img->lines,img->path,strlen(img->path));
+        text_printf(&img->lines,"\t%lld\t%lld\n",img->mtime,img->size);
+        return;
+      }
+
+    if((dir=lif_dir_open(device))==NULL)
+      {
+        fprintf(stderr,"%s: %s\n",img->path,lif_errmsg());
+        lif_close(device);
+        img->status= -1;
+        return;
+      }
+
+    /* hash the files in the order of their start blocks, so the image
+       is read front to back */
+    hashes=xmalloc((dir->used+1)*sizeof(*hashes));
+    for(i=0; i<dir->files; i++)
+      {
+        slot=dir->by_start[i].slot;
+        if(hash_file(device,aio,dir->by_start[i].start,
+                     dir->by_start[i].blocks,data,hashes[slot]))
+          {
+            fprintf(stderr,"%s: %.*s: %s\n",img->path,NAME_LEN,
+                    (char *) lif_dir_entry(dir,slot),lif_errmsg());
+            strcpy(hashes[slot],"-");
+          }
+      }
+
+    /* the volume followed by its files in directory order */
+    text_append(&img->lines,"V\t",2);
+    text_append(&img->lines,img->path,strlen(img->path));
+    text_printf(&img->lines,"\t%lld\t%lld\t",img->mtime,img->size);
+    text_name(&img->lines,dir->header+2,6);
+    text_append(&img->lines,"\t",1);
+    text_date(&img->lines,dir->header+36);
+    text_printf(&img->lines,"\t%d\n",dir->files);
+    for(slot=0; slot<dir->used; slot++)
+      {
+        entry=lif_dir_entry(dir,slot);
+        if(get_lif_int(entry+10,2)==0) continue; /* Skip deleted files */
+        text_append(&img->lines,"F\t",2);
+        text_name(&img->lines,entry,NAME_LEN);
+        i=file_length(entry,file_type);
+        text_printf(&img->lines,"\t%s\t%u\t%d\t%u\t%u\t",file_type,
+                    get_lif_int(entry+10,2),i,get_lif_int(entry+12,4),
+                    get_lif_int(entry+16,4));
+        text_date(&img->lines,entry+20);
+        text_printf(&img->lines,"\t%02X%02X%02X%02X%02X%02X\t%s\n",
+                    entry[26],entry[27],entry[28],entry[29],entry[30],
+                    entry[31],hashes[slot]);
+      }
+    free(hashes);
+    lif_dir_close(dir);
+    if(lif_close(device))
+      {
+        fprintf(stderr,"%s: %s\n",img->path,lif_errmsg());
+        img->status= -1;
+        return;
+      }
+    if(verbose_flag) fprintf(stderr,"indexed %s\n",img->path);
+  }
+
+/* worker thread, takes images from the queue until it is empty */
+void *worker(void *arg)
+  {
+    struct lif_aio *aio;
+    unsigned char *data;
+    int i;
+
+    (void) arg;
+    data=xmalloc(IO_BLOCKS*SECTOR_SIZE);
+    if((aio=lif_aio_init(AIO_DEPTH)) == NULL) lif_fatal();
+    for(;;)
+      {
+        pthread_mutex_lock(&queue_lock);
+        i=queue_next++;
+        pthread_mutex_unlock(&queue_lock);
+        if(i >= queue_len) break;
+        index_image(queue[i],aio,data);
+      }
+    lif_aio_exit(aio);
+    free(data);
+    return(NULL);
+  }
+
+/* list of images */
+struct image_list {
+   struct image *images;
+   int num;
+   int size;
+};
+
+struct image *add_image(struct image_list *list, const char *path,
+                        long long mtime, long long size)
+  {
+    struct image *img;
+
+    if(list->num == list->size)
+      {
+        list->size= list->size ? 2*list->size : 256;
+        list->images=realloc(list->images,list->size*sizeof(struct image));
+        if(list->images == NULL)
+          {
+            fprintf(stderr,"Out of memory\n");
+            exit(1);
+          }
+      }
+    img= &list->images[list->num++];
+    img->path=xstrdup(path);
+    img->mtime=mtime;
+    img->size=size;
+    img->lines.buf=NULL;
+    img->lines.len=0;
+    img->lines.size=0;
+    img->status=0;
+    return(img);
+  }
+
+static int compare_path(const void *a, const void *b)
+  {
+    return(strcmp(((const struct image *) a)->path,
+                  ((const struct image *) b)->path));
+  }
+
+/* collect the regular files of a directory tree. Symbolic links to
+   directories are not followed */
+void walk(struct image_list *list, const char *path, int *errors)
+  {
+    struct stat st;
+    DIR *d;
+    struct dirent *de;
+    char *sub;
+
+    if(stat(path,&st))
+      {
+        fprintf(stderr,"%s: %s\n",path,strerror(errno));
+        (*errors)++;
+        return;
+      }
+    if(S_ISREG(st.st_mode))
+      {
+        if(strpbrk(path,"\t\n") != NULL)
+          {
+            fprintf(stderr,"%s: file name not supported\n",path);
+            (*errors)++;
+            return;
+          }
+        add_image(list,path,(long long) st.st_mtime,(long long) st.st_size);
+        return;
+      }
+    if(! S_ISDIR(st.st_mode)) return;
+    if((d=opendir(path)) == NULL)
+      {
+        fprintf(stderr,"%s: %s\n",path,strerror(errno));
+        (*errors)++;
+        return;
+      }
+    while((de=readdir(d)) != NULL)
+      {
+        if(strcmp(de->d_name,".") == 0 || strcmp(de->d_name,"..") == 0)
+           continue;
+        sub=xmalloc(strlen(path)+strlen(de->d_name)+2);
+        strcpy(sub,path);
+        if(sub[0] == '\0' || sub[strlen(sub)-1] != '/') strcat(sub,"/");
+        strcat(sub,de->d_name);
+        if(lstat(sub,&st) == 0 && S_ISLNK(st.st_mode) &&
+           stat(sub,&st) == 0 && S_ISDIR(st.st_mode))
+          {
+            free(sub);
+            continue;
+          }
+        walk(list,sub,errors);
+        free(sub);
+      }
+    closedir(d);
+  }
+
+/* read an index file. The lines of every image are kept together, the
+   images are sorted by path. A missing index file is an empty index */
+int read_index(char *filename, struct image_list *list)
+  {
+    FILE *fp;
+    char *line, *path, *p;
+    size_t line_size;
+    ssize_t len;
+    long long mtime, size;
+    struct image *img;
+    int line_no;
+
+    list->images=NULL;
+    list->num=0;
+    list->size=0;
+    if((fp=fopen(filename,"r")) == NULL)
+      {
+        if(errno == ENOENT) return(0);
+        fprintf(stderr,"Error opening %s: %s\n",filename,strerror(errno));
+        return(-1);
+      }
+    line=NULL;
+    line_size=0;
+    img=NULL;
+    line_no=0;
+    while((len=getline(&line,&line_size,fp)) != -1)
+      {
+        line_no++;
+        if(line_no == 1)
+          {
+            if(strncmp(line,INDEX_MAGIC,strlen(INDEX_MAGIC)) == 0) continue;
+            fprintf(stderr,"%s is not a lifindex file\n",filename);
+            fclose(fp);
+            free(line);
+            return(-1);
+          }
+        if((line[0] == 'V' || line[0] == 'N') && line[1] == '\t')
+          {
+            path=line+2;
+            p=strchr(path,'\t');
+            if(p == NULL || sscanf(p,"\t%lld\t%lld",&mtime,&size) != 2)
+               goto invalid;
+            *p='\0';
+            img=add_image(list,path,mtime,size);
+            *p='\t';
+          }
+        else if(line[0] != 'F' || img == NULL) goto invalid;
+        text_append(&img->lines,line,(size_t) len);
+      }
+    fclose(fp);
+    free(line);
+    qsort(list->images,list->num,sizeof(struct image),compare_path);
+    return(0);
+
+invalid:
+    fprintf(stderr,"%s: invalid line %d\n",filename,line_no);
+    fclose(fp);
+    free(line);
+    return(-1);
+  }
+
+/* find files by name in an index */
+int query(char *filename, char **names, int num_names)
+  {
+    struct image_list list;
+    struct image *img;
+    char *line, *end, *name, *tab;
+    char padded[NAME_LEN+1];
+    int i, j, found;
+
+    for(j=0; j<num_names; j++)
+      {
+        if(strpbrk(names[j],"*?") == NULL && check_filename(names[j])==0)
+          {
+            fprintf(stderr,"Illegal file name %s\n",names[j]);
+            exit(1);
+          }
+      }
+    if(read_index(filename,&list)) exit(1);
+    found=0;
+    for(i=0; i<list.num; i++)
+      {
+        img= &list.images[i];
+        for(line=img->lines.buf; *line; line=end+1)
+          {
+            end=strchr(line,'\n');
+            if(end == NULL) break;
+            if(line[0] == 'F')
+              {
+                name=line+2;
+                tab=strchr(name,'\t');
+                if(tab == NULL || tab > end || tab-name > NAME_LEN) continue;
+                memset(padded,' ',NAME_LEN);
+                memcpy(padded,name,tab-name);
+                padded[NAME_LEN]='\0';
+                for(j=0; j<num_names; j++)
+                  {
+                    if(! match_name(names[j],padded)) continue;
+                    printf("%s\t%.*s\n",img->path,(int) (end-name),name);
+                    found++;
+                    break;
+                  }
+              }
+          }
+      }
+    exit(found ? 0 : 2);
+  }
+
+int main(int argc, char **argv)
+  {
+    int option; /* Command line option character */
+    int query_flag;
+    int num_threads;
+    pthread_t threads[MAX_THREADS];
+    struct image_list old_list, list;
+    struct image *img, *old;
+    char *index_file, *temp_file;
+    FILE *fp;
+    int errors, unchanged, i;
+
+    /* Process command line options */
+    optind=1;
+    query_flag=0;
+    verbose_flag=0;
+    num_threads=0;
+    while ((option=getopt(argc,argv,"j:qv?"))!=-1)
+      {
+        switch(option)
+          {
+            case 'j' : if (sscanf(optarg,"%d",&num_threads)!= 1 ||
+                           num_threads <= 0 || num_threads > MAX_THREADS)
+                          usage();
+                       break;
+            case 'q' : query_flag=1;
+                       break;
+            case 'v' : verbose_flag=1;
+                       break;
+            case '?' : usage();
+                       break;
+          }
+      }
+    if(optind > argc-2) usage();
+    index_file=argv[optind];
+    if(query_flag) query(index_file,argv+optind+1,argc-optind-1);
+
+    if(read_index(index_file,&old_list)) exit(1);
+
+    /* collect the image files */
+    list.images=NULL;
+    list.num=0;
+    list.size=0;
+    errors=0;
+    for(i=optind+1; i<argc; i++) walk(&list,argv[i],&errors);
+    qsort(list.images,list.num,sizeof(struct image),compare_path);
+
+    /* keep the entries of unchanged images, queue the others. Equal paths
+       given twice are indexed once */
+    queue=xmalloc((list.num+1)*sizeof(struct image *));
+    queue_len=0;
+    unchanged=0;
+    for(i=0; i<list.num; i++)
+      {
+        img= &list.images[i];
+        if(i > 0 && strcmp(img->path,list.images[i-1].path) == 0)
+          {
+            img->status= 1;
+            continue;
+          }
+        old=bsearch(img,old_list.images,old_list.num,sizeof(struct image),
+                    compare_path);
+        if(old != NULL && old->mtime == img->mtime && old->size == img->size)
+          {
+            img->lines=old->lines;
+            old->lines.buf=NULL;
+            unchanged++;
+            continue;
+          }
+        queue[queue_len++]=img;
+      }
+
+    /* index the queued images on a pool of worker threads */
+    if(num_threads == 0)
+      {
+#ifdef _SC_NPROCESSORS_ONLN
+        num_threads=(int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if(num_threads <= 0) num_threads=1;
+        if(num_threads > MAX_THREADS) num_threads=MAX_THREADS;
+      }
+    if(num_threads > queue_len) num_threads=queue_len;
+    debug_print("%d images to index, %d threads\n",queue_len,num_threads);
+    queue_next=0;
+    for(i=0; i<num_threads; i++)
+      {
+        if(pthread_create(&threads[i],NULL,worker,NULL))
+          {
+            fprintf(stderr,"Cannot create thread\n");
+            exit(1);
+          }
+      }
+    for(i=0; i<num_threads; i++) pthread_join(threads[i],NULL);
+
+    /* write the new index to a temporary file and replace the old index */
+    temp_file=xmalloc(strlen(index_file)+5);
+    strcpy(temp_file,index_file);
+    strcat(temp_file,".tmp");
+    if((fp=fopen(temp_file,"w")) == NULL)
+      {
+        fprintf(stderr,"Error opening %s: %s\n",temp_file,strerror(errno));
+        exit(1);
+      }
+    fprintf(fp,"%s\n",INDEX_MAGIC);
+    for(i=0; i<list.num; i++)
+      {
+        img= &list.images[i];
+        if(img->status == -1) errors++;
+        if(img->status != 0 || img->lines.len == 0) continue;
+        fwrite(img->lines.buf,1,img->lines.len,fp);
+      }
+    if(fflush(fp) || ferror(fp) || fclose(fp))
+      {
+        fprintf(stderr,"Error writing %s: %s\n",temp_file,strerror(errno));
+        remove(temp_file);
+        exit(1);
+      }
+    if(rename(temp_file,index_file))
+      {
+        fprintf(stderr,"Error renaming %s: %s\n",temp_file,strerror(errno));
+        remove(temp_file);
+        exit(1);
+      }
+    if(verbose_flag)
+       fprintf(stderr,"%d files, %d indexed, %d unchanged, %d errors\n",
+               list.num,queue_len,unchanged,errors);
+    exit(errors ? 1 : 0);
+  }
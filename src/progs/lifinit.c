@@ -9,6 +9,7 @@
 #include <sys/stat.h>
 #include "config.h"
 #include"lif_block.h"
+#include "lif_error.h"
 #include"lif_dir_utils.h"
 #include "lif_create_entry.h"
 #include "lif_const.h"
@@ -40,13 +41,16 @@ int main(int argc, char **argv)
     char *medium= (char *) NULL;
     int dirsize;    /* number of directory entries */
     int dirsize_blocks; /* number of blocks for directory */
-    int totalblocks; /* total number of disk blocks */
+    lif_blk_t totalblocks; /* total number of disk blocks */
+    lif_blk_t block; /* current block of the data area */
     int tracks, heads, sectors; /* medium geometry */
     int i, temp;
+    int count; /* number of blocks in one transfer */
     
     /* LIF disk values */
     unsigned char sector_data[SECTOR_SIZE]; /* sector */
     unsigned char tmp_data[ENTRY_SIZE]; /* create date and time */
+    unsigned char *block_data; /* buffer for multi block writes */
 
     /* Process command line options */
     optind=1;
@@ -89,49 +93,7 @@ int main(int argc, char **argv)
     dirsize_blocks= temp/SECTOR_SIZE + (int) ((temp % SECTOR_SIZE) !=0);
 
     /* Tracks, heads, sectors */
-    totalblocks=0;
-    if(strcmp(medium,"cass")==0) {
-        tracks=2;
-        heads=1;
-        sectors=256;
-        totalblocks= 512;
-    }
-    if(strcmp(medium,"disk")==0) {
-        tracks=77;
-        heads=2;
-        sectors=16;
-        totalblocks=2464; 
-    }
-    if(strcmp(medium,"hdrive1")==0) {
-        tracks=80;
-        heads=2;
-        sectors=16;
-        totalblocks=2560; 
-    }
-    if(strcmp(medium,"hdrive2")==0) {
-        tracks=125;
-        heads=1;
-        sectors=64;
-        totalblocks=8000; 
-    }
-    if(strcmp(medium,"hdrive4")==0) {
-        tracks=125;
-        heads=2;
-        sectors=64;
-        totalblocks=16000; 
-    }
-    if(strcmp(medium,"hdrive8")==0) {
-        tracks=125;
-        heads=4;
-        sectors=64;
-        totalblocks=32000; 
-    }
-    if(strcmp(medium,"hdrive16")==0) {
-        tracks=125;
-        heads=8;
-        sectors=64;
-        totalblocks=64000; 
-    }
+    totalblocks=get_medium(medium,&tracks,&heads,&sectors);
     if(totalblocks==0) usage();
 
     /* directory size too large? */
@@ -144,12 +106,12 @@ int main(int argc, char **argv)
     debug_print("Tracks %d\n",tracks);
     debug_print("Heads %d\n",heads);
     debug_print("Sectors %d\n",sectors);
-    debug_print("Total blocks %d\n",totalblocks);
+    debug_print("Total blocks %lld\n",totalblocks);
 
     /* Open lif device */
     if((lif_device=lif_open(argv[optind],O_CREAT | O_BINARY | O_TRUNC| O_WRONLY,S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH,physical_flag))==-1)
       {
-        fprintf(stderr,"Error opening %s\n",argv[optind]);
+        fprintf(stderr,"Error opening %s: %s\n",argv[optind],lif_errmsg());
         exit(1);
       }
  
@@ -181,28 +143,51 @@ int main(int argc, char **argv)
     for(i=36;i<40;i++) sector_data[i]= tmp_data[i-16];
 
     /* Now write block 0  */
-    lif_write_block(lif_device,0,sector_data);
+    if (lif_write_block(lif_device,0,sector_data)) lif_fatal();
     /* Now write block 1 , all zeros */
     for(i=0;i<SECTOR_SIZE;i++) sector_data[i]=0x0;
-    lif_write_block(lif_device,1,sector_data);
+    if (lif_write_block(lif_device,1,sector_data)) lif_fatal();
     /* Now write empty directory, all 0xFF */
-    for(i=0;i<SECTOR_SIZE;i++) sector_data[i]=0xFF;
-    for(i=2;i<dirsize_blocks+2;i++)
-       lif_write_block(lif_device,i,sector_data);
-    /* now write one sector of disk data, all 0xFF */
-    lif_write_block(lif_device,dirsize_blocks+3,sector_data);
+    block_data=malloc(IO_BLOCKS*SECTOR_SIZE);
+    if(block_data == (unsigned char *) NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    memset(block_data,0xFF,IO_BLOCKS*SECTOR_SIZE);
+    for(i=2;i<dirsize_blocks+2;i+=count)
+       {
+       count=dirsize_blocks+2-i;
+       if(count > IO_BLOCKS) count=IO_BLOCKS;
+       if (lif_write_blocks(lif_device,i,count,block_data)) lif_fatal();
+       }
     /* zero data area if requested */
-    if (zero_data)
+    if (zero_data && ! physical_flag)
        {
-       for(i=0;i<SECTOR_SIZE;i++) sector_data[i]=0x0;
-       i=dirsize_blocks+2; /* first data block */
-       while(i< totalblocks)
+       /* extend the image file, the data area reads as zero and is
+          allocated only when it is written to */
+       if (lif_resize(lif_device,totalblocks)) lif_fatal();
+       }
+    else if (zero_data)
+       {
+       memset(block_data,0x0,IO_BLOCKS*SECTOR_SIZE);
+       block=dirsize_blocks+2; /* first data block */
+       while(block< totalblocks)
           {
-          lif_write_block(lif_device,i,sector_data);
-          i+=1;
+          count=IO_BLOCKS;
+          if(totalblocks-block < IO_BLOCKS) count=(int) (totalblocks-block);
+          if (lif_write_blocks(lif_device,block,count,block_data)) lif_fatal();
+          block+=count;
           }
        }
+    else
+       {
+       /* now write one sector of disk data, all 0xFF */
+       for(i=0;i<SECTOR_SIZE;i++) sector_data[i]=0xFF;
+       if (lif_write_block(lif_device,dirsize_blocks+3,sector_data)) lif_fatal();
+       }
+    free(block_data);
     /* tidy up and quit */
-    lif_close(lif_device);
+    if (lif_close(lif_device)) lif_fatal();
     exit(0);      
   }
@@ -8,6 +8,7 @@
 #include <ctype.h>
 #include "config.h"
 #include "lif_block.h"
+#include "lif_error.h"
 #include "lif_dir_utils.h"
 #include "lif_const.h"
 
@@ -66,7 +67,7 @@ int main(int argc, char **argv)
     /* Open lif device */
     if((lif_device=lif_open(argv[optind],O_RDWR | O_BINARY,0,physical_flag))==-1)
       {
-        fprintf(stderr,"Error opening %s\n",argv[optind]);
+        fprintf(stderr,"Error opening %s: %s\n",argv[optind],lif_errmsg());
         exit(1);
       }
  
@@ -84,7 +85,7 @@ int main(int argc, char **argv)
 
 
     /* Now read block 0 to find where the directory is */
-    lif_read_block(lif_device,0,dir_data);
+    if (lif_read_block(lif_device,0,dir_data)) lif_fatal();
 
     /* Make sure it's a LIF disk */
     if(get_lif_int(dir_data+0,2)!=0x8000)
@@ -108,7 +109,7 @@ int main(int argc, char **argv)
      /* Clear Label */
      if (clear_flag) {
         for(i=2; i<8; i++) *(dir_data+i)=' ';
-        lif_write_block(lif_device,0,dir_data);
+        if (lif_write_block(lif_device,0,dir_data)) lif_fatal();
      }
 
      /* new label specified; apply it */
@@ -123,9 +124,9 @@ int main(int argc, char **argv)
             putchar(*(dir_data+i));
           }
         printf("\n");
-        lif_write_block(lif_device,0,dir_data);
+        if (lif_write_block(lif_device,0,dir_data)) lif_fatal();
      }
     /* tidy up and quit */
-    lif_close(lif_device);
+    if (lif_close(lif_device)) lif_fatal();
     exit(0);      
   }
@@ -9,6 +9,7 @@
 #include <limits.h>
 #include "config.h"
 #include "modfile.h"
+#include "lif_error.h"
 
 #define DEBUG 0
 #define debug_print(fmt, ...) \
@@ -69,10 +70,17 @@ int main(int argc, char **argv)
     if (NULL==strrchr(MODFileName,'.') ) {
         strcat(MODFileName,".mod");
     }
+    /* in verbose mode the error is part of the listing */
     if (output_mod_info(stdout,MODFileName,verbose,decodefat,NULL))
-      errors++;
-    if (extract && extract_roms(MODFileName,lstfornsim))
-      errors++;
+      {
+        if (!verbose) fprintf(stderr,"%s\n",lif_errmsg());
+        errors++;
+      }
+    if (extract && extract_roms(MODFileName,lstfornsim,stderr))
+      {
+        fprintf(stderr,"%s\n",lif_errmsg());
+        errors++;
+      }
     if (errors)
        fprintf(stderr,"*** %d ERROR(S)\n",errors);
     exit(0);      
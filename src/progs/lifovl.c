@@ -0,0 +1,142 @@
+/* lifovl.c -- create, show and merge overlay image files */
+/* 2026, placed under the GPL */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "lif_block.h"
+#include "lif_ovl.h"
+#include "lif_error.h"
+#include "lif_const.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+   do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+
+void usage(void)
+  {
+    fprintf(stderr,
+    "Usage: lifovl -c lif-image-filename overlay-filename\n");
+    fprintf(stderr,
+    "       lifovl -m overlay-filename lif-image-filename\n");
+    fprintf(stderr,
+    "       lifovl overlay-filename\n");
+    fprintf(stderr,"\n");
+    fprintf(stderr,
+    "      -c create an overlay file for a read-only base image file\n");
+    fprintf(stderr,
+    "      -m merge an overlay file into a new flat image file\n");
+    fprintf(stderr,
+    "      without options the base image and the number of modified\n");
+    fprintf(stderr,
+    "      blocks of an overlay file are displayed\n");
+    exit(1);
+  }
+
+/* write the image represented by an overlay to a flat image file */
+void merge_overlay(char *overlay_name, char *image_name)
+  {
+    int overlay, image;
+    int count, modified;
+    lif_blk_t block, size;
+    char *base;
+    unsigned char *data;
+    struct stat st;
+
+    /* the target must be a new file. Writing into the base image would
+       change the image of every other overlay which shares it */
+    if(stat(image_name,&st) == 0)
+      {
+        fprintf(stderr,"Output LIF image file already exists\n");
+        exit(1);
+      }
+
+    /* lif_open locks the overlay file and its base image */
+    if((overlay=lif_open(overlay_name,O_RDONLY | O_BINARY,0,0))==-1)
+      {
+        fprintf(stderr,"Error opening %s: %s\n",overlay_name,lif_errmsg());
+        exit(1);
+      }
+    if(lif_ovl_device_info(overlay,&base,&size,&modified)) lif_fatal();
+
+    if((image=lif_open(image_name,O_CREAT | O_BINARY | O_TRUNC | O_WRONLY,S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH,0))==-1)
+      {
+        fprintf(stderr,"Error opening %s: %s\n",image_name,lif_errmsg());
+        exit(1);
+      }
+    data=malloc(IO_BLOCKS*SECTOR_SIZE);
+    if(data == (unsigned char *) NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    for(block=0; block< size; block+=count)
+      {
+        count=IO_BLOCKS;
+        if(size-block < IO_BLOCKS) count=(int) (size-block);
+        if (lif_read_blocks(overlay,block,count,data)) lif_fatal();
+        if (lif_write_blocks(image,block,count,data)) lif_fatal();
+      }
+    free(data);
+    if (lif_resize(image,size)) lif_fatal();
+    if (lif_close(image)) lif_fatal();
+    if (lif_close(overlay)) lif_fatal();
+  }
+
+int main(int argc, char **argv)
+  {
+    int option; /* Command line option character */
+    int create_flag; /* create an overlay */
+    int merge_flag; /* merge an overlay */
+    int overlay; /* Descriptor of overlay file */
+    int modified;
+    lif_blk_t size;
+    char *base;
+
+    /* Process command line options */
+    create_flag=0;
+    merge_flag=0;
+    optind=1;
+    while ((option=getopt(argc,argv,"cm?"))!=-1)
+      {
+        switch(option)
+          {
+            case 'c' : create_flag=1;
+                       break;
+            case 'm' : merge_flag=1;
+                       break;
+            case '?' : usage();
+          }
+      }
+    if(create_flag && merge_flag) usage();
+
+    if(create_flag)
+      {
+        if(optind != argc-2) usage();
+        if (lif_create_ovl_file(argv[optind+1],argv[optind])) lif_fatal();
+        exit(0);
+      }
+    if(merge_flag)
+      {
+        if(optind != argc-2) usage();
+        merge_overlay(argv[optind],argv[optind+1]);
+        exit(0);
+      }
+
+    /* show overlay information */
+    if(optind != argc-1) usage();
+    if((overlay=lif_open(argv[optind],O_RDONLY | O_BINARY,0,0))==-1)
+      {
+        fprintf(stderr,"Error opening %s: %s\n",argv[optind],lif_errmsg());
+        exit(1);
+      }
+    if (lif_ovl_device_info(overlay,&base,&size,&modified)) lif_fatal();
+    printf("Base image: %s\n",base);
+    printf("Blocks: %lld, modified: %d\n",size,modified);
+    if (lif_close(overlay)) lif_fatal();
+    exit(0);
+  }
@@ -9,6 +9,7 @@
 #include <ctype.h>
 #include "config.h"
 #include"lif_block.h"
+#include "lif_error.h"
 #include "lif_create_entry.h"
 #include"lif_dir_utils.h"
 #include "lif_const.h"
@@ -21,55 +22,136 @@
 
 void usage(void)
   {
-    fprintf(stderr, "Usage:lifpack lif-image-filename \n");
+    fprintf(stderr, "Usage:lifpack [-c] lif-image-filename \n");
     fprintf(stderr,"\n");
+    fprintf(stderr,"      -c compact in place with a bounded buffer, the files keep\n");
+    fprintf(stderr,"         their order on the medium\n");
     exit(1);
   }
 
+/* copy blocks to another place of the medium and let the directory entry
+   point there. The blocks are written and flushed before the directory
+   entry, so the entry always points to a complete copy of the file */
+void move_file(int lif_device, struct lif_dir *dir, struct lif_dir_file *file,
+               lif_blk_t from, lif_blk_t to, unsigned char *data)
+  {
+    lif_blk_t block;
+    int count;
+    unsigned char entry[ENTRY_SIZE];
+
+    debug_print("blocks %lld..%lld moved to %lld\n",from,from+file->blocks-1,to);
+    for(block=0; block<file->blocks; block+=count) {
+       count=IO_BLOCKS;
+       if(file->blocks-block < IO_BLOCKS) count=(int) (file->blocks-block);
+       if (lif_read_blocks(lif_device,from+block,count,data)) lif_fatal();
+       if (lif_write_blocks(lif_device,to+block,count,data)) lif_fatal();
+    }
+    if (lif_flush(lif_device)) lif_fatal();
+    memcpy(entry,lif_dir_entry(dir,file->slot),ENTRY_SIZE);
+    put_lif_int(entry+12,4,(unsigned int) to);
+    if (lif_dir_write(dir,file->slot,entry)) lif_fatal();
+    if (lif_flush(lif_device)) lif_fatal();
+  }
+
+/* Slide all files down to the lowest free blocks. The files are visited
+   in the order of their start blocks, so each file only moves to lower
+   blocks and is copied front to back with one buffer of IO_BLOCKS
+   blocks. The directory entry of a file is written after its blocks,
+   files which are already in place are neither read nor written.
+   A file which moves by less than its length would overwrite its own
+   blocks while the directory still points to them. It is first moved
+   to the free space behind the last file and from there to its new
+   place. If the medium has no room for that, the file stays where it is,
+   so an interruption always leaves a consistent medium.
+   Returns the first block after the last file */
+lif_blk_t compact(int lif_device, struct lif_dir *dir, lif_blk_t medium_size)
+  {
+    struct lif_dir_file *files; /* files sorted by start block */
+    int num_files, i, len;
+    char *name;
+    lif_blk_t new_start;
+    lif_blk_t spare; /* free space behind the last file */
+    unsigned char *data;
+
+    /* lif_dir_write changes the index, work on a copy */
+    num_files=dir->files;
+    files=malloc((num_files+1)*sizeof(struct lif_dir_file));
+    data=malloc(IO_BLOCKS*SECTOR_SIZE);
+    if(files == NULL || data == (unsigned char *) NULL) {
+       fprintf(stderr,"Out of memory\n");
+       exit(1);
+    }
+    memcpy(files,dir->by_start,num_files*sizeof(struct lif_dir_file));
+
+    new_start=dir->start+dir->length;
+    spare= num_files > 0 ? files[num_files-1].start+files[num_files-1].blocks : new_start;
+    for(i=0;i<num_files;i++) {
+       if(files[i].start == new_start) {
+          debug_print("blocks %lld..%lld in place\n",files[i].start,files[i].start+files[i].blocks-1);
+          new_start+=files[i].blocks;
+          continue;
+       }
+       if(new_start+files[i].blocks > files[i].start) {
+          /* the old and the new place overlap */
+          if(spare+files[i].blocks > medium_size) {
+             name=(char *) lif_dir_entry(dir,files[i].slot);
+             for(len=NAME_LEN; len>0 && name[len-1]==' '; len--) ;
+             fprintf(stderr,"No room to move %.*s safely, the file stays in place\n",
+                     len,name);
+             new_start=files[i].start+files[i].blocks;
+             continue;
+          }
+          move_file(lif_device,dir,&files[i],files[i].start,spare,data);
+          files[i].start=spare;
+       }
+       move_file(lif_device,dir,&files[i],files[i].start,new_start,data);
+       new_start+=files[i].blocks;
+    }
+    free(data);
+    free(files);
+    return(new_start);
+  }
+
 int main(int argc, char **argv)
   {
     /* System variables */
     int option; /* Command line option character */
     int physical_flag; /*  Option to use a physical device */
+    int compact_flag; /* Option to compact in place */
     int lif_device; /* Descriptor of input device */
-    unsigned int i,j;
-    
+    unsigned int i;
+
     /* LIF disk values */
-    unsigned int dir_start; /* first block of the directory */
-    unsigned int dir_length; /* length of directory in blocks */
-    unsigned int reccount; /* record count of new file */
-    unsigned int blockmap[MAXBLOCKS]; /* Block mapping orig/packed file */
-    unsigned int allocmap[MAXBLOCKS]; /* Block mapping orig/packed file */
-    unsigned char * blocks[MAXBLOCKS]; /* File blocks */
+    struct lif_dir *dir; /* directory of the medium */
+    unsigned char *header; /* volume header */
+    unsigned char *dir_blocks; /* new directory */
+    struct filetype {
+       lif_blk_t start_block;    /* first block of file in new medium */
+       unsigned int num_blocks;  /* number of blocks in file */
+       unsigned char *data;      /* file blocks */
+    } *files; /* list of files */
+    unsigned int num_files; /* number of files */
 
 
     /* Directory search values */
-    unsigned int dir_end; /* Set at end of directory */
-    unsigned int dir_entry; /* Directory entry within current block */
-    unsigned int dir_block; /* Current block offset from start of directory */
+    int slot; /* directory slot */
+    unsigned char *entry; /* directory entry */
     unsigned int new_entry; /* entry number of file in directory */
-    unsigned int start_block; /* first block of file */
+    lif_blk_t start_block; /* first block of file */
     unsigned int num_blocks; /* number of blocks in file */
-    unsigned int new_block_count; /* block numer in new file */
-    unsigned int file_type; /* file type word */
-    unsigned char dir_data[SECTOR_SIZE]; /* Current directory block data */
+    lif_blk_t new_block_count; /* block numer in new file */
     unsigned int no_tracks, no_surfaces, no_blocks; /* disk geometry */
-    unsigned int medium_size; /* size of disk medium */
- 
-    /* Initialize block lists */
-    for(i=0;i<MAXBLOCKS;i++) {
-       blockmap[i]= -1;
-       blocks[i]=(unsigned char *) NULL;
-       allocmap[i]=0;
-    }
 
     /* Process command line options */
     optind=1;
     physical_flag=0;
-    while ((option=getopt(argc,argv,"p?"))!=-1)
+    compact_flag=0;
+    while ((option=getopt(argc,argv,"cp?"))!=-1)
       {
         switch(option)
           {
+            case 'c' : compact_flag=1;
+                       break;
             case 'p' : physical_flag=1;
                        break;
             case '?' : usage();
@@ -87,126 +169,119 @@ int main(int argc, char **argv)
     /* Open lif input device */
     if((lif_device=lif_open(argv[optind],O_RDWR | O_BINARY,0,physical_flag))==-1)
       {
-        fprintf(stderr,"Error opening %s\n",argv[optind]);
+        fprintf(stderr,"Error opening %s: %s\n",argv[optind],lif_errmsg());
         exit(1);
       }
 
-    /* Now read block 0 to find where the directory is */
-    reccount=0;
-    blocks[reccount]=malloc(sizeof (unsigned char) * SECTOR_SIZE);
-    blockmap[reccount]=reccount;
-    lif_read_block(lif_device,reccount,blocks[reccount]);
-
-    /* Make sure it's a LIF disk */
-    if(get_lif_int(blocks[reccount],2)!=0x8000)
-      {
-        fprintf(stderr,"This is not a LIF disk!\n");
-        exit(1);
-      }
-
-    /* Find the directory */
-    dir_start=get_lif_int(blocks[0]+8,4);
-    dir_length=get_lif_int(blocks[0]+16,4);
+    /* Read the volume header and the directory */
+    if ((dir=lif_dir_open(lif_device))==NULL) lif_fatal();
+    header=dir->header;
 
     /* get medium information */
-    no_tracks=get_lif_int(blocks[0]+24,4);
-    no_surfaces=get_lif_int(blocks[0]+28,4);
-    no_blocks=get_lif_int(blocks[0]+32,4);
-    medium_size= no_tracks* no_surfaces* no_blocks;
+    no_tracks=get_lif_int(header+24,4);
+    no_surfaces=get_lif_int(header+28,4);
+    no_blocks=get_lif_int(header+32,4);
     if((no_tracks == no_surfaces) && (no_surfaces == no_blocks)) {
        fprintf(stderr,"Medium was not initialized properly\n");
        exit(1);
      }
-    if (medium_size > MAXBLOCKS) {
-       fprintf(stderr,"Medium size too large\n");
-       exit(1);
-    }
 
-    /*  block 1 */
-    reccount++;
-    blocks[reccount]=malloc(sizeof (unsigned char) * SECTOR_SIZE);
-    blockmap[reccount]=reccount;
-    lif_read_block(lif_device,reccount,blocks[reccount]);
+    /* check for overlapping files, the files of the directory object are
+       sorted by start block, so only neighbours have to be compared */
+    for(slot=1;slot<dir->files;slot++) {
+       if(dir->by_start[slot-1].start+dir->by_start[slot-1].blocks > dir->by_start[slot].start) {
+          fprintf(stderr,"corrupted medium: overlapping files\n");
+          exit(1);
+       }
+    }
 
     /* clear directory */
-    for(reccount=dir_start;reccount<dir_start+dir_length;reccount++) {
-       blocks[reccount]=malloc(sizeof (unsigned char) * SECTOR_SIZE);
-       blockmap[reccount]=reccount;
-       debug_print("directory block %d assigned\n",reccount);
-       for(j=0;j<SECTOR_SIZE;j++) *(blocks[reccount]+j)=0xff;
+    dir_blocks=malloc((size_t) dir->length*SECTOR_SIZE);
+    files=malloc((size_t) dir->slots*sizeof(struct filetype));
+    if(dir_blocks == (unsigned char *) NULL || files == NULL) {
+       fprintf(stderr,"Out of memory\n");
+       exit(1);
     }
+    memset(dir_blocks,0xff,(size_t) dir->length*SECTOR_SIZE);
 
-    /* Scan the directory, buffer in directory entries  */
-    dir_end=0;
+    if(compact_flag) {
+       new_block_count=compact(lif_device,dir,
+                               (lif_blk_t) no_tracks*no_surfaces*no_blocks);
+       /* finally remove the deleted entries from the directory */
+       new_entry=0;
+       for(slot=0; slot<dir->used; slot++) {
+          entry=lif_dir_entry(dir,slot);
+          if(get_lif_int(entry+10,2)==0) { continue; } /* Skip deleted files */
+          memcpy(dir_blocks+(new_entry<<5),entry,ENTRY_SIZE);
+          new_entry++;
+       }
+       if (dir->num_free > 0 &&
+           lif_write_blocks(lif_device,dir->start,dir->length,dir_blocks)) lif_fatal();
+       if (lif_resize(lif_device,new_block_count)) lif_fatal();
+       free(files);
+       free(dir_blocks);
+       lif_dir_close(dir);
+       if (lif_close(lif_device)) lif_fatal();
+       exit(0);
+    }
+
+    /* Scan the directory, buffer in directory entries and file data */
     new_entry=0;
-    new_block_count=dir_start+dir_length;
-    reccount=dir_start;
-    for(dir_block=0; dir_block<dir_length; dir_block++)
+    num_files=0;
+    new_block_count=dir->start+dir->length;
+    for(slot=0; slot<dir->used; slot++)
       {
-        lif_read_block(lif_device,dir_block+dir_start,dir_data);
-        for(dir_entry=0; dir_entry<8; dir_entry++)
-          {
-            file_type=get_lif_int(dir_data+(dir_entry<<5)+10,2);
-            if(file_type==0) { continue; } /* Skip deleted files */ 
-            if(file_type==0xFFFF)
-              {
-                /* End of directory */
-                dir_end=1;
-                break;
-              }
-            /* file found */
-            start_block=get_lif_int(dir_data+(dir_entry<<5)+12,4);
-            num_blocks=get_lif_int(dir_data+(dir_entry<<5)+16,4);
-            debug_print("Entry %d\n",new_entry);
-            debug_print("Start block %d\n",start_block);
-            debug_print("Num blocks %d\n",num_blocks);
-
-            /* write new directory entry */
-            for(i=0;i<ENTRY_SIZE;i++)
-               *(blocks[reccount]+(new_entry<<5)+i)= dir_data[(dir_entry<<5)+i];
-            put_lif_int(blocks[reccount]+(new_entry<<5)+12,4,new_block_count);
-            new_entry++;
-            if(new_entry==8) {
-               new_entry=0;
-               reccount++;
-            }
-
-            /* Do block mapping */
-            for(i=0;i<num_blocks;i++) {
-                blockmap[new_block_count]= start_block;
-                debug_print("block %d mapped to %d\n",start_block,new_block_count);
-                if (allocmap[start_block] == 1) {
-                   fprintf(stderr,"corrupted medium: overlapping files\n");
-                   exit(1);
-                }
-                allocmap[start_block]=1;
-                debug_print("Old block %d allocated\n",start_block);
-                new_block_count++;
-                start_block++; 
-            }
-          }
-        if(dir_end ) { break; }; /* Quit at end or if file found */
-      }
+        entry=lif_dir_entry(dir,slot);
+        if(get_lif_int(entry+10,2)==0) { continue; } /* Skip deleted files */
+        /* file found */
+        start_block=get_lif_int(entry+12,4);
+        num_blocks=get_lif_int(entry+16,4);
+        debug_print("Entry %d\n",new_entry);
+        debug_print("Start block %lld\n",start_block);
+        debug_print("Num blocks %d\n",num_blocks);
 
-     /* read in all file blocks */
-     for(i=0;i<MAXBLOCKS;i++) {
-       if(allocmap[i]==1) {
-          blocks[i]= malloc(BLOCK_SIZE*sizeof(unsigned char));
-          lif_read_block(lif_device,i,blocks[i]);
-          debug_print("Old block %d read\n",i);
-       }
-     }
+        /* write new directory entry */
+        for(i=0;i<ENTRY_SIZE;i++)
+           *(dir_blocks+(new_entry<<5)+i)= *(entry+i);
+        put_lif_int(dir_blocks+(new_entry<<5)+12,4,(unsigned int) new_block_count);
+        new_entry++;
+
+        /* files which are already in place are not touched */
+        if(start_block == new_block_count) {
+           debug_print("blocks %lld..%lld in place\n",start_block,start_block+num_blocks-1);
+           new_block_count+=num_blocks;
+           continue;
+        }
+        /* read in all file blocks with one transfer */
+        files[num_files].start_block=new_block_count;
+        files[num_files].num_blocks=num_blocks;
+        files[num_files].data=malloc((size_t) num_blocks*BLOCK_SIZE+1);
+        if(files[num_files].data == (unsigned char *) NULL) {
+           fprintf(stderr,"Out of memory\n");
+           exit(1);
+        }
+        if (lif_read_blocks(lif_device,start_block,(int) num_blocks,files[num_files].data)) lif_fatal();
+        debug_print("blocks %lld..%lld mapped to %lld\n",start_block,start_block+num_blocks-1,new_block_count);
+        new_block_count+=num_blocks;
+        num_files++;
+      }
 
-     /* truncate lif file */
-     lif_truncate(lif_device);
-     /* write all blocks of packed file */
-     for(i=0;i<MAXBLOCKS;i++) {
-        j=blockmap[i];
-        if(j == -1) break;
-        debug_print("write new block %d using old block %d\n",i,j);
-        lif_write_block(lif_device,i,blocks[j]);
-        free(blocks[j]);
+     /* All files to be moved were buffered and no file is moved onto
+        a file which stays in place, so the medium is updated in place.
+        Blocks which do not change are neither read nor written. The file
+        blocks are written and flushed before the new directory */
+     for(i=0;i<num_files;i++) {
+        debug_print("write new blocks %lld..%lld\n",files[i].start_block,files[i].start_block+files[i].num_blocks-1);
+        if (lif_write_blocks(lif_device,files[i].start_block,(int) files[i].num_blocks,files[i].data)) lif_fatal();
+        free(files[i].data);
      }
-    lif_close(lif_device);
+     if (lif_flush(lif_device)) lif_fatal();
+     if (lif_write_blocks(lif_device,dir->start,dir->length,dir_blocks)) lif_fatal();
+     /* cut off the free space at the end of the image file */
+     if (lif_resize(lif_device,new_block_count)) lif_fatal();
+    free(files);
+    free(dir_blocks);
+    lif_dir_close(dir);
+    if (lif_close(lif_device)) lif_fatal();
     exit(0);      
   }
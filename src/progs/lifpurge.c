@@ -8,6 +8,7 @@
 #include <ctype.h>
 #include "config.h"
 #include"lif_block.h"
+#include "lif_error.h"
 #include"lif_dir_utils.h"
 #include "lif_const.h"
 
@@ -34,21 +35,14 @@ int main(int argc, char **argv)
     int i;
     
     /* LIF disk values */
-    unsigned int dir_start; /* first block of the directory */
-    unsigned int dir_length; /* length of directory in blocks */
-
-    /* Directory search values */
-    unsigned int dir_end; /* Set at end of directory */
-    unsigned int found_file; /* Set when file found */
-    unsigned int dir_entry; /* Directory entry within current block */
-    unsigned int dir_block; /* Current block offset from start of directory */
-    unsigned int abs_entry; /* entry number of file in directory */
-    unsigned int file_type; /* file type word */
-    unsigned char dir_data[SECTOR_SIZE]; /* Current directory block data */
+    struct lif_dir *dir; /* directory of the medium */
+    int slot; /* directory slot of the file */
+    unsigned char entry[ENTRY_SIZE]; /* directory entry of the file */
 
     /* File values */
-    int file_start; /* Starting block number of the file to purge */
-    int file_len; /* Length of file in bytes */
+    lif_blk_t file_start; /* Starting block number of the file to purge */
+    lif_blk_t file_len; /* Length of file in blocks */
+    lif_blk_t block; /* Current block offset from file start */
     unsigned char filedata[SECTOR_SIZE];
 
     for(i=0;i<SECTOR_SIZE;i++) filedata[i]=0xFF;
@@ -86,82 +80,44 @@ int main(int argc, char **argv)
     /* Open lif device */
     if((lif_device=lif_open(argv[optind],O_RDWR | O_BINARY,0,physical_flag))==-1)
       {
-        fprintf(stderr,"Error opening %s\n",argv[optind]);
+        fprintf(stderr,"Error opening %s: %s\n",argv[optind],lif_errmsg());
         exit(1);
       }
 
-
-    /* Now read block 0 to find where the directory is */
-    lif_read_block(lif_device,0,dir_data);
-
-    /* Make sure it's a LIF disk */
-    if(get_lif_int(dir_data+0,2)!=0x8000)
-      {
-        fprintf(stderr,"This is not a LIF disk!\n");
-        exit(1);
-      }
-
-    /* Find the directory */
-    dir_start=get_lif_int(dir_data+8,4);
-    dir_length=get_lif_int(dir_data+16,4);
+    /* Read the directory */
+    if((dir=lif_dir_open(lif_device))==NULL) lif_fatal();
 
     /* Pad the filename with spaces to enable comparison */
     pad_name(argv[optind+1],cmp_name);
 
-    /* Scan the directory */
-    dir_end=0;
-    found_file=0;
-    abs_entry=-1;
-    for(dir_block=0; dir_block<dir_length; dir_block++)
-      {
-        lif_read_block(lif_device,dir_block+dir_start,dir_data);
-        for(dir_entry=0; dir_entry<8; dir_entry++)
-          {
-            file_type=get_lif_int(dir_data+(dir_entry<<5)+10,2);
-            abs_entry++;
-            if(file_type==0) { continue; } /* Skip deleted files */ 
-            if(file_type==0xFFFF)
-              {
-                /* End of directory */
-                dir_end=1;
-                break;
-              }
-            if(compare_names((char *)dir_data+(dir_entry<<5),cmp_name))
-              {
-                /* Found the file */
-                found_file=1;
-                break;
-              }
-          }
-        if(dir_end || found_file) { break; }; /* Quit at end or if file found */
-      }
-
-    if(!found_file)
+    /* Look up the file */
+    slot=lif_dir_find(dir,cmp_name);
+    if(slot == -1)
       {
         /* Give file not found error */
         fprintf(stderr,"File %s not found\n",argv[optind+1]);
         exit(2);
       }
-
+    memcpy(entry,lif_dir_entry(dir,slot),ENTRY_SIZE);
 
     /* Find the file start and length */
-    file_start=get_lif_int(dir_data+(dir_entry<<5)+12,4);
-    file_len=get_lif_int(dir_data+(dir_entry<<5)+16,4);
-    debug_print("file_start %d\n",file_start);
-    debug_print("file_len %d\n",file_len);
-    debug_print("abs_entry %d\n",abs_entry);
-    debug_print("dir_block %d\n",dir_block);
-    debug_print("dir_start %d\n",dir_start);
+    file_start=get_lif_int(entry+12,4);
+    file_len=get_lif_int(entry+16,4);
+    debug_print("file_start %lld\n",file_start);
+    debug_print("file_len %lld\n",file_len);
+    debug_print("slot %d\n",slot);
 
     /* Actually zero the file */ 
-    for(i=0; i< file_len; i++) lif_write_block(lif_device,file_start+i, filedata);
+    for(block=0; block< file_len; block++)
+       if (lif_write_block(lif_device,file_start+block, filedata)) lif_fatal();
 
     /* Actually delete the directory entry */
-   dir_data[(dir_entry<<5)+10]=0x0;
-   dir_data[(dir_entry<<5)+11]=0x0;
-   lif_write_dir_entry(lif_device,dir_start,abs_entry, dir_data+(dir_entry<<5));
+    entry[10]=0x0;
+    entry[11]=0x0;
+    if (lif_dir_write(dir,slot,entry)) lif_fatal();
 
     /* tidy up and quit */
-    lif_close(lif_device);
+    lif_dir_close(dir);
+    if (lif_close(lif_device)) lif_fatal();
     exit(0);      
   }
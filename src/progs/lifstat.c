@@ -3,9 +3,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include "config.h"
 #include "lif_block.h"
+#include "lif_error.h"
 #include "lif_dir_utils.h"
 #include "lif_const.h"
 
@@ -13,7 +15,9 @@
 #define SPT 16
 #define HEADS 2
 #define CYLINDERS 77
-#define TOTAL_BLOCKS 2464
+
+/* csv separator */
+#define SEP ','
 
 /* offsets for the parts of a timestamp */
 #define YEAR_OFF 0
@@ -38,42 +42,38 @@ void print_date(unsigned char *date)
   }
 
 
-void print_block_no(unsigned int block_no)
+void print_block_no(lif_blk_t block_no)
 /* Print the block number, and it's address (cylinder/head/sector) to 
    standard output */
   {
-    printf("%d (%d/%d/%d)",
+    printf("%lld (%lld/%d/%d)",
             block_no,
-            (int) block_no/(HEADS*SPT),
-            (int) (block_no/SPT)%HEADS,
-            (block_no%SPT)+1);
+            block_no/(HEADS*SPT),
+            (int) ((block_no/SPT)%HEADS),
+            (int) (block_no%SPT)+1);
   }
 
-void lif_status(int input_file, int block_flag, unsigned 
-                int block_no)
+void lif_status(int input_file, int block_flag, lif_blk_t block_no)
 /* Print various status items for the given LIF disk (or image) to standard
    output. If block_flag is false, then a sumary of data for the entire disk
    is produced. If block_flag is true, then the name of the file 
    containing block_no is output */
   {
-    unsigned int dir_start; /* first directory block */
-    unsigned int dir_length; /* size of directory */
-    unsigned int dir_end; /* Set at end of directory search */
-    unsigned int found; /* Set if given block found */
-    unsigned int dir_entry; /* directory entry in current block */
-    unsigned int dir_block; /* current directory block (offset from dir_start) */
-    unsigned int file_type; /* current file type */
-    unsigned int file_start; /* start block of current file */
-    unsigned int file_length; /* length of current file */
-    unsigned int last_block; /* last used block on the disk */
+    struct lif_dir *dir; /* directory of the medium */
+    int slot; /* directory slot */
+    int pos= -1; /* position of the file for lif_dir_next_block_owner */
+    unsigned char *entry; /* directory entry */
+    lif_blk_t dir_start; /* first directory block */
+    lif_blk_t dir_length; /* size of directory */
+    lif_blk_t last_block; /* last used block on the disk */
     unsigned int surfaces;  /* no of disk surfaces in lif header */
     unsigned int tracks; /* no of tracks in lif header */
     unsigned int blocks; /* no of blocks in lif header */
-    unsigned int totalsize; /* size of medium in blocks */
+    lif_blk_t totalsize; /* size of medium in blocks */
 
     int i; /* loop index */
     char c; /* filename character */
-    unsigned char data[SECTOR_SIZE]; /* disk block */
+    unsigned char *data; /* volume header */
 
     last_block=0;
 
@@ -91,14 +91,21 @@ void lif_status(int input_file, int block_flag, unsigned
         return;
       }
 
-    /* It's necessary to read the volume label block */
-    lif_read_block(input_file,0,data);
-    /* Check it's a LIF disk */
-    if(get_lif_int(data,2)!=0x8000)
+    /* It's necessary to read the volume label block and the directory */
+    if ((dir=lif_dir_open(input_file))==NULL) lif_fatal();
+    data=dir->header;
+    /* get the medium size, a block number is checked against it */
+    tracks=get_lif_int(data+24,4);
+    surfaces=get_lif_int(data+28,4);
+    blocks=get_lif_int(data+32,4);
+    totalsize= (lif_blk_t) tracks*surfaces*blocks;
+    if(totalsize==0 || blocks == 0x9a009a0) totalsize=0;
+    if(block_flag && totalsize!=0 && block_no>=totalsize)
       {
-        fprintf(stderr,"This is not a LIF disk!\n");
+        fprintf(stderr,"Block number out of range\n");
         exit(1);
       }
+
     /* output label */
     if((*(data+2))!=' ')
       {
@@ -121,21 +128,17 @@ void lif_status(int input_file, int block_flag, unsigned
     printf("\n");
 
     /* Print volume size */
-    tracks=get_lif_int(data+24,4);
-    surfaces=get_lif_int(data+28,4);
-    blocks=get_lif_int(data+32,4);
-    totalsize= tracks*surfaces*blocks;
     printf("Tracks: %d Surfaces: %d Blocks per Track: %d",tracks,surfaces,blocks);
-    if(totalsize==0 || blocks == 0x9a009a0) 
+    if(totalsize==0) 
       {
          printf(".\nWarning the medium was not initialized properly!\n");
       } else {
-         printf(" Total size: %d Blocks, %d Bytes\n",totalsize,totalsize*256);
+         printf(" Total size: %lld Blocks, %lld Bytes\n",totalsize,totalsize*256);
       }
     
     /* Find the directory */
-    dir_start=get_lif_int(data+8,4);
-    dir_length=get_lif_int(data+16,4);
+    dir_start=dir->start;
+    dir_length=dir->length;
 
     if(block_flag)
       {
@@ -144,71 +147,165 @@ void lif_status(int input_file, int block_flag, unsigned
           {
             print_block_no(block_no);
             printf(" : directory\n");
-            return;
           }
-      }
-    else
-      {
-        /* If not looking for a particular block, print directory location */
-        printf("Directory start : ");
-        print_block_no(dir_start);
-        printf(" end : ");
-        print_block_no(dir_start+dir_length-1);
-        printf("\n");
-      }
-
-    /* Scan the directory */
-    found=0;
-    dir_end=0;
-    for(dir_block=0; (dir_block<dir_length)&&(!dir_end)&&(!found); dir_block++)
-      {
-        lif_read_block(input_file,dir_block+dir_start,data);
-        for(dir_entry=0; dir_entry<8; dir_entry++)
+        else if((slot=lif_dir_next_block_owner(dir,block_no,&pos)) != -1)
           {
-            file_type=get_lif_int(data+(dir_entry<<5)+10,2);
-            if(file_type==0) { continue; } /* skip deleted files */
-            if(file_type==0xffff)
-              {
-                /* End of directory */
-                dir_end=1;
-                break;
-              }
-            file_start=get_lif_int(data+(dir_entry<<5)+12,4);
-            file_length=get_lif_int(data+(dir_entry<<5)+16,4);
-            /* update last used block */
-            last_block=file_start+file_length-1;
-            /* If searching for a particular block, is it in this file ? */
-            if(block_flag && (block_no>=file_start) && 
-               (block_no<file_start+file_length))
+            /* the block is part of a file, list all files if the
+               directory has overlapping files */
+            print_block_no(block_no);
+            printf(" : ");
+            do
               {
-                found=1;
-                print_block_no(block_no);
-                printf(" : ");
+                entry=lif_dir_entry(dir,slot);
                 for(i=0; i<10; i++)
                   {
-                    if((c=*(data+(dir_entry<<5)+i))==' ') { break; }
+                    if((c=*(entry+i))==' ') { break; }
                     putchar(c);
                   }
-                printf("\n");
+                slot=lif_dir_next_block_owner(dir,block_no,&pos);
+                if(slot != -1) printf(", ");
               }
+            while(slot != -1);
+            printf("\n");
           }
+        else
+          {
+            /* If the block wasn't part of a file, it's unused */
+            print_block_no(block_no);
+            printf(" : unused\n");
+          }
+        lif_dir_close(dir);
+        return;
       }
 
-    if(block_flag && !found)
+    /* If not looking for a particular block, print directory location */
+    printf("Directory start : ");
+    print_block_no(dir_start);
+    printf(" end : ");
+    print_block_no(dir_start+dir_length-1);
+    printf("\n");
+
+    /* the last file of the directory ends the user data */
+    for(slot=0; slot<dir->used; slot++)
       {
-        /* If the block wasn't part of a file, it's unused */
-        print_block_no(block_no);
-        printf(" : unused\n");
+        entry=lif_dir_entry(dir,slot);
+        if(get_lif_int(entry+10,2)==0) { continue; } /* skip deleted files */
+        last_block=(lif_blk_t) get_lif_int(entry+12,4)+get_lif_int(entry+16,4)-1;
       }
 
-    if(!block_flag)
+    printf("User data start : ");
+    print_block_no(dir_start+dir_length);
+    printf(" end : ");
+    print_block_no(last_block);
+    printf("\n");
+    lif_dir_close(dir);
+  }
+
+void print_block_csv(struct lif_dir *dir, lif_blk_t totalsize, lif_blk_t block_no)
+/* Print the block number, its address and what the block is used for
+   as a line of comma separated values */
+  {
+    int slot; /* directory slot of the file */
+    int pos= -1; /* position of the file for lif_dir_next_block_owner */
+    int len; /* length of file name */
+    unsigned char *entry; /* directory entry */
+
+    printf("%lld%c%lld%c%d%c%d%c",block_no,SEP,block_no/(HEADS*SPT),SEP,
+           (int) ((block_no/SPT)%HEADS),SEP,(int) (block_no%SPT)+1,SEP);
+    if(totalsize!=0 && block_no>=totalsize)
+      {
+        printf("out of range%c\n",SEP);
+      }
+    else if(block_no==0)
+      {
+        printf("volume label%c\n",SEP);
+      }
+    else if(block_no==1)
       {
-        printf("User data start : ");
-        print_block_no(dir_start+dir_length);
-        printf(" end : ");
-        print_block_no(last_block);
+        printf("system 3000 block%c\n",SEP);
+      }
+    else if((block_no>=dir->start)&&(block_no<dir->start+dir->length))
+      {
+        printf("directory%c\n",SEP);
+      }
+    else if((slot=lif_dir_next_block_owner(dir,block_no,&pos)) != -1)
+      {
+        /* overlapping files are separated by blanks */
+        printf("file%c",SEP);
+        do
+          {
+            entry=lif_dir_entry(dir,slot);
+            for(len=NAME_LEN; len>0 && entry[len-1]==' '; len--) ;
+            printf("%.*s",len,(char *) entry);
+            slot=lif_dir_next_block_owner(dir,block_no,&pos);
+            if(slot != -1) putchar(' ');
+          }
+        while(slot != -1);
         printf("\n");
       }
+    else
+      {
+        printf("unused%c\n",SEP);
+      }
+  }
+
+int lif_status_list(int input_file)
+/* Read block numbers or cylinder head sector triples from standard input,
+   one per line, and print for each what the block is used for. The
+   directory is read once, the files are looked up in the index of the
+   directory which is sorted by start block. Returns the number of lines
+   which could not be decoded */
+  {
+    struct lif_dir *dir; /* directory of the medium */
+    unsigned char *data; /* volume header */
+    lif_blk_t totalsize; /* size of medium in blocks */
+    lif_blk_t block_no; /* desired block number */
+    long long cylinder, head, sector; /* desired disk address */
+    unsigned int blocks; /* no of blocks in lif header */
+    char line[256];
+    char *p;
+    int n, line_no, errors;
+
+    if ((dir=lif_dir_open(input_file))==NULL) lif_fatal();
+    data=dir->header;
+    blocks=get_lif_int(data+32,4);
+    totalsize= (lif_blk_t) get_lif_int(data+24,4)*get_lif_int(data+28,4)*blocks;
+    if(blocks == 0x9a009a0) totalsize=0;
+
+    line_no=0;
+    errors=0;
+    while(fgets(line,sizeof(line),stdin) != NULL)
+      {
+        line_no++;
+        /* commas separate the numbers as well as white space */
+        for(p=line; *p; p++) if(*p==SEP) *p=' ';
+        n=sscanf(line,"%lld %lld %lld",&cylinder,&head,&sector);
+        if(n == 1)
+          {
+            block_no=cylinder;
+          }
+        else if(n == 3)
+          {
+            block_no=cylinder*HEADS*SPT + head*SPT + sector-1;
+            if(cylinder<0 || cylinder>=CYLINDERS || head<0 || head>=HEADS ||
+               sector<1 || sector>SPT) block_no=-1;
+          }
+        else
+          {
+            /* skip empty lines */
+            if(strspn(line," \t\r\n") == strlen(line)) continue;
+            block_no=-1;
+          }
+        if(block_no<0)
+          {
+            fprintf(stderr,"Invalid block address in line %d\n",line_no);
+            errors++;
+            continue;
+          }
+        print_block_csv(dir,totalsize,block_no);
+      }
+    lif_dir_close(dir);
+    return(errors);
   }
 
 void usage(void)
@@ -219,6 +316,10 @@ void usage(void)
     fprintf(stderr,
       "        lifstat  lif-image-filename cylinder head sector \n");
     fprintf(stderr,"        print filename containing given block\n");
+    fprintf(stderr,"        lifstat -l lif-image-filename\n");
+    fprintf(stderr,"        read block numbers or cylinder head sector triples\n");
+    fprintf(stderr,"        from standard input and print csv lines with the\n");
+    fprintf(stderr,"        contents of each block\n");
     exit(1);
   }
 
@@ -227,17 +328,21 @@ int main(int argc, char **argv)
     int option; /* command line option character */
     int input_device; /* input file or device desciptor */
     int physical_flag; /* Option to use a physical device */
+    int list_flag; /* Option to read blocks from standard input */
 
-    unsigned int block_no; /* desired block number */
+    lif_blk_t block_no; /* desired block number */
     unsigned int cylinder,head,sector; /* desired disk address */
 
     optind=1;
     physical_flag=0;
+    list_flag=0;
     /* Decode command line options */
-    while((option=getopt(argc,argv,"p?"))!=-1)
+    while((option=getopt(argc,argv,"lp?"))!=-1)
       {
         switch(option)
           {
+            case 'l' : list_flag=1;
+                       break;
             case 'p' : physical_flag=1;
                        break;
 
@@ -253,21 +358,37 @@ int main(int argc, char **argv)
         usage();
       }
 
+    /* the block list is read from standard input */
+    if(list_flag && strcmp(argv[optind],"-")==0)
+      {
+        fprintf(stderr,"The image cannot be read from standard input with -l\n");
+        exit(1);
+      }
+
     /* Open input device */
     if((input_device=lif_open(argv[optind],O_RDONLY | O_BINARY,0,physical_flag))==-1)
       {
-        fprintf(stderr,"Error opening %s\n",argv[optind]);
+        fprintf(stderr,"Error opening %s: %s\n",argv[optind],lif_errmsg());
         exit(1);
       }
 
+    /* process a list of blocks */
+    if(list_flag)
+      {
+        if(optind != argc-1) usage();
+        if(lif_status_list(input_device)) exit(2);
+        if (lif_close(input_device)) lif_fatal();
+        exit(0);
+      }
+
     /* process other command line arguments */
     optind++;
     switch(argc-optind)
       {
         case 0 : lif_status(input_device,0,0);
                  break;
-        case 1 : block_no=atoi(argv[optind]);
-                 if(block_no>=TOTAL_BLOCKS)
+        case 1 : block_no=strtoll(argv[optind],NULL,10);
+                 if(block_no<0)
                    {
                      fprintf(stderr,"Block number out of range\n");
                      exit(1);
@@ -297,7 +418,7 @@ int main(int argc, char **argv)
                  break;
         default : usage();
       }
-    lif_close(input_device);
+    if (lif_close(input_device)) lif_fatal();
     exit(0);
   }
 
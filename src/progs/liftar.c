@@ -0,0 +1,876 @@
+/* liftar.c -- convert between a LIF image file and a tar stream */
+/* 2026, placed under the GPL */
+
+/* The tar stream is a POSIX pax archive. Every LIF file becomes a regular
+   tar member with the blocks of the file as contents, preceded by an
+   extended header with the LIF attributes. A global extended header at
+   the start of the stream holds the volume:
+
+   LIF.header          volume header (block 0) as hex digits, global
+   LIF.dirsize         number of directory entries, global
+   LIF.label           volume label, global, informational
+   LIF.name            file name
+   LIF.type            file type code
+   LIF.date            time stamp, the 6 bcd bytes as hex digits
+   LIF.implementation  bytes 26..31 of the directory entry as hex digits
+   LIF.slot            directory slot of the file
+
+   Both directions work in one sequential pass. The LIF image is read in
+   the order of the start blocks, so it may be a stream. The new image is
+   written packed, with the files in the order of the tar stream. The
+   directory keeps the order of the slots and is written with the volume
+   header when the stream ends. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "lif_block.h"
+#include "lif_error.h"
+#include "lif_dir_utils.h"
+#include "lif_create_entry.h"
+#include "lif_const.h"
+
+#define DEBUG 0
+#define debug_print(fmt, ...) \
+   do { if (DEBUG) fprintf(stderr, fmt, __VA_ARGS__); } while (0)
+
+/* tar record size */
+#define TAR_BLOCK 512
+
+/* fields of a ustar header: offset, length */
+#define TAR_NAME     0
+#define TAR_MODE     100
+#define TAR_UID      108
+#define TAR_GID      116
+#define TAR_SIZE     124
+#define TAR_MTIME    136
+#define TAR_CHKSUM   148
+#define TAR_TYPE     156
+#define TAR_MAGIC    257
+
+/* largest size in the 11 octal digits of the size field */
+#define TAR_MAX_OCTAL 077777777777LL
+
+/* maximum length of an extended header we create or accept */
+#define PAX_SIZE 8192
+
+/* extended header attributes of a tar member */
+struct member {
+   long long size;             /* size, -1 if the ustar header has it */
+   char name[NAME_LEN+1];      /* LIF.name */
+   int has_name;
+   unsigned int lif_type;      /* LIF.type */
+   int has_type;
+   unsigned char date[6];      /* LIF.date */
+   unsigned char impl[6];      /* LIF.implementation */
+   int has_impl;
+   int slot;                   /* LIF.slot, -1 if not present */
+};
+
+/* directory entry of the new image */
+struct new_file {
+   unsigned char entry[ENTRY_SIZE];
+   int slot;                   /* slot in the source directory */
+   int index;                  /* position in the tar stream */
+};
+
+/* attributes of the global header */
+struct volume {
+   unsigned char header[SECTOR_SIZE]; /* LIF.header */
+   int has_header;
+   int dirsize;                /* LIF.dirsize, 0 if unknown */
+};
+
+static int verbose;
+static char *remove_name;      /* incomplete output image */
+
+void usage(void)
+  {
+    fprintf(stderr,"Usage: liftar -c [-v] lif-image-file tar-file\n");
+    fprintf(stderr,"       liftar -x [-m mediumtype] [-n directorysize] [-z] [-v] tar-file\n");
+    fprintf(stderr,"              lif-image-file\n");
+    fprintf(stderr,"\n");
+    fprintf(stderr,"      -c convert a LIF image file to a tar stream\n");
+    fprintf(stderr,"      -x build a packed LIF image file from a tar stream\n");
+    fprintf(stderr,"      -m medium type of the new image (cass | disk | hdrive1 |\n");
+    fprintf(stderr,"         hdrive2 | hdrive4 | hdrive8 | hdrive16), default is the\n");
+    fprintf(stderr,"         medium of the tar stream\n");
+    fprintf(stderr,"      -n number of directory entries of the new image, default is\n");
+    fprintf(stderr,"         the directory size of the tar stream\n");
+    fprintf(stderr,"      -z extend the new image to the full medium size\n");
+    fprintf(stderr,"      -v list the files on standard error\n");
+    fprintf(stderr,"      a tar file name - is standard input or standard output\n");
+    exit(1);
+  }
+
+void *xmalloc(size_t size)
+  {
+    void *p;
+
+    if((p=malloc(size)) == NULL)
+      {
+        fprintf(stderr,"Out of memory\n");
+        exit(1);
+      }
+    return(p);
+  }
+
+/* remove the incomplete image if the program exits with an error */
+void remove_output(void)
+  {
+    if(remove_name != NULL) remove(remove_name);
+  }
+
+/* hex digits of attribute values */
+
+void to_hex(unsigned char *data, int len, char *hex)
+  {
+    static const char digits[]="0123456789ABCDEF";
+    int i;
+
+    for(i=0; i<len; i++)
+      {
+        hex[2*i]=digits[data[i] >> 4];
+        hex[2*i+1]=digits[data[i] & 0x0F];
+      }
+    hex[2*len]='\0';
+  }
+
+int from_hex(char *hex, int hex_len, unsigned char *data, int len)
+  {
+    int i, j, c, byte;
+
+    if(hex_len != 2*len) return(-1);
+    for(i=0; i<len; i++)
+      {
+        byte=0;
+        for(j=0; j<2; j++)
+          {
+            c=hex[2*i+j];
+            if(c >= '0' && c <= '9') c-='0';
+            else if(c >= 'A' && c <= 'F') c-='A'-10;
+            else if(c >= 'a' && c <= 'f') c-='a'-10;
+            else return(-1);
+            byte=byte*16+c;
+          }
+        data[i]=(unsigned char) byte;
+      }
+    return(0);
+  }
+
+/* length of a file name or label without the padding */
+int trimmed_length(unsigned char *name, int len)
+  {
+    while(len > 0 && name[len-1] == ' ') len--;
+    return(len);
+  }
+
+/* convert the bcd time stamp of a directory entry, 0 if there is none */
+long long entry_time(unsigned char *date)
+  {
+    struct tm tm;
+    time_t t;
+    int year;
+
+    if(date[1] == 0) return(0);
+    memset(&tm,0,sizeof(tm));
+    year=bcd_to_dec(date[0]);
+    tm.tm_year= year < 70 ? year+100 : year;
+    tm.tm_mon=bcd_to_dec(date[1])-1;
+    tm.tm_mday=bcd_to_dec(date[2]);
+    tm.tm_hour=bcd_to_dec(date[3]);
+    tm.tm_min=bcd_to_dec(date[4]);
+    tm.tm_sec=bcd_to_dec(date[5]);
+    tm.tm_isdst=-1;
+    t=mktime(&tm);
+    return(t == (time_t) -1 ? 0 : (long long) t);
+  }
+
+/* tar output */
+
+void tar_write(FILE *fp, const void *data, size_t len)
+  {
+    if(fwrite(data,1,len,fp) != len)
+      {
+        fprintf(stderr,"Error writing tar stream\n");
+        exit(1);
+      }
+  }
+
+/* padding behind the contents of a member */
+long long tar_padding(long long size)
+  {
+    return((TAR_BLOCK-size % TAR_BLOCK) % TAR_BLOCK);
+  }
+
+/* pad the contents of a member to a full tar record */
+void tar_pad(FILE *fp, long long size)
+  {
+    static const unsigned char zeros[TAR_BLOCK];
+
+    tar_write(fp,zeros,(size_t) tar_padding(size));
+  }
+
+void put_octal(unsigned char *field, int len, long long value)
+  {
+    /* len-1 octal digits and a terminating NUL */
+    sprintf((char *) field,"%0*llo",len-1,value);
+  }
+
+void tar_header(FILE *fp, char *name, char type, long long size, long long mtime)
+  {
+    unsigned char record[TAR_BLOCK];
+    unsigned int sum;
+    int i;
+
+    memset(record,0,TAR_BLOCK);
+    strncpy((char *) record+TAR_NAME,name,100);
+    put_octal(record+TAR_MODE,8,0644);
+    put_octal(record+TAR_UID,8,0);
+    put_octal(record+TAR_GID,8,0);
+    put_octal(record+TAR_SIZE,12,size > TAR_MAX_OCTAL ? 0 : size);
+    put_octal(record+TAR_MTIME,12,mtime);
+    record[TAR_TYPE]=(unsigned char) type;
+    memcpy(record+TAR_MAGIC,"ustar\0" "00",8);
+
+    /* the checksum is computed with the checksum field as spaces */
+    memset(record+TAR_CHKSUM,' ',8);
+    for(sum=0, i=0; i<TAR_BLOCK; i++) sum+=record[i];
+    sprintf((char *) record+TAR_CHKSUM,"%06o",sum);
+    record[TAR_CHKSUM+7]=' ';
+    tar_write(fp,record,TAR_BLOCK);
+  }
+
+int num_digits(int n)
+  {
+    int digits;
+
+    for(digits=1; n >= 10; n/=10) digits++;
+    return(digits);
+  }
+
+/* add a record "length key=value\n" to an extended header, the length
+   includes its own digits */
+void pax_record(char *pax, int *pax_len, const char *key, const char *value,
+                int value_len)
+  {
+    int len, digits;
+
+    len=(int) strlen(key)+value_len+3;
+    digits=num_digits(len);
+    if(num_digits(len+digits) > digits) digits++;
+    len+=digits;
+    if(*pax_len+len > PAX_SIZE)
+      {
+        fprintf(stderr,"Extended header too long\n");
+        exit(1);
+      }
+    *pax_len+=sprintf(pax+*pax_len,"%d %s=",len,key);
+    memcpy(pax+*pax_len,value,(size_t) value_len);
+    *pax_len+=value_len;
+    pax[(*pax_len)++]='\n';
+  }
+
+void pax_write(FILE *fp, char *name, char type, char *pax, int pax_len)
+  {
+    tar_header(fp,name,type,pax_len,0);
+    tar_write(fp,pax,(size_t) pax_len);
+    tar_pad(fp,pax_len);
+  }
+
+/* LIF image to tar stream */
+
+void create_tar(char *image_name, char *tar_name)
+  {
+    int device;
+    struct lif_dir *dir;
+    unsigned char *entry;
+    unsigned char *data;
+    char pax[PAX_SIZE];
+    char hex[2*SECTOR_SIZE+1];
+    char name[NAME_LEN+1];
+    char header_name[NAME_LEN+20];
+    int pax_len, name_len, i, count;
+    lif_blk_t start, blocks, block;
+    long long size;
+    FILE *fp;
+
+    if((device=lif_open(image_name,O_RDONLY | O_BINARY,0,0))==-1)
+      {
+        fprintf(stderr,"Error opening %s: %s\n",image_name,lif_errmsg());
+        exit(1);
+      }
+    if((dir=lif_dir_open(device))==NULL) lif_fatal();
+
+    if(strcmp(tar_name,"-") == 0)
+      {
+        SETMODE_STDOUT_BINARY;
+        fp=stdout;
+      }
+    else if((fp=fopen(tar_name,"wb")) == NULL)
+      {
+        fprintf(stderr,"can't open File %s\n",tar_name);
+        exit(2);
+      }
+
+    /* the volume */
+    pax_len=0;
+    to_hex(dir->header,SECTOR_SIZE,hex);
+    pax_record(pax,&pax_len,"LIF.header",hex,2*SECTOR_SIZE);
+    sprintf(hex,"%d",dir->slots);
+    pax_record(pax,&pax_len,"LIF.dirsize",hex,(int) strlen(hex));
+    pax_record(pax,&pax_len,"LIF.label",(char *) dir->header+2,
+               trimmed_length(dir->header+2,6));
+    pax_write(fp,"GlobalHead",'g',pax,pax_len);
+
+    /* the files in the order of the start blocks */
+    data=xmalloc(IO_BLOCKS*SECTOR_SIZE);
+    for(i=0; i<dir->files; i++)
+      {
+        entry=lif_dir_entry(dir,dir->by_start[i].slot);
+        start=dir->by_start[i].start;
+        blocks=dir->by_start[i].blocks;
+        size=(long long) blocks*SECTOR_SIZE;
+
+        /* the tar name is the LIF name, with characters a file system
+           would not accept replaced */
+        name_len=trimmed_length(entry,NAME_LEN);
+        for(count=0; count<name_len; count++)
+          {
+            name[count]=(char) entry[count];
+            if(entry[count] < 0x20 || entry[count] >= 0x7F ||
+               entry[count] == '/' || entry[count] == '\\') name[count]='_';
+          }
+        name[name_len]='\0';
+        if(name_len == 0) strcpy(name,"_");
+        if(verbose) fprintf(stderr,"%s\n",name);
+
+        pax_len=0;
+        pax_record(pax,&pax_len,"LIF.name",(char *) entry,name_len);
+        sprintf(hex,"%u",get_lif_int(entry+10,2));
+        pax_record(pax,&pax_len,"LIF.type",hex,(int) strlen(hex));
+        to_hex(entry+20,6,hex);
+        pax_record(pax,&pax_len,"LIF.date",hex,12);
+        to_hex(entry+26,6,hex);
+        pax_record(pax,&pax_len,"LIF.implementation",hex,12);
+        sprintf(hex,"%d",dir->by_start[i].slot);
+        pax_record(pax,&pax_len,"LIF.slot",hex,(int) strlen(hex));
+        if(size > TAR_MAX_OCTAL)
+          {
+            sprintf(hex,"%lld",size);
+            pax_record(pax,&pax_len,"size",hex,(int) strlen(hex));
+          }
+        sprintf(header_name,"PaxHeaders/%s",name);
+        pax_write(fp,header_name,'x',pax,pax_len);
+        tar_header(fp,name,'0',size,entry_time(entry+20));
+
+        debug_print("file %s blocks %lld..%lld\n",name,start,start+blocks-1);
+        for(block=0; block<blocks; block+=count)
+          {
+            count= blocks-block > IO_BLOCKS ? IO_BLOCKS : (int) (blocks-block);
+            if(lif_read_blocks(device,start+block,count,data)) lif_fatal();
+            tar_write(fp,data,(size_t) count*SECTOR_SIZE);
+          }
+        tar_pad(fp,size);
+      }
+
+    /* two zero records end the archive */
+    memset(data,0,2*TAR_BLOCK);
+    tar_write(fp,data,2*TAR_BLOCK);
+    if(fflush(fp) || (fp != stdout && fclose(fp)))
+      {
+        fprintf(stderr,"Error writing tar stream\n");
+        exit(1);
+      }
+    free(data);
+    lif_dir_close(dir);
+    if(lif_close(device)) lif_fatal();
+  }
+
+/* tar stream to LIF image */
+
+void new_member(struct member *m)
+  {
+    memset(m,0,sizeof(struct member));
+    m->size=-1;
+    m->slot=-1;
+  }
+
+int compare_name(const void *a, const void *b)
+  {
+    return(memcmp(((const struct new_file *) a)->entry,
+                  ((const struct new_file *) b)->entry,NAME_LEN));
+  }
+
+int compare_slot(const void *a, const void *b)
+  {
+    const struct new_file *fa=a, *fb=b;
+
+    /* files without a slot follow in the order of the tar stream */
+    if(fa->slot != fb->slot)
+      {
+        if(fa->slot == -1) return(1);
+        if(fb->slot == -1) return(-1);
+        return(fa->slot < fb->slot ? -1 : 1);
+      }
+    return(fa->index < fb->index ? -1 : fa->index > fb->index);
+  }
+
+void tar_read(FILE *fp, void *data, size_t len)
+  {
+    if(fread(data,1,len,fp) != len)
+      {
+        fprintf(stderr,"Unexpected end of tar stream\n");
+        exit(1);
+      }
+  }
+
+/* skip bytes of the stream, which may be a pipe */
+void tar_skip(FILE *fp, long long bytes)
+  {
+    unsigned char record[TAR_BLOCK];
+
+    for( ; bytes > TAR_BLOCK; bytes-=TAR_BLOCK) tar_read(fp,record,TAR_BLOCK);
+    tar_read(fp,record,(size_t) bytes);
+  }
+
+long long get_octal(unsigned char *field, int len)
+  {
+    long long value;
+    int i;
+
+    value=0;
+    for(i=0; i<len && field[i] == ' '; i++) ;
+    for( ; i<len && field[i] >= '0' && field[i] <= '7'; i++)
+       value=value*8+(field[i]-'0');
+    return(value);
+  }
+
+/* read a ustar header. Returns 0 at the end of the archive */
+int read_header(FILE *fp, char *type, long long *size, char *name)
+  {
+    unsigned char record[TAR_BLOCK];
+    unsigned int sum;
+    int i;
+
+    tar_read(fp,record,TAR_BLOCK);
+    for(i=0; i<TAR_BLOCK && record[i] == 0; i++) ;
+    if(i == TAR_BLOCK) return(0);
+
+    for(sum=0, i=0; i<TAR_BLOCK; i++)
+       sum+= (i >= TAR_CHKSUM && i < TAR_CHKSUM+8) ? ' ' : record[i];
+    if(sum != (unsigned int) get_octal(record+TAR_CHKSUM,8) ||
+       memcmp(record+TAR_MAGIC,"ustar",5))
+      {
+        fprintf(stderr,"This is not a tar stream\n");
+        exit(1);
+      }
+    *type= record[TAR_TYPE] ? (char) record[TAR_TYPE] : '0';
+    *size=get_octal(record+TAR_SIZE,12);
+    memcpy(name,record+TAR_NAME,100);
+    name[100]='\0';
+    return(1);
+  }
+
+/* read an extended header and store the attributes we know */
+void read_pax(FILE *fp, long long size, struct member *m, struct volume *vol)
+  {
+    char pax[PAX_SIZE+1];
+    char *p, *end, *key, *value;
+    int len, value_len;
+    unsigned int type;
+
+    if(size > PAX_SIZE)
+      {
+        fprintf(stderr,"Extended header too long\n");
+        exit(1);
+      }
+    tar_read(fp,pax,(size_t) size);
+    pax[size]='\0';
+    tar_skip(fp,tar_padding(size));
+
+    p=pax;
+    end=pax+size;
+    while(p < end)
+      {
+        if(sscanf(p,"%d",&len) != 1 || len <= 0 || len > end-p ||
+           p[len-1] != '\n' || (key=memchr(p,' ',(size_t) len)) == NULL ||
+           (value=memchr(key,'=',(size_t) (p+len-key))) == NULL)
+          {
+            fprintf(stderr,"Invalid extended header\n");
+            exit(1);
+          }
+        key++;
+        *value++='\0';
+        value_len=(int) (p+len-1-value);
+        debug_print("pax %s %.*s\n",key,value_len,value);
+
+        if(strcmp(key,"size") == 0)
+          {
+            if(sscanf(value,"%lld",&m->size) != 1) m->size=-1;
+          }
+        else if(strcmp(key,"LIF.name") == 0)
+          {
+            if(value_len > NAME_LEN)
+              {
+                fprintf(stderr,"Invalid LIF file name %.*s\n",value_len,value);
+                exit(1);
+              }
+            memcpy(m->name,value,(size_t) value_len);
+            m->name[value_len]='\0';
+            if(check_filename(m->name) == 0)
+              {
+                fprintf(stderr,"Invalid LIF file name %s\n",m->name);
+                exit(1);
+              }
+            m->has_name=1;
+          }
+        else if(strcmp(key,"LIF.type") == 0)
+          {
+            if(sscanf(value,"%u",&type) != 1 || type == 0 || type > 0xFFFE)
+              {
+                fprintf(stderr,"Invalid LIF file type %.*s\n",value_len,value);
+                exit(1);
+              }
+            m->lif_type=type;
+            m->has_type=1;
+          }
+        else if(strcmp(key,"LIF.date") == 0)
+          {
+            if(from_hex(value,value_len,m->date,6))
+              {
+                fprintf(stderr,"Invalid LIF time stamp %.*s\n",value_len,value);
+                exit(1);
+              }
+          }
+        else if(strcmp(key,"LIF.implementation") == 0)
+          {
+            if(from_hex(value,value_len,m->impl,6))
+              {
+                fprintf(stderr,"Invalid LIF implementation bytes %.*s\n",value_len,value);
+                exit(1);
+              }
+            m->has_impl=1;
+          }
+        else if(strcmp(key,"LIF.slot") == 0)
+          {
+            if(sscanf(value,"%d",&m->slot) != 1 || m->slot < 0)
+              {
+                fprintf(stderr,"Invalid LIF directory slot %.*s\n",value_len,value);
+                exit(1);
+              }
+          }
+        else if(strcmp(key,"LIF.header") == 0 && vol != NULL)
+          {
+            if(from_hex(value,value_len,vol->header,SECTOR_SIZE))
+              {
+                fprintf(stderr,"Invalid LIF volume header\n");
+                exit(1);
+              }
+            vol->has_header=1;
+          }
+        else if(strcmp(key,"LIF.dirsize") == 0 && vol != NULL)
+          {
+            if(sscanf(value,"%d",&vol->dirsize) != 1 || vol->dirsize <= 0)
+              {
+                fprintf(stderr,"Invalid LIF directory size %.*s\n",value_len,value);
+                exit(1);
+              }
+          }
+        p+=len;
+      }
+  }
+
+/* create the new image when the first file arrives. The geometry and the
+   directory size are taken from the options or the global header */
+int create_image(char *image_name, char *medium, int dirsize,
+                 struct volume *vol, int *tracks, int *heads, int *sectors,
+                 lif_blk_t *medium_size, int *dir_length)
+  {
+    int device, temp;
+
+    if(medium != NULL)
+      {
+        *medium_size=get_medium(medium,tracks,heads,sectors);
+        if(*medium_size == 0) usage();
+      }
+    else if(vol->has_header)
+      {
+        *tracks=get_lif_int(vol->header+24,4);
+        *heads=get_lif_int(vol->header+28,4);
+        *sectors=get_lif_int(vol->header+32,4);
+        if((*tracks == *heads) && (*heads == *sectors))
+          {
+            fprintf(stderr,"Medium was not initialized properly\n");
+            exit(1);
+          }
+        *medium_size= (lif_blk_t) *tracks * *heads * *sectors;
+      }
+    else
+      {
+        fprintf(stderr,"The tar stream has no LIF volume, use -m\n");
+        exit(1);
+      }
+
+    if(dirsize == 0) dirsize=vol->dirsize;
+    if(dirsize == 0)
+      {
+        fprintf(stderr,"The tar stream has no LIF volume, use -n\n");
+        exit(1);
+      }
+    temp= dirsize* ENTRY_SIZE;
+    *dir_length= temp/SECTOR_SIZE + (int) ((temp % SECTOR_SIZE) !=0);
+    if (*dir_length > *medium_size / 3) {
+       fprintf(stderr,"directory size too large\n");
+       exit(1);
+    }
+
+    if((device=lif_open(image_name,O_CREAT | O_BINARY | O_TRUNC | O_WRONLY,S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH,0))==-1)
+      {
+        fprintf(stderr,"Error opening %s: %s\n",image_name,lif_errmsg());
+        exit(1);
+      }
+    remove_name=image_name;
+    return(device);
+  }
+
+void extract_tar(char *tar_name, char *image_name, char *medium, int dirsize,
+                 int zero_data)
+  {
+    struct stat st;
+    struct volume vol;
+    struct member m;
+    char type;
+    long long size, bytes;
+    char name[101];
+    int device; /* new image, -1 until the first file */
+    int tracks, heads, sectors; /* medium geometry */
+    lif_blk_t medium_size; /* blocks of the new medium */
+    int dir_length; /* directory blocks of the new image */
+    lif_blk_t next_block; /* next free block in the new image */
+    lif_blk_t blocks, block;
+    struct new_file *files; /* directory entries of the new image */
+    unsigned char *dir_blocks; /* directory of the new image */
+    unsigned char *entry;
+    unsigned char date_entry[ENTRY_SIZE]; /* time stamp of a new volume */
+    unsigned char *data;
+    int num_files, count, i;
+    FILE *fp;
+
+    /* the target must be a new file */
+    if(stat(image_name,&st) == 0)
+      {
+        fprintf(stderr,"Output LIF image file already exists\n");
+        exit(1);
+      }
+    if(strcmp(tar_name,"-") == 0)
+      {
+        SETMODE_STDIN_BINARY;
+        fp=stdin;
+      }
+    else if((fp=fopen(tar_name,"rb")) == NULL)
+      {
+        fprintf(stderr,"can't open File %s\n",tar_name);
+        exit(2);
+      }
+    atexit(remove_output);
+
+    memset(&vol,0,sizeof(vol));
+    new_member(&m);
+    device=-1;
+    tracks=heads=sectors=0;
+    medium_size=0;
+    dir_length=0;
+    next_block=0;
+    files=NULL;
+    num_files=0;
+    data=xmalloc(IO_BLOCKS*SECTOR_SIZE);
+
+    while(read_header(fp,&type,&size,name))
+      {
+        debug_print("tar member %s type %c size %lld\n",name,type,size);
+        if(type == 'g')
+          {
+            read_pax(fp,size,&m,&vol);
+            new_member(&m);
+            continue;
+          }
+        if(type == 'x')
+          {
+            read_pax(fp,size,&m,NULL);
+            continue;
+          }
+        if(m.size >= 0) size=m.size;
+        if(type != '0' && type != '7')
+          {
+            /* directories, links and other members are not LIF files */
+            if(type != '5')
+               fprintf(stderr,"Skipping %s, not a regular file\n",name);
+            tar_skip(fp,size+tar_padding(size));
+            new_member(&m);
+            continue;
+          }
+        if(!m.has_name || !m.has_type)
+          {
+            fprintf(stderr,"%s has no LIF file attributes\n",name);
+            exit(1);
+          }
+
+        if(device == -1)
+          {
+            device=create_image(image_name,medium,dirsize,&vol,&tracks,&heads,
+                                &sectors,&medium_size,&dir_length);
+            next_block=2+dir_length;
+            files=xmalloc((size_t) dir_length*8*sizeof(struct new_file));
+          }
+        blocks=(size+SECTOR_SIZE-1)/SECTOR_SIZE;
+        if(num_files == dir_length*8)
+          {
+            fprintf(stderr,"Directory full\n");
+            exit(2);
+          }
+        if(next_block+blocks > medium_size)
+          {
+            fprintf(stderr,"No room\n");
+            exit(2);
+          }
+        if(verbose) fprintf(stderr,"%s\n",m.name);
+
+        /* the directory entry */
+        files[num_files].slot=m.slot;
+        files[num_files].index=num_files;
+        entry=files[num_files].entry;
+        memset(entry,0,ENTRY_SIZE);
+        memset(entry,' ',NAME_LEN);
+        memcpy(entry,m.name,strlen(m.name));
+        put_lif_int(entry+10,2,m.lif_type);
+        put_lif_int(entry+12,4,(unsigned int) next_block);
+        put_lif_int(entry+16,4,(unsigned int) blocks);
+        memcpy(entry+20,m.date,6);
+        if(m.has_impl) memcpy(entry+26,m.impl,6);
+        else
+          {
+            entry[26]=128;
+            entry[27]=1;
+          }
+        num_files++;
+
+        /* the file blocks, the last block is padded with zeros */
+        for(block=0; block<blocks; block+=count)
+          {
+            count= blocks-block > IO_BLOCKS ? IO_BLOCKS : (int) (blocks-block);
+            bytes=size-block*SECTOR_SIZE;
+            if(bytes > (long long) count*SECTOR_SIZE) bytes=(long long) count*SECTOR_SIZE;
+            memset(data+bytes,0,(size_t) ((long long) count*SECTOR_SIZE-bytes));
+            tar_read(fp,data,(size_t) bytes);
+            if(lif_write_blocks(device,next_block+block,count,data)) lif_fatal();
+          }
+        tar_skip(fp,tar_padding(size));
+        next_block+=blocks;
+
+        new_member(&m);
+      }
+    if(fp != stdin) fclose(fp);
+
+    /* an archive without files gives an empty image */
+    if(device == -1)
+      {
+        device=create_image(image_name,medium,dirsize,&vol,&tracks,&heads,
+                            &sectors,&medium_size,&dir_length);
+      }
+
+    /* a name must not occur twice, the incomplete image is removed */
+    if(num_files > 0) qsort(files,num_files,sizeof(struct new_file),compare_name);
+    for(i=1; i<num_files; i++)
+      {
+        if(memcmp(files[i-1].entry,files[i].entry,NAME_LEN) == 0)
+          {
+            fprintf(stderr,"Duplicate filename: %.*s\n",NAME_LEN,
+                    (char *) files[i].entry);
+            exit(2);
+          }
+      }
+
+    /* write the directory in the order of the source slots */
+    if(num_files > 0) qsort(files,num_files,sizeof(struct new_file),compare_slot);
+    dir_blocks=xmalloc((size_t) dir_length*SECTOR_SIZE);
+    memset(dir_blocks,0xff,(size_t) dir_length*SECTOR_SIZE);
+    for(i=0; i<num_files; i++)
+       memcpy(dir_blocks+i*ENTRY_SIZE,files[i].entry,ENTRY_SIZE);
+    if(lif_write_blocks(device,2,dir_length,dir_blocks)) lif_fatal();
+
+    /* write the volume header, the label of the tar stream is kept */
+    memset(data,0,SECTOR_SIZE);
+    if(vol.has_header) memcpy(data,vol.header,SECTOR_SIZE);
+    else
+      {
+        put_lif_int(data+0,2,0x8000);
+        for(i=2;i<8;i++) data[i]=' ';
+        put_lif_int(data+20,2,1);
+        put_time(date_entry);
+        for(i=36;i<42;i++) data[i]= date_entry[i-16];
+      }
+    put_lif_int(data+8,4,2);
+    put_lif_int(data+16,4,dir_length);
+    put_lif_int(data+24,4,tracks);
+    put_lif_int(data+28,4,heads);
+    put_lif_int(data+32,4,sectors);
+    if (lif_write_block(device,0,data)) lif_fatal();
+    memset(data,0,SECTOR_SIZE);
+    if (lif_write_block(device,1,data)) lif_fatal();
+    if (zero_data && lif_resize(device,medium_size)) lif_fatal();
+    if (lif_close(device)) lif_fatal();
+    remove_name=NULL;
+    free(dir_blocks);
+    free(files);
+    free(data);
+  }
+
+int main(int argc, char **argv)
+  {
+    int option; /* Command line option character */
+    int create_flag, extract_flag, zero_data;
+    char *medium;
+    int dirsize;
+
+    /* Process command line options */
+    create_flag=0;
+    extract_flag=0;
+    zero_data=0;
+    medium=NULL;
+    dirsize=0;
+    verbose=0;
+    optind=1;
+    while ((option=getopt(argc,argv,"cxm:n:zv?"))!=-1)
+      {
+        switch(option)
+          {
+            case 'c' : create_flag=1;
+                       break;
+            case 'x' : extract_flag=1;
+                       break;
+            case 'm' : medium=optarg;
+                       break;
+            case 'n' : if (sscanf(optarg,"%d",&dirsize)!= 1 || dirsize <= 0)
+                          usage();
+                       break;
+            case 'z' : zero_data=1;
+                       break;
+            case 'v' : verbose=1;
+                       break;
+            case '?' : usage();
+                       break;
+          }
+      }
+    if(create_flag+extract_flag != 1 || optind != argc-2) usage();
+    if(create_flag && (medium != NULL || dirsize != 0 || zero_data)) usage();
+
+    if(create_flag) create_tar(argv[optind],argv[optind+1]);
+    else extract_tar(argv[optind],argv[optind+1],medium,dirsize,zero_data);
+    exit(0);
+  }